@@ -5,6 +5,8 @@
 #include <unordered_set>
 #include <boost/functional/hash.hpp> // Comment this if you haven't boost installed
 
+#include "graph instrumentation.h"
+
 // This is an example list of the basic algorithms we will work with in class.
 //
 // In general this is what the following template parameters are:
@@ -33,6 +35,8 @@ void breadth_first_search(const Graph &g, ParentMap &p)
     typedef typename Graph::const_edge_iterator edge_iterator;
     typedef typename Graph::const_adj_edge_iterator adj_edge_iterator;
 
+    GRAPH_PHASE("breadth_first_search");
+
     // setup
     std::queue<vertex_descriptor> q;
     std::unordered_set<edge_descriptor, boost::hash<edge_descriptor>> edges_unexplored;
@@ -56,14 +60,17 @@ void breadth_first_search(const Graph &g, ParentMap &p)
         if (vertices_unexplored.count(vd))
         {
             q.push(vd);
+            GRAPH_COUNT(frontier_pushes, 1);
             vertices_unexplored.erase(vd);
             while (!q.empty())
             {
+                GRAPH_MAX(max_frontier, q.size());
                 vertex_descriptor vd = q.front();
                 q.pop();
                 auto &v = *g.find_vertex(vd);
                 for (adj_edge_iterator aei = v->begin(); aei != v->end(); ++aei)
                 {
+                    GRAPH_COUNT(edges_examined, 1);
                     auto el = edges_unexplored.find((*aei)->descriptor());
                     if (el != edges_unexplored.end())
                     {
@@ -73,7 +80,9 @@ void breadth_first_search(const Graph &g, ParentMap &p)
                             // discovery edge
                             edges_unexplored.erase(el);
                             p[t] = v->descriptor();
+                            GRAPH_COUNT(parent_writes, 1);
                             q.push(t);
+                            GRAPH_COUNT(frontier_pushes, 1);
                             vertices_unexplored.erase(t);
                         }
                         // else cross edge
@@ -92,7 +101,8 @@ void depth_first_search(const Graph &g, ParentMap &p)
     typedef typename Graph::edge_descriptor edge_descriptor;
     typedef typename Graph::const_vertex_iterator vertex_iterator;
     typedef typename Graph::const_edge_iterator edge_iterator;
-    typedef typename Graph::const_adj_edge_iterator adj_edge_iterator;
+
+    GRAPH_PHASE("depth_first_search");
 
     // setup
     std::unordered_set<edge_descriptor, boost::hash<edge_descriptor>> edges_unexplored;
@@ -127,11 +137,14 @@ void dfs_visit(const Graph &g, typename Graph::vertex_descriptor u,
                                   boost::hash<typename Graph::edge_descriptor>> &edges_unexplored,
                std::unordered_set<typename Graph::vertex_descriptor> &vertices_unexplored)
 {
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
 
+    GRAPH_COUNT(frontier_pushes, 1);
     auto &v = *g.find_vertex(u);
     vertices_unexplored.erase(u);
     for (auto aei = v->begin(); aei != v->end(); ++aei)
     {
+        GRAPH_COUNT(edges_examined, 1);
         auto el = edges_unexplored.find((*aei)->descriptor());
         if (el != edges_unexplored.end())
         {
@@ -140,6 +153,7 @@ void dfs_visit(const Graph &g, typename Graph::vertex_descriptor u,
             if (vertices_unexplored.count(t))
             {
                 p[t] = u;
+                GRAPH_COUNT(parent_writes, 1);
                 dfs_visit(g, t, p, edges_unexplored, vertices_unexplored);
             }
         }
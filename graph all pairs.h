@@ -0,0 +1,367 @@
+#ifndef _GRAPH_ALL_PAIRS_H_
+#define _GRAPH_ALL_PAIRS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "graph parallel.h"
+#include "graph shortest paths.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// All-pairs shortest paths into a dense distance matrix.
+///
+/// floyd_warshall_all_pairs is for small dense graphs (up to some 20k
+/// vertices, the matrix is n^2 entries). It runs the blocked Floyd-Warshall
+/// of Venkataraman et al.: for each diagonal block kb, first the block itself,
+/// then the blocks of row and column kb, then all remaining blocks, each of
+/// which only reads block (i, kb) and (kb, j). A 64 x 64 block of floats is
+/// 16 KB, so the three blocks of an update stay in L1/L2, and the last phase
+/// runs its blocks in parallel. The inner min-plus row update is vectorised
+/// with AVX-512 or AVX2 when the compiler targets them, and plain C++ (which
+/// compilers auto-vectorise reasonably) otherwise.
+///
+/// johnson_all_pairs is for sparse graphs: Bellman-Ford from a virtual source
+/// gives potentials h with w(u, v) + h(u) - h(v) >= 0, then one Dijkstra per
+/// source runs on the reweighted edges, the sources spread over threads.
+///
+/// Both accept negative weights and return false if there is a negative
+/// cycle. Matrix rows and columns are vertex positions in the order of
+/// vertices_cbegin(); distance() looks them up by descriptor.
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class distance_matrix
+{
+public:
+    typedef T value_type;
+    typedef size_t vertex_descriptor;
+
+    static constexpr size_t block = 64; ///< Side of a Floyd-Warshall tile; rows are padded to a multiple
+
+    ///@brief Unreachable. Half the maximum for integers so that adding two
+    ///       of them cannot overflow; integer distances must stay below it.
+    static T infinity()
+    {
+        return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                    : std::numeric_limits<T>::max() / 2;
+    }
+
+    ///@brief Size the matrix for the given vertices: 0 on the diagonal,
+    ///       infinity elsewhere.
+    void assign(const std::vector<vertex_descriptor> &descriptors)
+    {
+        m_descriptors = descriptors;
+        m_index.clear();
+        for (size_t i = 0; i < m_descriptors.size(); ++i)
+            m_index.emplace(m_descriptors[i], i);
+        m_n = m_descriptors.size();
+        m_stride = (m_n + block - 1) / block * block;
+        m_data.assign(m_stride * m_stride, infinity());
+        for (size_t i = 0; i < m_n; ++i)
+            m_data[i * m_stride + i] = T();
+    }
+
+    size_t size() const { return m_n; }
+    size_t stride() const { return m_stride; }
+    T *row(size_t i) { return m_data.data() + i * m_stride; }
+    const T *row(size_t i) const { return m_data.data() + i * m_stride; }
+    T &operator()(size_t i, size_t j) { return m_data[i * m_stride + j]; }
+    T operator()(size_t i, size_t j) const { return m_data[i * m_stride + j]; }
+
+    size_t index_of(vertex_descriptor vd) const { return m_index.at(vd); }
+    vertex_descriptor descriptor_of(size_t i) const { return m_descriptors[i]; }
+    const std::vector<vertex_descriptor> &descriptors() const { return m_descriptors; }
+
+    ///@brief Distance between two vertices by descriptor.
+    T distance(vertex_descriptor s, vertex_descriptor t) const { return (*this)(index_of(s), index_of(t)); }
+    bool reachable(size_t i, size_t j) const { return (*this)(i, j) != infinity(); }
+
+private:
+    size_t m_n = 0;
+    size_t m_stride = 0;
+    std::vector<T> m_data;
+    std::vector<vertex_descriptor> m_descriptors;
+    std::unordered_map<vertex_descriptor, size_t> m_index;
+};
+
+///@brief c[j] = min(c[j], a + b[j]) for j in [0, len). len is a multiple of
+///       16; the SIMD overloads rely on it. Integers have no infinity that
+///       absorbs a negative a, so an infinite b[j] is skipped; the caller
+///       skips an infinite a.
+template <typename T>
+inline void min_plus_row(T *c, T a, const T *b, size_t len)
+{
+    const T inf = distance_matrix<T>::infinity();
+    for (size_t j = 0; j < len; ++j)
+    {
+        T x = a + b[j];
+        if (!std::numeric_limits<T>::has_infinity && b[j] == inf)
+            x = inf;
+        c[j] = x < c[j] ? x : c[j];
+    }
+}
+
+#if defined(__AVX512F__)
+inline void min_plus_row(float *c, float a, const float *b, size_t len)
+{
+    __m512 va = _mm512_set1_ps(a);
+    for (size_t j = 0; j < len; j += 16)
+        _mm512_storeu_ps(c + j, _mm512_min_ps(_mm512_loadu_ps(c + j), _mm512_add_ps(va, _mm512_loadu_ps(b + j))));
+}
+
+inline void min_plus_row(double *c, double a, const double *b, size_t len)
+{
+    __m512d va = _mm512_set1_pd(a);
+    for (size_t j = 0; j < len; j += 8)
+        _mm512_storeu_pd(c + j, _mm512_min_pd(_mm512_loadu_pd(c + j), _mm512_add_pd(va, _mm512_loadu_pd(b + j))));
+}
+
+inline void min_plus_row(int32_t *c, int32_t a, const int32_t *b, size_t len)
+{
+    __m512i va = _mm512_set1_epi32(a);
+    __m512i vinf = _mm512_set1_epi32(distance_matrix<int32_t>::infinity());
+    for (size_t j = 0; j < len; j += 16)
+    {
+        __m512i vb = _mm512_loadu_si512(b + j);
+        __m512i vc = _mm512_loadu_si512(c + j);
+        __mmask16 finite = _mm512_cmpneq_epi32_mask(vb, vinf);
+        _mm512_storeu_si512(c + j, _mm512_mask_min_epi32(vc, finite, vc, _mm512_add_epi32(va, vb)));
+    }
+}
+
+inline void min_plus_row(int64_t *c, int64_t a, const int64_t *b, size_t len)
+{
+    __m512i va = _mm512_set1_epi64(a);
+    __m512i vinf = _mm512_set1_epi64(distance_matrix<int64_t>::infinity());
+    for (size_t j = 0; j < len; j += 8)
+    {
+        __m512i vb = _mm512_loadu_si512(b + j);
+        __m512i vc = _mm512_loadu_si512(c + j);
+        __mmask8 finite = _mm512_cmpneq_epi64_mask(vb, vinf);
+        _mm512_storeu_si512(c + j, _mm512_mask_min_epi64(vc, finite, vc, _mm512_add_epi64(va, vb)));
+    }
+}
+#elif defined(__AVX2__)
+inline void min_plus_row(float *c, float a, const float *b, size_t len)
+{
+    __m256 va = _mm256_set1_ps(a);
+    for (size_t j = 0; j < len; j += 8)
+        _mm256_storeu_ps(c + j, _mm256_min_ps(_mm256_loadu_ps(c + j), _mm256_add_ps(va, _mm256_loadu_ps(b + j))));
+}
+
+inline void min_plus_row(double *c, double a, const double *b, size_t len)
+{
+    __m256d va = _mm256_set1_pd(a);
+    for (size_t j = 0; j < len; j += 4)
+        _mm256_storeu_pd(c + j, _mm256_min_pd(_mm256_loadu_pd(c + j), _mm256_add_pd(va, _mm256_loadu_pd(b + j))));
+}
+
+inline void min_plus_row(int32_t *c, int32_t a, const int32_t *b, size_t len)
+{
+    __m256i va = _mm256_set1_epi32(a);
+    __m256i vinf = _mm256_set1_epi32(distance_matrix<int32_t>::infinity());
+    for (size_t j = 0; j < len; j += 8)
+    {
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(c + j));
+        __m256i x = _mm256_blendv_epi8(_mm256_add_epi32(va, vb), vinf, _mm256_cmpeq_epi32(vb, vinf));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + j), _mm256_min_epi32(x, y));
+    }
+}
+#endif
+
+///@brief Floyd-Warshall on one tile: c = min(c, a (x) b) in min-plus, with
+///       k outermost so that c may alias a or b as in the first two phases.
+///       Rows with no path to k are skipped, so infinities stay exact.
+template <typename T>
+void floyd_warshall_tile(T *c, const T *a, const T *b, size_t stride)
+{
+    const size_t B = distance_matrix<T>::block;
+    for (size_t k = 0; k < B; ++k)
+        for (size_t i = 0; i < B; ++i)
+            if (a[i * stride + k] != distance_matrix<T>::infinity())
+                min_plus_row(c + i * stride, a[i * stride + k], b + k * stride, B);
+}
+
+///@brief Fill m with the edge weights of g (the lightest of parallel edges).
+template <typename Graph, typename T, typename WeightMap>
+void fill_distance_matrix(const Graph &g, distance_matrix<T> &m, WeightMap w)
+{
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+
+    std::vector<size_t> descriptors;
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        descriptors.push_back((*vi)->descriptor());
+    m.assign(descriptors);
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        T &x = m(m.index_of((*ei)->source()), m.index_of((*ei)->target()));
+        x = std::min(x, static_cast<T>(w(*ei)));
+    }
+}
+
+///@brief Bellman-Ford from a virtual source with a zero-weight edge to every
+///       vertex of e: h receives potentials with w(u, v) + h(u) - h(v) >= 0.
+///       Returns false if there is a negative cycle.
+template <typename Graph, typename WeightMap, typename T>
+bool johnson_potentials(const weighted_edge_list<Graph, WeightMap> &e, const std::vector<T> &weights,
+                        std::vector<T> &h)
+{
+    h.assign(e.num_vertices(), T());
+    std::vector<size_t> parent(e.num_vertices(), std::numeric_limits<size_t>::max());
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (size_t i = 0; i < e.num_edges(); ++i)
+        {
+            T nd = h[e.sources[i]] + weights[i];
+            if (nd < h[e.targets[i]])
+            {
+                h[e.targets[i]] = nd;
+                parent[e.targets[i]] = e.sources[i];
+                changed = true;
+            }
+        }
+        if (changed && !find_parent_cycle(parent).empty())
+            return false;
+    }
+    return true;
+}
+
+///@brief Blocked Floyd-Warshall over the dense matrix of g. m receives the
+///       distances; returns false if g has a negative cycle. Around a
+///       negative cycle the entries would grow without bound, so with
+///       negative weights the cycle check runs first.
+template <typename Graph, typename T, typename WeightMap = edge_property_weight>
+bool floyd_warshall_all_pairs(const Graph &g, distance_matrix<T> &m, WeightMap w = WeightMap(),
+                              size_t num_threads = 0)
+{
+    // setup
+    fill_distance_matrix(g, m, w);
+    bool negative = false;
+    for (size_t i = 0; i < m.size() && !negative; ++i)
+        for (size_t j = 0; j < m.size() && !negative; ++j)
+            negative = m(i, j) < T();
+    if (negative)
+    {
+        weighted_edge_list<Graph, WeightMap> e(g, w);
+        std::vector<T> weights(e.weights.begin(), e.weights.end()), h;
+        if (!johnson_potentials(e, weights, h))
+            return false;
+    }
+    const size_t B = distance_matrix<T>::block;
+    const size_t stride = m.stride();
+    const size_t nb = stride / B;
+    auto tile = [&](size_t i, size_t j)
+    { return m.row(i * B) + j * B; };
+
+    for (size_t kb = 0; kb < nb; ++kb)
+    {
+        // the diagonal tile, then its row and column, then everything else
+        floyd_warshall_tile(tile(kb, kb), tile(kb, kb), tile(kb, kb), stride);
+        parallel_for_dynamic(
+            0, 2 * nb, [&](size_t, size_t x)
+            {
+                size_t b = x / 2;
+                if (b == kb)
+                    return;
+                if (x & 1)
+                    floyd_warshall_tile(tile(kb, b), tile(kb, kb), tile(kb, b), stride);
+                else
+                    floyd_warshall_tile(tile(b, kb), tile(b, kb), tile(kb, kb), stride); },
+            num_threads);
+        parallel_for_dynamic(
+            0, nb * nb, [&](size_t, size_t x)
+            {
+                size_t i = x / nb;
+                size_t j = x % nb;
+                if (i != kb && j != kb)
+                    floyd_warshall_tile(tile(i, j), tile(i, kb), tile(kb, j), stride); },
+            num_threads);
+    }
+    return true;
+}
+
+///@brief Johnson's algorithm: reweight with Bellman-Ford potentials, then one
+///       Dijkstra per source on num_threads threads. m receives the
+///       distances; returns false if g has a negative cycle.
+template <typename Graph, typename T, typename WeightMap = edge_property_weight>
+bool johnson_all_pairs(const Graph &g, distance_matrix<T> &m, WeightMap w = WeightMap(), size_t num_threads = 0)
+{
+    typedef std::pair<T, size_t> entry;
+
+    // setup
+    weighted_edge_list<Graph, WeightMap> e(g, w);
+    size_t n = e.num_vertices();
+    m.assign(e.descriptors);
+    std::vector<T> weights(e.weights.begin(), e.weights.end());
+
+    std::vector<T> h;
+    if (!johnson_potentials(e, weights, h))
+        return false;
+    for (size_t i = 0; i < e.num_edges(); ++i)
+        weights[i] = std::max(T(), weights[i] + h[e.sources[i]] - h[e.targets[i]]);
+
+    // one Dijkstra per source
+    struct scratch
+    {
+        std::vector<T> dist;
+        std::vector<size_t> touched;
+        std::vector<entry> heap;
+    };
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::vector<scratch> scratches(num_threads);
+    parallel_for_dynamic(
+        0, n, [&](size_t tid, size_t s)
+        {
+            scratch &sc = scratches[tid];
+            std::greater<entry> cmp;
+            if (sc.dist.empty())
+                sc.dist.assign(n, distance_matrix<T>::infinity());
+            sc.dist[s] = T();
+            sc.touched.push_back(s);
+            sc.heap.emplace_back(T(), s);
+            T *row = m.row(s);
+            while (!sc.heap.empty())
+            {
+                std::pop_heap(sc.heap.begin(), sc.heap.end(), cmp);
+                entry top = sc.heap.back();
+                sc.heap.pop_back();
+                size_t u = top.second;
+                if (top.first > sc.dist[u])
+                    continue;
+                row[u] = top.first + h[u] - h[s];
+                for (size_t i = e.offsets[u]; i < e.offsets[u + 1]; ++i)
+                {
+                    size_t t = e.targets[i];
+                    T nd = top.first + weights[i];
+                    if (nd < sc.dist[t])
+                    {
+                        if (sc.dist[t] == distance_matrix<T>::infinity())
+                            sc.touched.push_back(t);
+                        sc.dist[t] = nd;
+                        sc.heap.emplace_back(nd, t);
+                        std::push_heap(sc.heap.begin(), sc.heap.end(), cmp);
+                    }
+                }
+            }
+            for (size_t t : sc.touched)
+                sc.dist[t] = distance_matrix<T>::infinity();
+            sc.touched.clear(); },
+        num_threads);
+    return true;
+}
+
+#endif
@@ -0,0 +1,584 @@
+#ifndef _GRAPH_BIT_MATRIX_H_
+#define _GRAPH_BIT_MATRIX_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "graph csr.h"
+#include "graph instrumentation.h"
+#include "graph memory.h"
+#include "graph parallel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Row operations on bit rows of 64-bit words. Rows are padded to a multiple
+/// of 8 words (one 512-bit register), so the SIMD loops need no tail.
+////////////////////////////////////////////////////////////////////////////////
+
+///@brief Number of bits set in a[i] & b[i] over words words.
+inline size_t bit_row_and_count(const uint64_t *a, const uint64_t *b, size_t words)
+{
+#if defined(__AVX512VPOPCNTDQ__)
+    __m512i sum = _mm512_setzero_si512();
+    for (size_t i = 0; i < words; i += 8)
+    {
+        __m512i x = _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+    }
+    return static_cast<size_t>(_mm512_reduce_add_epi64(sum));
+#elif defined(__AVX2__)
+    // nibble lookup popcount (Mula), summed per 64-bit lane with sad
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t i = 0; i < words; i += 4)
+    {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+        __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(x, low)),
+                                    _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+    }
+    return static_cast<size_t>(_mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) +
+                               _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3));
+#else
+    size_t count = 0;
+    for (size_t i = 0; i < words; ++i)
+        count += __builtin_popcountll(a[i] & b[i]);
+    return count;
+#endif
+}
+
+///@brief dst[i] |= src[i] over words words.
+inline void bit_row_or(uint64_t *dst, const uint64_t *src, size_t words)
+{
+#if defined(__AVX512F__)
+    for (size_t i = 0; i < words; i += 8)
+        _mm512_storeu_si512(dst + i, _mm512_or_si512(_mm512_loadu_si512(dst + i), _mm512_loadu_si512(src + i)));
+#elif defined(__AVX2__)
+    for (size_t i = 0; i < words; i += 4)
+    {
+        __m256i *d = reinterpret_cast<__m256i *>(dst + i);
+        _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d),
+                                               _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i))));
+    }
+#else
+    for (size_t i = 0; i < words; ++i)
+        dst[i] |= src[i];
+#endif
+}
+
+///@brief Position of the lowest bit set in a[i] & b[i], or words * 64.
+inline size_t bit_row_first_and(const uint64_t *a, const uint64_t *b, size_t words)
+{
+    for (size_t i = 0; i < words; ++i)
+        if (uint64_t x = a[i] & b[i])
+            return i * 64 + __builtin_ctzll(x);
+    return words * 64;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// A graph stored as an n x n bit matrix, for dense graphs (above roughly one
+/// edge in 64 vertex pairs the matrix is smaller than any adjacency list).
+/// Row u of the out matrix has bit v set for an edge u -> v; the in matrix is
+/// its transpose, so in-neighbours are a row scan as well.
+///
+/// find_edge is a bit test and insert_edge/erase_edge flip two bits. Adjacency
+/// iterators scan a row a word at a time and step through the set bits with
+/// count-trailing-zeros. The vertex set is fixed when the graph is built.
+///
+/// The class models the same read-only interface as graph, graph_vector and
+/// csr_graph (handles supporting ->descriptor(), ->begin(), ->target(),
+/// ->property() ...), so graph algorithms.h runs on it unchanged. Edge
+/// properties, unless empty (no_property), take a dense n x n array.
+////////////////////////////////////////////////////////////////////////////////
+template <typename VertexProperty, typename EdgeProperty>
+class bit_matrix_graph
+{
+public:
+    /// required public types
+    typedef size_t vertex_descriptor;
+    typedef std::pair<size_t, size_t> edge_descriptor;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    class edge;
+    class edge_iterator_type;
+    class vertex;
+
+    typedef typename std::vector<vertex>::const_iterator const_vertex_iterator;
+    typedef const_vertex_iterator vertex_iterator;
+    typedef edge_iterator_type const_edge_iterator;
+    typedef edge_iterator_type edge_iterator;
+    typedef edge_iterator_type const_adj_edge_iterator;
+    typedef edge_iterator_type adj_edge_iterator;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Lightweight edge handle, returned by value from the edge iterators.
+    ////////////////////////////////////////////////////////////////////////////
+    class edge
+    {
+    public:
+        edge(const bit_matrix_graph *g, size_t s, size_t t) : m_graph(g), m_source(s), m_target(t) {}
+
+        const edge *operator->() const { return this; }
+
+        // accessors
+        vertex_descriptor source() const { return m_graph->m_descriptors[m_source]; }
+        vertex_descriptor target() const { return m_graph->m_descriptors[m_target]; }
+        edge_descriptor descriptor() const { return {source(), target()}; }
+        const EdgeProperty &property() const { return m_graph->edge_property(m_source, m_target); }
+
+        // index-based accessors
+        size_t source_index() const { return m_source; }
+        size_t target_index() const { return m_target; }
+
+    private:
+        const bit_matrix_graph *m_graph;
+        size_t m_source;
+        size_t m_target;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Iterator over the set bits of rows [row, end_row) of the out matrix.
+    /// Used both for the global edge list and for a single adjacency list.
+    ////////////////////////////////////////////////////////////////////////////
+    class edge_iterator_type
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef edge value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const edge *pointer;
+        typedef edge reference;
+
+        edge_iterator_type() : m_graph(nullptr), m_row(0), m_end_row(0), m_word(0), m_bits(0) {}
+        edge_iterator_type(const bit_matrix_graph *g, size_t row, size_t end_row)
+            : m_graph(g), m_row(row), m_end_row(end_row), m_word(0), m_bits(0)
+        {
+            if (m_row < m_end_row)
+            {
+                m_bits = m_graph->out_row(m_row)[0];
+                skip_empty();
+            }
+        }
+
+        ///@brief Positioned at the edge row -> target, which must exist.
+        edge_iterator_type(const bit_matrix_graph *g, size_t row, size_t end_row, size_t target)
+            : m_graph(g), m_row(row), m_end_row(end_row), m_word(target / 64),
+              m_bits(m_graph->out_row(row)[target / 64] & (~uint64_t(0) << (target % 64)))
+        {
+        }
+
+        edge operator*() const { return edge(m_graph, m_row, m_word * 64 + __builtin_ctzll(m_bits)); }
+        edge operator->() const { return **this; }
+
+        edge_iterator_type &operator++()
+        {
+            m_bits &= m_bits - 1;
+            skip_empty();
+            return *this;
+        }
+        edge_iterator_type operator++(int)
+        {
+            edge_iterator_type tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const edge_iterator_type &o) const
+        {
+            return m_row == o.m_row && m_word == o.m_word && m_bits == o.m_bits;
+        }
+        bool operator!=(const edge_iterator_type &o) const { return !(*this == o); }
+
+    private:
+        void skip_empty()
+        {
+            while (m_bits == 0)
+            {
+                if (++m_word == m_graph->m_words)
+                {
+                    m_word = 0;
+                    if (++m_row == m_end_row)
+                        return; // end: (end_row, 0, 0)
+                }
+                m_bits = m_graph->out_row(m_row)[m_word];
+            }
+        }
+
+        const bit_matrix_graph *m_graph;
+        size_t m_row;
+        size_t m_end_row;
+        size_t m_word;
+        uint64_t m_bits; // Bits of the current word not visited yet
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Vertex handle stored once per vertex, so find_vertex can hand out a
+    /// reference like the vertex* of the other graphs.
+    ////////////////////////////////////////////////////////////////////////////
+    class vertex
+    {
+    public:
+        vertex(const bit_matrix_graph *g, size_t i) : m_graph(g), m_index(i) {}
+
+        const vertex *operator->() const { return this; }
+
+        // iterators
+        const_adj_edge_iterator begin() const { return cbegin(); }
+        const_adj_edge_iterator cbegin() const { return const_adj_edge_iterator(m_graph, m_index, m_index + 1); }
+        const_adj_edge_iterator end() const { return cend(); }
+        const_adj_edge_iterator cend() const { return const_adj_edge_iterator(m_graph, m_index + 1, m_index + 1); }
+
+        // accessors
+        vertex_descriptor descriptor() const { return m_graph->m_descriptors[m_index]; }
+        const VertexProperty &property() const { return m_graph->vertex_property(m_index); }
+        size_t index() const { return m_index; }
+        size_t out_degree() const { return m_graph->out_degree(m_index); }
+
+    private:
+        const bit_matrix_graph *m_graph;
+        size_t m_index;
+    };
+
+    /// constructors/destructors
+    bit_matrix_graph() { resize(std::vector<vertex_descriptor>(), std::vector<VertexProperty>()); }
+
+    ///@brief n isolated vertices with descriptors 0..n-1.
+    explicit bit_matrix_graph(size_t n)
+    {
+        std::vector<vertex_descriptor> descriptors(n);
+        for (size_t i = 0; i < n; ++i)
+            descriptors[i] = i;
+        resize(std::move(descriptors), std::vector<VertexProperty>());
+    }
+
+    template <typename Graph, typename = typename std::enable_if<!std::is_arithmetic<Graph>::value>::type>
+    explicit bit_matrix_graph(const Graph &g)
+    {
+        assign(g);
+    }
+
+    bit_matrix_graph(const bit_matrix_graph &) = delete;            ///< Copy is disabled.
+    bit_matrix_graph &operator=(const bit_matrix_graph &) = delete; ///< Copy is disabled.
+
+    ///@brief Build from any graph exposing the common interface. Vertices keep
+    ///       the iteration order of g; of parallel edges the last one wins.
+    template <typename Graph>
+    void assign(const Graph &g)
+    {
+        typedef typename Graph::const_vertex_iterator graph_vertex_iterator;
+        typedef typename Graph::const_edge_iterator graph_edge_iterator;
+
+        std::vector<vertex_descriptor> descriptors;
+        std::vector<VertexProperty> vprops;
+        descriptors.reserve(g.num_vertices());
+        for (graph_vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            descriptors.push_back((*vi)->descriptor());
+            if (!vertex_properties_empty)
+                vprops.push_back((*vi)->property());
+        }
+        resize(std::move(descriptors), std::move(vprops));
+        for (graph_edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+            insert_edge((*ei)->source(), (*ei)->target(), (*ei)->property());
+    }
+
+    /// required graph operations
+
+    // iterators
+    vertex_iterator vertices_begin() const { return m_vertices.cbegin(); }
+    const_vertex_iterator vertices_cbegin() const { return m_vertices.cbegin(); }
+    vertex_iterator vertices_end() const { return m_vertices.cend(); }
+    const_vertex_iterator vertices_cend() const { return m_vertices.cend(); }
+
+    edge_iterator edges_begin() const { return edges_cbegin(); }
+    const_edge_iterator edges_cbegin() const { return const_edge_iterator(this, 0, num_vertices()); }
+    edge_iterator edges_end() const { return edges_cend(); }
+    const_edge_iterator edges_cend() const { return const_edge_iterator(this, num_vertices(), num_vertices()); }
+
+    // accessors
+    size_t num_vertices() const { return m_descriptors.size(); }
+    size_t num_edges() const { return m_num_edges; }
+
+    const_vertex_iterator find_vertex(vertex_descriptor vd) const
+    {
+        size_t i = index_of(vd);
+        GRAPH_COUNT(vertex_lookups, 1);
+        GRAPH_COUNT(vertex_probes, 1);
+        return i == npos ? m_vertices.cend() : m_vertices.cbegin() + i;
+    }
+
+    const_edge_iterator find_edge(edge_descriptor ed) const
+    {
+        size_t s = index_of(ed.first);
+        size_t t = index_of(ed.second);
+        GRAPH_COUNT(edge_lookups, 1);
+        GRAPH_COUNT(edge_probes, 1);
+        if (s == npos || t == npos || !has_edge(s, t))
+            return edges_cend();
+        return const_edge_iterator(this, s, num_vertices(), t);
+    }
+
+    // modifiers
+    ///@brief Insert sd -> td. Ignored, like erase_edge, if either endpoint is
+    ///       not a vertex of this graph.
+    edge_descriptor insert_edge(vertex_descriptor sd, vertex_descriptor td,
+                                const EdgeProperty &ep = EdgeProperty())
+    {
+        size_t s = index_of(sd);
+        size_t t = index_of(td);
+        if (s == npos || t == npos)
+            return {sd, td};
+        if (!has_edge(s, t))
+        {
+            m_out[s * m_words + t / 64] |= uint64_t(1) << (t % 64);
+            m_in[t * m_words + s / 64] |= uint64_t(1) << (s % 64);
+            ++m_num_edges;
+        }
+        if (!edge_properties_empty)
+            m_edge_properties[s * num_vertices() + t] = ep;
+        return {sd, td};
+    }
+
+    void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td,
+                                const EdgeProperty &ep = EdgeProperty())
+    {
+        insert_edge(sd, td, ep);
+        insert_edge(td, sd, ep);
+    }
+
+    void erase_edge(edge_descriptor ed)
+    {
+        size_t s = index_of(ed.first);
+        size_t t = index_of(ed.second);
+        if (s == npos || t == npos || !has_edge(s, t))
+            return;
+        m_out[s * m_words + t / 64] &= ~(uint64_t(1) << (t % 64));
+        m_in[t * m_words + s / 64] &= ~(uint64_t(1) << (s % 64));
+        --m_num_edges;
+    }
+
+    // index-based accessors for algorithms that work on dense arrays
+    size_t index_of(vertex_descriptor vd) const
+    {
+        if (m_identity)
+            return vd < m_descriptors.size() ? vd : npos;
+        auto i = m_index.find(vd);
+        return i == m_index.end() ? npos : i->second;
+    }
+    vertex_descriptor descriptor_of(size_t i) const { return m_descriptors[i]; }
+    bool has_edge(size_t s, size_t t) const { return (m_out[s * m_words + t / 64] >> (t % 64)) & 1; }
+    size_t out_degree(size_t i) const { return bit_row_and_count(out_row(i), out_row(i), m_words); }
+    size_t in_degree(size_t i) const { return bit_row_and_count(in_row(i), in_row(i), m_words); }
+    const VertexProperty &vertex_property(size_t i) const
+    {
+        if (vertex_properties_empty)
+            return m_no_vertex_property;
+        return m_vertex_properties[i];
+    }
+    const EdgeProperty &edge_property(size_t s, size_t t) const
+    {
+        if (edge_properties_empty)
+            return m_no_edge_property;
+        return m_edge_properties[s * num_vertices() + t];
+    }
+
+    // raw rows: words() 64-bit words each, bit j of the row is vertex index j
+    size_t words() const { return m_words; }
+    const uint64_t *out_row(size_t i) const { return m_out.data() + i * m_words; }
+    const uint64_t *in_row(size_t i) const { return m_in.data() + i * m_words; }
+
+    ///@brief Report the bytes held by the graph, see graph memory.h.
+    graph_memory_usage memory_usage() const
+    {
+        graph_memory_usage u;
+        account_vector(m_out, u, &graph_memory_usage::adjacency);
+        account_vector(m_in, u, &graph_memory_usage::adjacency);
+        account_vector(m_descriptors, u, &graph_memory_usage::containers);
+        account_vector(m_vertices, u, &graph_memory_usage::containers);
+        account_hash_container(m_index, u, &graph_memory_usage::containers);
+        account_vector(m_vertex_properties, u, &graph_memory_usage::properties);
+        account_vector(m_edge_properties, u, &graph_memory_usage::properties);
+        return u;
+    }
+
+private:
+    static constexpr bool vertex_properties_empty = std::is_empty<VertexProperty>::value;
+    static constexpr bool edge_properties_empty = std::is_empty<EdgeProperty>::value;
+
+    void resize(std::vector<vertex_descriptor> descriptors, std::vector<VertexProperty> vprops)
+    {
+        size_t n = descriptors.size();
+        m_descriptors = std::move(descriptors);
+        m_vertex_properties = std::move(vprops);
+        if (vertex_properties_empty)
+            std::vector<VertexProperty>().swap(m_vertex_properties);
+        else
+            m_vertex_properties.resize(n);
+        m_words = std::max<size_t>(8, (n + 511) / 512 * 8);
+        m_out.assign(n * m_words, 0);
+        m_in.assign(n * m_words, 0);
+        if (!edge_properties_empty)
+            m_edge_properties.assign(n * n, EdgeProperty());
+        m_num_edges = 0;
+
+        m_identity = true;
+        for (size_t i = 0; i < n && m_identity; ++i)
+            m_identity = m_descriptors[i] == i;
+        m_index.clear();
+        if (!m_identity)
+            for (size_t i = 0; i < n; ++i)
+                m_index.emplace(m_descriptors[i], i);
+        m_vertices.clear();
+        m_vertices.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            m_vertices.emplace_back(this, i);
+    }
+
+    bool m_identity = true;                                // Descriptors are exactly 0..n-1
+    size_t m_words = 0;                                    // Words per row
+    size_t m_num_edges = 0;                                // Bits set in m_out
+    std::vector<vertex_descriptor> m_descriptors;          // Descriptor of each vertex index
+    std::vector<VertexProperty> m_vertex_properties;       // Property of each vertex index
+    std::vector<uint64_t> m_out;                           // Row s holds the targets of s
+    std::vector<uint64_t> m_in;                            // Row t holds the sources of t
+    std::vector<EdgeProperty> m_edge_properties;           // Property of s -> t at s * n + t
+    std::unordered_map<vertex_descriptor, size_t> m_index; // Descriptor to index, unless identity
+    std::vector<vertex> m_vertices;                        // One handle per vertex
+    VertexProperty m_no_vertex_property;                   // Returned for empty property types
+    EdgeProperty m_no_edge_property;                       // Returned for empty property types
+};
+
+///@brief Number of triangles of an undirected graph (every edge stored in
+///       both directions, no self loops). Each triangle is counted once per
+///       edge u < v as |N(u) & N(v)|, one AND/popcount pass over two rows.
+template <typename VertexProperty, typename EdgeProperty>
+size_t triangle_count(const bit_matrix_graph<VertexProperty, EdgeProperty> &g, size_t num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::vector<size_t> counts(num_threads, 0);
+    parallel_for_dynamic(
+        0, g.num_vertices(), [&](size_t tid, size_t u)
+        {
+            const uint64_t *row = g.out_row(u);
+            size_t sum = 0;
+            // neighbours v > u only
+            for (size_t w = (u + 1) / 64; w < g.words(); ++w)
+            {
+                uint64_t bits = row[w];
+                if (w == (u + 1) / 64)
+                    bits &= ~uint64_t(0) << ((u + 1) % 64);
+                for (; bits; bits &= bits - 1)
+                    sum += bit_row_and_count(row, g.out_row(w * 64 + __builtin_ctzll(bits)), g.words());
+            }
+            counts[tid] += sum; },
+        num_threads, 16);
+    size_t total = 0;
+    for (size_t c : counts)
+        total += c;
+    return total / 3;
+}
+
+///@brief Breadth-first search with the same result convention as
+///       breadth_first_search: p receives the parent of every vertex, -1 for
+///       the root of each component, roots taken in vertex order. Levels are
+///       expanded word-wide, top-down (OR the rows of the frontier into the
+///       next frontier) while the frontier is smaller than the unvisited set,
+///       bottom-up (AND each unvisited in-row with the frontier) after that.
+template <typename VertexProperty, typename EdgeProperty, typename ParentMap>
+void bit_matrix_breadth_first_search(const bit_matrix_graph<VertexProperty, EdgeProperty> &g, ParentMap &p)
+{
+    GRAPH_PHASE("bit_matrix_breadth_first_search");
+
+    // setup
+    const size_t n = g.num_vertices();
+    const size_t words = g.words();
+    const size_t npos = static_cast<size_t>(-1);
+    std::vector<uint64_t> visited(words, 0), frontier(words, 0), next(words, 0);
+    std::vector<size_t> parent(n, npos);
+    size_t unvisited = n;
+
+    for (size_t root = 0; root < n; ++root)
+    {
+        if ((visited[root / 64] >> (root % 64)) & 1)
+            continue;
+        std::fill(frontier.begin(), frontier.end(), 0);
+        frontier[root / 64] |= uint64_t(1) << (root % 64);
+        visited[root / 64] |= uint64_t(1) << (root % 64);
+        size_t frontier_size = 1;
+        --unvisited;
+        GRAPH_COUNT(frontier_pushes, 1);
+        while (frontier_size)
+        {
+            GRAPH_MAX(max_frontier, frontier_size);
+            std::fill(next.begin(), next.end(), 0);
+            if (frontier_size < unvisited)
+            {
+                // top-down
+                for (size_t w = 0; w < words; ++w)
+                    for (uint64_t bits = frontier[w]; bits; bits &= bits - 1)
+                    {
+                        size_t u = w * 64 + __builtin_ctzll(bits);
+                        const uint64_t *row = g.out_row(u);
+                        GRAPH_COUNT(edges_examined, g.out_degree(u));
+                        for (size_t x = 0; x < words; ++x)
+                        {
+                            uint64_t fresh = row[x] & ~visited[x] & ~next[x];
+                            next[x] |= fresh;
+                            for (; fresh; fresh &= fresh - 1)
+                                parent[x * 64 + __builtin_ctzll(fresh)] = u;
+                        }
+                    }
+            }
+            else
+            {
+                // bottom-up
+                for (size_t w = 0; w < words; ++w)
+                {
+                    uint64_t todo = ~visited[w];
+                    if (w == (n - 1) / 64 && n % 64)
+                        todo &= (uint64_t(1) << (n % 64)) - 1;
+                    else if (w > (n - 1) / 64)
+                        todo = 0;
+                    for (; todo; todo &= todo - 1)
+                    {
+                        size_t v = w * 64 + __builtin_ctzll(todo);
+                        size_t u = bit_row_first_and(g.in_row(v), frontier.data(), words);
+                        if (u < n)
+                        {
+                            parent[v] = u;
+                            next[w] |= uint64_t(1) << (v % 64);
+                        }
+                    }
+                }
+            }
+            bit_row_or(visited.data(), next.data(), words);
+            size_t found = bit_row_and_count(next.data(), next.data(), words);
+            GRAPH_COUNT(parent_writes, found);
+            GRAPH_COUNT(frontier_pushes, found);
+            unvisited -= found;
+            frontier_size = found;
+            frontier.swap(next);
+        }
+    }
+
+    // finalize
+    p.clear();
+    for (size_t v = 0; v < n; ++v)
+        p[g.descriptor_of(v)] = parent[v] == npos ? -1 : g.descriptor_of(parent[v]);
+}
+
+#endif
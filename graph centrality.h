@@ -0,0 +1,356 @@
+#ifndef _GRAPH_CENTRALITY_H_
+#define _GRAPH_CENTRALITY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph parallel.h"
+#include "graph shortest paths.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Betweenness centrality by Brandes' algorithm.
+///
+/// For each source s one shortest path search (BFS for unit_weight, otherwise
+/// Dijkstra, which needs positive weights) counts the shortest paths sigma(v)
+/// and records the order in which vertices were settled; walking that order
+/// backwards accumulates the dependencies
+///
+///     delta(v) = sum over edges v -> w on a shortest path of
+///                sigma(v) / sigma(w) * (1 + delta(w))
+///
+/// and every delta(v), v != s, is added to the centrality of v. Sources run
+/// in parallel, each thread with its own search and dependency arrays and its
+/// own centrality accumulator, summed when a run() returns.
+///
+/// Exact mode visits every vertex once as a source. Sampling mode draws k
+/// sources uniformly with replacement and scales by n / k; by Hoeffding and a
+/// union bound over the vertices, every normalised centrality (divided by
+/// (n - 1)(n - 2)) is then within epsilon of the truth with probability at
+/// least 1 - delta once k >= ln(2n / delta) / (2 epsilon^2).
+///
+/// run(max_sources) processes a limited number of sources and can be called
+/// repeatedly; save() and load() write and read the progress (source list,
+/// position, partial sums), so a long run can be checkpointed and resumed in
+/// another process. Scores are for directed paths: if g stores each
+/// undirected edge in both directions, halve them.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph, typename WeightMap = unit_weight>
+class betweenness_centrality
+{
+public:
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef weight_type<Graph, WeightMap> distance_type;
+
+    static constexpr bool weighted = !std::is_same<WeightMap, unit_weight>::value;
+
+    betweenness_centrality(const Graph &g, WeightMap w = WeightMap())
+    {
+        typedef typename Graph::const_vertex_iterator vertex_iterator;
+
+        // setup: out-adjacency by position
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            m_index.emplace((*vi)->descriptor(), m_descriptors.size());
+            m_descriptors.push_back((*vi)->descriptor());
+        }
+        m_offsets.assign(1, 0);
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            for (auto aei = (*vi)->cbegin(); aei != (*vi)->cend(); ++aei)
+            {
+                m_targets.push_back(m_index.at((*aei)->target()));
+                if (weighted)
+                    m_weights.push_back(w(*aei));
+            }
+            m_offsets.push_back(m_targets.size());
+        }
+        exact();
+    }
+
+    betweenness_centrality(const betweenness_centrality &) = delete;            ///< Copy is disabled.
+    betweenness_centrality &operator=(const betweenness_centrality &) = delete; ///< Copy is disabled.
+
+    ///@brief Start over with every vertex as a source.
+    void exact()
+    {
+        m_sources.resize(num_vertices());
+        for (size_t v = 0; v < num_vertices(); ++v)
+            m_sources[v] = v;
+        m_sampled = false;
+        restart();
+    }
+
+    ///@brief Start over with k sources drawn uniformly with replacement.
+    void sample(size_t k, uint64_t seed = 1)
+    {
+        std::mt19937_64 rng(seed);
+        m_sources.resize(num_vertices() ? k : 0);
+        for (auto &s : m_sources)
+            s = std::uniform_int_distribution<size_t>(0, num_vertices() - 1)(rng);
+        m_sampled = true;
+        restart();
+    }
+
+    ///@brief Sources needed for an additive error of epsilon on every
+    ///       normalised centrality with probability at least 1 - delta.
+    static size_t sample_size(size_t n, double epsilon, double delta)
+    {
+        return static_cast<size_t>(std::ceil(std::log(2.0 * std::max<size_t>(n, 1) / delta) / (2 * epsilon * epsilon)));
+    }
+
+    ///@brief The epsilon that sample_size guarantees for the sources done so
+    ///       far; 0 once an exact run has finished.
+    double error_bound(double delta) const
+    {
+        if (!m_sampled && finished())
+            return 0;
+        if (m_done == 0)
+            return std::numeric_limits<double>::infinity();
+        return std::sqrt(std::log(2.0 * num_vertices() / delta) / (2.0 * m_done));
+    }
+
+    ///@brief Process up to max_sources more sources on num_threads threads.
+    ///       Returns finished().
+    bool run(size_t max_sources = std::numeric_limits<size_t>::max(), size_t num_threads = 0)
+    {
+        if (num_threads == 0)
+            num_threads = default_num_threads();
+        size_t n = num_vertices();
+        size_t end = m_done + std::min(max_sources, m_sources.size() - m_done);
+        std::vector<workspace> ws(num_threads);
+        parallel_for_dynamic(
+            m_done, end, [&](size_t tid, size_t i)
+            {
+                workspace &w = ws[tid];
+                if (w.score.empty())
+                    w.reset(n);
+                accumulate(m_sources[i], w); },
+            num_threads);
+        for (const workspace &w : ws)
+            for (size_t v = 0; v < w.score.size(); ++v)
+                m_score[v] += w.score[v];
+        m_done = end;
+        return finished();
+    }
+
+    bool finished() const { return m_done == m_sources.size(); }
+    size_t sources_done() const { return m_done; }
+    size_t num_sources() const { return m_sources.size(); }
+    size_t num_vertices() const { return m_descriptors.size(); }
+
+    ///@brief Centrality of vd; an estimate scaled to all n sources when
+    ///       sampling, valid after any number of sources.
+    double centrality(vertex_descriptor vd) const { return m_score[m_index.at(vd)] * scale(); }
+
+    ///@brief c[vd] = centrality of vd for every vertex.
+    template <typename CentralityMap>
+    void centralities(CentralityMap &c) const
+    {
+        c.clear();
+        for (size_t v = 0; v < num_vertices(); ++v)
+            c[m_descriptors[v]] = m_score[v] * scale();
+    }
+
+    ///@brief Write the progress to path (through a temporary file, so an
+    ///       interrupted save leaves the previous checkpoint intact). Returns
+    ///       false if the file cannot be written.
+    bool save(const std::string &path) const
+    {
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+            if (!os)
+                return false;
+            uint64_t header[8] = {0};
+            std::memcpy(header, "GRAPHBC1", 8);
+            header[1] = num_vertices();
+            header[2] = m_sources.size();
+            header[3] = m_done;
+            header[4] = m_sampled;
+            header[5] = weighted;
+            os.write(reinterpret_cast<const char *>(header), sizeof(header));
+            std::vector<uint64_t> descriptors(m_descriptors.begin(), m_descriptors.end());
+            std::vector<uint64_t> sources(m_sources.begin(), m_sources.end());
+            os.write(reinterpret_cast<const char *>(descriptors.data()), descriptors.size() * sizeof(uint64_t));
+            os.write(reinterpret_cast<const char *>(sources.data()), sources.size() * sizeof(uint64_t));
+            os.write(reinterpret_cast<const char *>(m_score.data()), m_score.size() * sizeof(double));
+            if (!os.flush())
+                return false;
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    ///@brief Resume from a checkpoint written by save() for the same graph
+    ///       (same vertices in the same order). Returns false, leaving the
+    ///       state unchanged, if the file is missing, has the wrong length,
+    ///       does not match or lists a source that is not a vertex.
+    bool load(const std::string &path)
+    {
+        std::ifstream is(path, std::ios::binary | std::ios::ate);
+        uint64_t size = is ? static_cast<uint64_t>(is.tellg()) : 0;
+        uint64_t header[8];
+        if (!is.seekg(0) || !is.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+            std::memcmp(header, "GRAPHBC1", 8) != 0 || header[1] != num_vertices() || header[3] > header[2] ||
+            header[5] != weighted)
+            return false;
+        // descriptors and scores take 2n words, the sources the rest
+        uint64_t words = (size - sizeof(header)) / sizeof(uint64_t);
+        if (words < 2 * header[1] || header[2] != words - 2 * header[1])
+            return false;
+        std::vector<uint64_t> descriptors(header[1]), sources(header[2]);
+        std::vector<double> score(header[1]);
+        is.read(reinterpret_cast<char *>(descriptors.data()), descriptors.size() * sizeof(uint64_t));
+        is.read(reinterpret_cast<char *>(sources.data()), sources.size() * sizeof(uint64_t));
+        is.read(reinterpret_cast<char *>(score.data()), score.size() * sizeof(double));
+        if (!is || !std::equal(descriptors.begin(), descriptors.end(), m_descriptors.begin()))
+            return false;
+        for (uint64_t s : sources)
+            if (s >= num_vertices())
+                return false;
+        m_sources.assign(sources.begin(), sources.end());
+        m_done = header[3];
+        m_sampled = header[4] != 0;
+        m_score.swap(score);
+        return true;
+    }
+
+private:
+    // per-thread search state and centrality accumulator
+    struct workspace
+    {
+        std::vector<distance_type> dist;
+        std::vector<double> sigma;
+        std::vector<double> delta;
+        std::vector<size_t> order; // settled vertices, nondecreasing distance
+        std::vector<std::pair<distance_type, size_t>> heap;
+        std::vector<double> score;
+
+        void reset(size_t n)
+        {
+            dist.assign(n, std::numeric_limits<distance_type>::max());
+            sigma.assign(n, 0);
+            delta.assign(n, 0);
+            score.assign(n, 0);
+        }
+    };
+
+    void restart()
+    {
+        m_done = 0;
+        m_score.assign(num_vertices(), 0);
+    }
+
+    double scale() const
+    {
+        return m_sampled && m_done ? static_cast<double>(num_vertices()) / m_done : 1.0;
+    }
+
+    ///@brief One source of Brandes' algorithm, added to w.score.
+    void accumulate(size_t s, workspace &w) const
+    {
+        const distance_type infinity = std::numeric_limits<distance_type>::max();
+
+        // shortest path counts
+        w.dist[s] = distance_type();
+        w.sigma[s] = 1;
+        if (!weighted)
+        {
+            w.order.push_back(s);
+            for (size_t head = 0; head < w.order.size(); ++head)
+            {
+                size_t u = w.order[head];
+                for (size_t i = m_offsets[u]; i < m_offsets[u + 1]; ++i)
+                {
+                    size_t t = m_targets[i];
+                    if (w.dist[t] == infinity)
+                    {
+                        w.dist[t] = w.dist[u] + 1;
+                        w.order.push_back(t);
+                    }
+                    if (w.dist[t] == w.dist[u] + 1)
+                        w.sigma[t] += w.sigma[u];
+                }
+            }
+        }
+        else
+        {
+            typedef std::pair<distance_type, size_t> entry;
+            std::greater<entry> cmp;
+            w.heap.emplace_back(distance_type(), s);
+            while (!w.heap.empty())
+            {
+                std::pop_heap(w.heap.begin(), w.heap.end(), cmp);
+                entry top = w.heap.back();
+                w.heap.pop_back();
+                size_t u = top.second;
+                if (top.first > w.dist[u])
+                    continue; // stale
+                w.order.push_back(u);
+                for (size_t i = m_offsets[u]; i < m_offsets[u + 1]; ++i)
+                {
+                    size_t t = m_targets[i];
+                    distance_type nd = top.first + m_weights[i];
+                    if (nd < w.dist[t])
+                    {
+                        w.dist[t] = nd;
+                        w.sigma[t] = w.sigma[u];
+                        w.heap.emplace_back(nd, t);
+                        std::push_heap(w.heap.begin(), w.heap.end(), cmp);
+                    }
+                    else if (nd == w.dist[t])
+                        w.sigma[t] += w.sigma[u];
+                }
+            }
+        }
+
+        // dependencies in reverse settling order
+        for (size_t k = w.order.size(); k-- > 0;)
+        {
+            size_t v = w.order[k];
+            double d = 0;
+            for (size_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i)
+            {
+                size_t t = m_targets[i];
+                distance_type step = weighted ? m_weights[i] : distance_type(1);
+                if (w.dist[v] + step == w.dist[t])
+                    d += w.sigma[v] / w.sigma[t] * (1 + w.delta[t]);
+            }
+            w.delta[v] = d;
+            if (v != s)
+                w.score[v] += d;
+        }
+
+        // reset only what this source touched
+        for (size_t v : w.order)
+        {
+            w.dist[v] = infinity;
+            w.sigma[v] = 0;
+            w.delta[v] = 0;
+        }
+        w.order.clear();
+    }
+
+    std::unordered_map<vertex_descriptor, size_t> m_index;
+    std::vector<vertex_descriptor> m_descriptors;
+    std::vector<size_t> m_offsets;
+    std::vector<size_t> m_targets;
+    std::vector<distance_type> m_weights; // Only for weighted graphs
+    std::vector<size_t> m_sources;        // Positions, in processing order
+    size_t m_done = 0;                    // Sources of m_sources already accumulated
+    bool m_sampled = false;
+    std::vector<double> m_score; // Raw dependency sums by position
+};
+
+#endif
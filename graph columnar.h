@@ -0,0 +1,216 @@
+#ifndef _GRAPH_COLUMNAR_H_
+#define _GRAPH_COLUMNAR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph csr.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// A set of typed property columns stored structure-of-arrays style: column I
+/// is a std::vector of the I-th type, and row r of the table is the r-th entry
+/// of every column.
+////////////////////////////////////////////////////////////////////////////////
+template <typename... Columns>
+class property_columns
+{
+public:
+    typedef std::tuple<Columns...> row_type;
+    static constexpr size_t num_columns = sizeof...(Columns);
+
+    template <size_t I>
+    using column_type = std::vector<typename std::tuple_element<I, row_type>::type>;
+
+    ///@brief Typed access to one column.
+    template <size_t I>
+    column_type<I> &column() { return std::get<I>(m_columns); }
+    template <size_t I>
+    const column_type<I> &column() const { return std::get<I>(m_columns); }
+
+    size_t size() const { return size_impl(std::index_sequence_for<Columns...>()); }
+
+    void resize(size_t n) { resize_impl(n, std::index_sequence_for<Columns...>()); }
+    void reserve(size_t n) { reserve_impl(n, std::index_sequence_for<Columns...>()); }
+
+    ///@brief Append a row given as a tuple.
+    void push_back(const row_type &r) { push_back_impl(r, std::index_sequence_for<Columns...>()); }
+
+    ///@brief Gather row i from every column. Prefer column() in hot loops.
+    row_type row(size_t i) const { return row_impl(i, std::index_sequence_for<Columns...>()); }
+
+private:
+    template <size_t... I>
+    size_t size_impl(std::index_sequence<I...>) const
+    {
+        size_t sizes[] = {0, std::get<I>(m_columns).size()...};
+        return sizeof...(I) ? sizes[1] : 0;
+    }
+    template <size_t... I>
+    void resize_impl(size_t n, std::index_sequence<I...>)
+    {
+        int dummy[] = {0, (std::get<I>(m_columns).resize(n), 0)...};
+        (void)dummy;
+    }
+    template <size_t... I>
+    void reserve_impl(size_t n, std::index_sequence<I...>)
+    {
+        int dummy[] = {0, (std::get<I>(m_columns).reserve(n), 0)...};
+        (void)dummy;
+    }
+    template <size_t... I>
+    void push_back_impl(const row_type &r, std::index_sequence<I...>)
+    {
+        int dummy[] = {0, (std::get<I>(m_columns).push_back(std::get<I>(r)), 0)...};
+        (void)dummy;
+    }
+    template <size_t... I>
+    row_type row_impl(size_t i, std::index_sequence<I...>) const
+    {
+        return row_type(std::get<I>(m_columns)[i]...);
+    }
+
+    std::tuple<std::vector<Columns>...> m_columns;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// A graph whose topology is a csr_graph without properties (offsets and
+/// target arrays only) and whose vertex and edge properties are split into
+/// columns addressed by vertex index and edge slot.
+///
+/// A traversal that never reads properties only touches the topology arrays,
+/// and e.g. a shortest-path routine reading one weight column through
+/// edge_column_map never loads any other property. Columns are writable, so
+/// per-vertex results (ranks, labels) can be stored next to the inputs.
+///
+///  - VertexColumns / EdgeColumns: property_columns<...> instantiations.
+///
+////////////////////////////////////////////////////////////////////////////////
+template <typename VertexColumns, typename EdgeColumns>
+class columnar_graph : public csr_graph<no_property, no_property>
+{
+public:
+    typedef csr_graph<no_property, no_property> topology_type;
+    typedef typename topology_type::vertex_descriptor vertex_descriptor;
+    typedef typename topology_type::edge_descriptor edge_descriptor;
+    typedef VertexColumns vertex_columns_type;
+    typedef EdgeColumns edge_columns_type;
+
+    columnar_graph() {}
+
+    ///@brief Build from any graph. vertex_split(vp) and edge_split(ep) turn a
+    ///       VertexProperty / EdgeProperty into the row tuple of the matching
+    ///       columns, e.g. [](const city &c) { return std::make_tuple(c.lat, c.lon); }.
+    ///       Vertices keep the iteration order of g and each adjacency list is
+    ///       sorted by target, like csr_graph.
+    template <typename Graph, typename VertexSplit, typename EdgeSplit>
+    void assign(const Graph &g, VertexSplit vertex_split, EdgeSplit edge_split)
+    {
+        typedef typename Graph::const_vertex_iterator graph_vertex_iterator;
+        typedef typename EdgeColumns::row_type edge_row;
+
+        // vertices and vertex columns
+        std::vector<vertex_descriptor> descriptors;
+        std::unordered_map<vertex_descriptor, size_t> index;
+        descriptors.reserve(g.num_vertices());
+        index.reserve(g.num_vertices());
+        m_vertex_columns = VertexColumns();
+        m_vertex_columns.reserve(g.num_vertices());
+        for (graph_vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            index.emplace((*vi)->descriptor(), descriptors.size());
+            descriptors.push_back((*vi)->descriptor());
+            m_vertex_columns.push_back(vertex_split((*vi)->property()));
+        }
+
+        // sorted rows and edge columns in slot order
+        std::vector<size_t> offsets(1, 0), targets;
+        std::vector<std::pair<size_t, edge_row>> row;
+        m_edge_columns = EdgeColumns();
+        m_edge_columns.reserve(g.num_edges());
+        targets.reserve(g.num_edges());
+        for (graph_vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            const auto &v = *vi;
+            row.clear();
+            for (auto aei = v->cbegin(); aei != v->cend(); ++aei)
+                row.emplace_back(index.at((*aei)->target()), edge_split((*aei)->property()));
+            std::stable_sort(row.begin(), row.end(),
+                             [](const std::pair<size_t, edge_row> &a, const std::pair<size_t, edge_row> &b)
+                             { return a.first < b.first; });
+            for (auto &e : row)
+            {
+                targets.push_back(e.first);
+                m_edge_columns.push_back(e.second);
+            }
+            offsets.push_back(targets.size());
+        }
+
+        this->assign_csr(std::move(descriptors), std::vector<no_property>(), std::move(offsets),
+                         std::move(targets), std::vector<no_property>(), false);
+    }
+
+    ///@brief The topology alone, e.g. to pass to breadth_first_search.
+    const topology_type &topology() const { return *this; }
+
+    ///@brief Typed column accessors. Vertex columns are indexed by vertex
+    ///       index (handle->index()), edge columns by edge slot (handle->slot()).
+    template <size_t I>
+    typename VertexColumns::template column_type<I> &vertex_column() { return m_vertex_columns.template column<I>(); }
+    template <size_t I>
+    const typename VertexColumns::template column_type<I> &vertex_column() const { return m_vertex_columns.template column<I>(); }
+    template <size_t I>
+    typename EdgeColumns::template column_type<I> &edge_column() { return m_edge_columns.template column<I>(); }
+    template <size_t I>
+    const typename EdgeColumns::template column_type<I> &edge_column() const { return m_edge_columns.template column<I>(); }
+
+    VertexColumns &vertex_columns() { return m_vertex_columns; }
+    const VertexColumns &vertex_columns() const { return m_vertex_columns; }
+    EdgeColumns &edge_columns() { return m_edge_columns; }
+    const EdgeColumns &edge_columns() const { return m_edge_columns; }
+
+private:
+    VertexColumns m_vertex_columns; // One row per vertex index
+    EdgeColumns m_edge_columns;     // One row per edge slot
+};
+
+///@brief Functor mapping an edge handle of a columnar_graph to its value in
+///       edge column I. Use as the weight of an algorithm so it reads that one
+///       column and nothing else.
+template <size_t I, typename ColumnarGraph>
+class edge_column_map
+{
+public:
+    typedef typename ColumnarGraph::edge_columns_type::template column_type<I>::value_type value_type;
+
+    explicit edge_column_map(const ColumnarGraph &g) : m_column(&g.template edge_column<I>()) {}
+
+    template <typename Edge>
+    const value_type &operator()(const Edge &e) const { return (*m_column)[e->slot()]; }
+
+private:
+    const typename ColumnarGraph::edge_columns_type::template column_type<I> *m_column;
+};
+
+///@brief Functor mapping a vertex handle of a columnar_graph to its value in
+///       vertex column I.
+template <size_t I, typename ColumnarGraph>
+class vertex_column_map
+{
+public:
+    typedef typename ColumnarGraph::vertex_columns_type::template column_type<I>::value_type value_type;
+
+    explicit vertex_column_map(const ColumnarGraph &g) : m_column(&g.template vertex_column<I>()) {}
+
+    template <typename Vertex>
+    const value_type &operator()(const Vertex &v) const { return (*m_column)[v->index()]; }
+
+private:
+    const typename ColumnarGraph::vertex_columns_type::template column_type<I> *m_column;
+};
+
+#endif
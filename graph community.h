@@ -0,0 +1,522 @@
+#ifndef _GRAPH_COMMUNITY_H_
+#define _GRAPH_COMMUNITY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph csr.h"
+#include "graph parallel.h"
+#include "graph shortest paths.h"
+
+// Community detection on the undirected, weighted view of a graph: every edge
+// u -> v of weight w adds w to both A(u, v) and A(v, u), so a graph that
+// stores each undirected edge in both directions just has its weights
+// doubled, which changes no modularity. Weights come from a WeightMap as in
+// graph shortest paths.h (unit_weight by default).
+//
+// Every level is a community_graph: a csr_graph over positions 0..n-1 whose
+// edge property is the weight. Rows may hold the same neighbour more than
+// once; all routines sum such entries. A vertex's self loop holds the weight
+// inside the vertex, which is how coarsening keeps intra-community weight.
+//
+// Modularity is Q = sum over communities c of in(c) / 2m - (tot(c) / 2m)^2,
+// with in(c) the weight of entries inside c, tot(c) the summed degrees in c
+// and 2m the total weight.
+//
+
+typedef csr_graph<no_property, double> community_graph;
+
+///@brief Outcome of one Louvain level.
+struct community_level
+{
+    size_t communities = 0; // Vertices of the coarsened graph
+    double modularity = 0;  // Of the partition after this level
+    size_t passes = 0;      // Local moving sweeps
+    size_t moves = 0;       // Vertices that changed community
+};
+
+///@brief Outcome of a community detection run.
+struct community_result
+{
+    std::vector<community_level> levels; // Louvain only
+    size_t communities = 0;
+    double modularity = 0;
+    size_t iterations = 0; // Louvain: levels; label propagation: sweeps
+};
+
+///@brief The undirected, weighted view of g as a community_graph.
+///       descriptors receives the descriptor of each position.
+template <typename Graph, typename WeightMap>
+void symmetric_community_graph(const Graph &g, WeightMap w, community_graph &out,
+                               std::vector<typename Graph::vertex_descriptor> &descriptors)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+
+    std::unordered_map<vertex_descriptor, size_t> index;
+    descriptors.clear();
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        index.emplace((*vi)->descriptor(), descriptors.size());
+        descriptors.push_back((*vi)->descriptor());
+    }
+    std::vector<size_t> sources, targets;
+    std::vector<double> weights;
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        size_t s = index.at((*ei)->source());
+        size_t t = index.at((*ei)->target());
+        double x = static_cast<double>(w(*ei));
+        sources.push_back(s);
+        targets.push_back(t);
+        weights.push_back(x);
+        sources.push_back(t);
+        targets.push_back(s);
+        weights.push_back(x);
+    }
+    std::vector<size_t> positions(descriptors.size());
+    for (size_t v = 0; v < positions.size(); ++v)
+        positions[v] = v;
+    out.assign_edge_list(std::move(positions), std::vector<no_property>(), sources, targets, weights);
+}
+
+///@brief Modularity of the partition comm (a community per vertex, ids below
+///       num_vertices()) of g.
+inline double community_modularity(const community_graph &g, const std::vector<size_t> &comm, size_t num_threads = 0)
+{
+    const auto &offsets = g.offsets();
+    const auto &targets = g.targets();
+    const auto &weights = g.edge_properties();
+    size_t n = g.num_vertices();
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::vector<double> inside(num_threads, 0), degree(n, 0);
+    parallel_chunks(
+        0, n, [&](size_t tid, size_t lo, size_t hi)
+        {
+            for (size_t v = lo; v < hi; ++v)
+                for (size_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                {
+                    degree[v] += weights[i];
+                    if (comm[targets[i]] == comm[v])
+                        inside[tid] += weights[i];
+                } },
+        num_threads);
+    std::vector<double> tot(n, 0);
+    double total = 0, in = 0;
+    for (size_t v = 0; v < n; ++v)
+    {
+        tot[comm[v]] += degree[v];
+        total += degree[v];
+    }
+    if (total == 0)
+        return 0;
+    for (double x : inside)
+        in += x;
+    double q = in / total;
+    for (double t : tot)
+        q -= (t / total) * (t / total);
+    return q;
+}
+
+///@brief Parallel Louvain local moving on g starting from comm (any
+///       partition, e.g. singletons). Each active vertex moves to the
+///       neighbouring community with the largest modularity gain
+///
+///           A(v, d) - k(v) tot(d) / 2m   against   A(v, c) - k(v) (tot(c) - k(v)) / 2m
+///
+///       for its own community c, using per-community degree aggregates
+///       tot() kept in atomics. Threads move vertices asynchronously; two
+///       singletons only merge towards the lower id, so they cannot swap
+///       forever. A vertex is active again only if a neighbour moved.
+///       Sweeps stop when a sweep gains less than tolerance. Returns
+///       (sweeps, moves).
+inline std::pair<size_t, size_t> louvain_local_moving(const community_graph &g, std::vector<size_t> &comm,
+                                                      size_t num_threads = 0, double tolerance = 1e-6,
+                                                      size_t max_passes = 64)
+{
+    const auto &offsets = g.offsets();
+    const auto &targets = g.targets();
+    const auto &weights = g.edge_properties();
+    size_t n = g.num_vertices();
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+
+    // setup: degrees and community aggregates
+    std::vector<double> k(n, 0);
+    double total = 0;
+    for (size_t v = 0; v < n; ++v)
+    {
+        for (size_t i = offsets[v]; i < offsets[v + 1]; ++i)
+            k[v] += weights[i];
+        total += k[v];
+    }
+    std::unique_ptr<std::atomic<double>[]> tot(new std::atomic<double>[n]);
+    std::unique_ptr<std::atomic<size_t>[]> size(new std::atomic<size_t>[n]);
+    std::unique_ptr<std::atomic<size_t>[]> c(new std::atomic<size_t>[n]);
+    std::unique_ptr<std::atomic<uint8_t>[]> active(new std::atomic<uint8_t>[n]);
+    std::unique_ptr<std::atomic<uint8_t>[]> next_active(new std::atomic<uint8_t>[n]);
+    for (size_t v = 0; v < n; ++v)
+    {
+        tot[v].store(0, std::memory_order_relaxed);
+        size[v].store(0, std::memory_order_relaxed);
+        active[v].store(1, std::memory_order_relaxed);
+        next_active[v].store(0, std::memory_order_relaxed);
+    }
+    for (size_t v = 0; v < n; ++v)
+    {
+        c[v].store(comm[v], std::memory_order_relaxed);
+        tot[comm[v]].store(tot[comm[v]].load() + k[v], std::memory_order_relaxed);
+        size[comm[v]].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (total == 0)
+        return std::make_pair(0, 0);
+    auto add = [](std::atomic<double> &a, double x)
+    {
+        double old = a.load(std::memory_order_relaxed);
+        while (!a.compare_exchange_weak(old, old + x, std::memory_order_relaxed))
+            ;
+    };
+
+    // per-thread weight towards each neighbouring community
+    std::vector<std::vector<double>> to(num_threads);
+    std::vector<std::vector<size_t>> touched(num_threads);
+    double q = community_modularity(g, comm, num_threads);
+    size_t passes = 0, moves = 0;
+    while (passes < max_passes)
+    {
+        ++passes;
+        std::atomic<size_t> moved(0);
+        parallel_for_dynamic(
+            0, n, [&](size_t tid, size_t v)
+            {
+                if (!active[v].exchange(0, std::memory_order_relaxed))
+                    return;
+                std::vector<double> &w = to[tid];
+                std::vector<size_t> &seen = touched[tid];
+                if (w.empty())
+                    w.assign(n, -1.0);
+                size_t cv = c[v].load(std::memory_order_relaxed);
+                w[cv] = 0;
+                seen.push_back(cv);
+                for (size_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                {
+                    size_t u = targets[i];
+                    if (u == v)
+                        continue;
+                    size_t cu = c[u].load(std::memory_order_relaxed);
+                    if (w[cu] < 0)
+                    {
+                        w[cu] = 0;
+                        seen.push_back(cu);
+                    }
+                    w[cu] += weights[i];
+                }
+                size_t best = cv;
+                double best_gain = w[cv] - k[v] * (tot[cv].load(std::memory_order_relaxed) - k[v]) / total;
+                for (size_t d : seen)
+                {
+                    if (d == cv)
+                        continue;
+                    double gain = w[d] - k[v] * tot[d].load(std::memory_order_relaxed) / total;
+                    if (gain > best_gain + 1e-12 || (gain >= best_gain - 1e-12 && best != cv && d < best))
+                    {
+                        best = d;
+                        best_gain = gain;
+                    }
+                }
+                for (size_t d : seen)
+                    w[d] = -1.0;
+                seen.clear();
+                if (best == cv)
+                    return;
+                if (size[cv].load(std::memory_order_relaxed) == 1 && size[best].load(std::memory_order_relaxed) == 1 && best > cv)
+                    return;
+                add(tot[cv], -k[v]);
+                add(tot[best], k[v]);
+                size[cv].fetch_sub(1, std::memory_order_relaxed);
+                size[best].fetch_add(1, std::memory_order_relaxed);
+                c[v].store(best, std::memory_order_relaxed);
+                moved.fetch_add(1, std::memory_order_relaxed);
+                for (size_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                    next_active[targets[i]].store(1, std::memory_order_relaxed); },
+            num_threads, 256);
+        for (size_t v = 0; v < n; ++v)
+        {
+            active[v].store(next_active[v].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            next_active[v].store(0, std::memory_order_relaxed);
+            comm[v] = c[v].load(std::memory_order_relaxed);
+        }
+        moves += moved.load();
+        if (moved.load() == 0)
+            break;
+        double nq = community_modularity(g, comm, num_threads);
+        if (nq - q < tolerance)
+            break;
+        q = nq;
+    }
+    return std::make_pair(passes, moves);
+}
+
+///@brief Renumber comm to [0, k) and build in out the graph of communities:
+///       one vertex per community, A'(C, D) = sum of A(u, v) over u in C and
+///       v in D, inside weight as a self loop. Returns k.
+inline size_t coarsen_communities(const community_graph &g, std::vector<size_t> &comm, community_graph &out,
+                                  size_t num_threads = 0)
+{
+    const auto &offsets = g.offsets();
+    const auto &targets = g.targets();
+    const auto &weights = g.edge_properties();
+    const size_t npos = std::numeric_limits<size_t>::max();
+    size_t n = g.num_vertices();
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+
+    // renumber and group the vertices by community
+    std::vector<size_t> id(n, npos);
+    size_t k = 0;
+    for (size_t v = 0; v < n; ++v)
+    {
+        if (id[comm[v]] == npos)
+            id[comm[v]] = k++;
+        comm[v] = id[comm[v]];
+    }
+    std::vector<size_t> first(k + 1, 0), members(n);
+    for (size_t v = 0; v < n; ++v)
+        ++first[comm[v] + 1];
+    for (size_t x = 0; x < k; ++x)
+        first[x + 1] += first[x];
+    std::vector<size_t> fill(first.begin(), first.end() - 1);
+    for (size_t v = 0; v < n; ++v)
+        members[fill[comm[v]]++] = v;
+
+    // one aggregated row per community
+    std::vector<std::vector<std::pair<size_t, double>>> rows(k);
+    std::vector<std::vector<double>> acc(num_threads);
+    std::vector<std::vector<size_t>> touched(num_threads);
+    parallel_for_dynamic(
+        0, k, [&](size_t tid, size_t x)
+        {
+            std::vector<double> &a = acc[tid];
+            std::vector<size_t> &seen = touched[tid];
+            if (a.empty())
+                a.assign(k, 0);
+            for (size_t m = first[x]; m < first[x + 1]; ++m)
+            {
+                size_t v = members[m];
+                for (size_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                {
+                    size_t y = comm[targets[i]];
+                    if (a[y] == 0)
+                        seen.push_back(y);
+                    a[y] += weights[i];
+                }
+            }
+            for (size_t y : seen)
+            {
+                rows[x].emplace_back(y, a[y]);
+                a[y] = 0;
+            }
+            seen.clear(); },
+        num_threads, 64);
+    std::vector<size_t> out_offsets(1, 0), out_targets;
+    std::vector<double> out_weights;
+    for (auto &row : rows)
+    {
+        for (auto &e : row)
+        {
+            out_targets.push_back(e.first);
+            out_weights.push_back(e.second);
+        }
+        out_offsets.push_back(out_targets.size());
+    }
+    std::vector<size_t> positions(k);
+    for (size_t x = 0; x < k; ++x)
+        positions[x] = x;
+    out.assign_csr(std::move(positions), std::vector<no_property>(), std::move(out_offsets),
+                   std::move(out_targets), std::move(out_weights));
+    return k;
+}
+
+///@brief Multilevel parallel Louvain (Blondel et al.). Each level runs
+///       louvain_local_moving from singletons, then coarsens the graph into
+///       a new community_graph with one vertex per community; levels stop
+///       when no vertex moves or modularity gains less than tolerance.
+///       c[vd] receives a community id in [0, communities).
+template <typename Graph, typename CommunityMap, typename WeightMap = unit_weight>
+community_result louvain_communities(const Graph &g, CommunityMap &c, WeightMap w = WeightMap(),
+                                     size_t num_threads = 0, double tolerance = 1e-6)
+{
+    // setup
+    community_result r;
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::unique_ptr<community_graph> level(new community_graph());
+    symmetric_community_graph(g, w, *level, descriptors);
+    size_t n = descriptors.size();
+    std::vector<size_t> assignment(n); // community of each input vertex in the current level
+    for (size_t v = 0; v < n; ++v)
+        assignment[v] = v;
+    std::vector<size_t> comm(assignment);
+    r.modularity = community_modularity(*level, comm, num_threads);
+
+    while (true)
+    {
+        size_t m = level->num_vertices();
+        comm.resize(m);
+        for (size_t x = 0; x < m; ++x)
+            comm[x] = x;
+        auto sweep = louvain_local_moving(*level, comm, num_threads, tolerance);
+        if (sweep.second == 0)
+            break;
+        std::unique_ptr<community_graph> next(new community_graph());
+        community_level l;
+        l.communities = coarsen_communities(*level, comm, *next, num_threads);
+        l.passes = sweep.first;
+        l.moves = sweep.second;
+        for (size_t &a : assignment)
+            a = comm[a];
+        level.swap(next);
+        comm.resize(l.communities);
+        for (size_t x = 0; x < l.communities; ++x)
+            comm[x] = x;
+        l.modularity = community_modularity(*level, comm, num_threads);
+        r.levels.push_back(l);
+        bool done = l.modularity - r.modularity < tolerance;
+        r.modularity = l.modularity;
+        if (done)
+            break;
+    }
+
+    // finalize
+    r.communities = level->num_vertices();
+    r.iterations = r.levels.size();
+    c.clear();
+    for (size_t v = 0; v < n; ++v)
+        c[descriptors[v]] = assignment[v];
+    return r;
+}
+
+///@brief Parallel label propagation (Raghavan et al.). Every vertex starts
+///       with its own label and repeatedly takes the label of largest total
+///       edge weight among its neighbours, keeping its own on ties. Only the
+///       frontier, the neighbours of vertices that changed label in the
+///       previous sweep, is visited. Stops when the frontier is empty or
+///       after max_iterations sweeps. seed shuffles the first sweep and
+///       picks among equally heavy foreign labels. c[vd] receives a community id in [0, communities).
+template <typename Graph, typename CommunityMap, typename WeightMap = unit_weight>
+community_result label_propagation_communities(const Graph &g, CommunityMap &c, WeightMap w = WeightMap(),
+                                               size_t num_threads = 0, size_t max_iterations = 100,
+                                               uint64_t seed = 1)
+{
+    // setup
+    community_result r;
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    community_graph level;
+    symmetric_community_graph(g, w, level, descriptors);
+    const auto &offsets = level.offsets();
+    const auto &targets = level.targets();
+    const auto &weights = level.edge_properties();
+    size_t n = descriptors.size();
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::unique_ptr<std::atomic<size_t>[]> label(new std::atomic<size_t>[n]);
+    std::unique_ptr<std::atomic<uint8_t>[]> queued(new std::atomic<uint8_t>[n]);
+    std::vector<size_t> frontier(n);
+    for (size_t v = 0; v < n; ++v)
+    {
+        label[v].store(v, std::memory_order_relaxed);
+        queued[v].store(0, std::memory_order_relaxed);
+        frontier[v] = v;
+    }
+    std::shuffle(frontier.begin(), frontier.end(), std::mt19937_64(seed));
+    std::vector<std::vector<double>> acc(num_threads);
+    std::vector<std::vector<size_t>> touched(num_threads);
+    std::vector<std::vector<size_t>> next(num_threads);
+
+    // ties between foreign labels go to a per-sweep hash of the label; a
+    // fixed order (say the smallest label) floods one label across clusters
+    uint64_t salt = 0;
+    auto tie_rank = [&salt](size_t l)
+    {
+        uint64_t x = static_cast<uint64_t>(l) ^ salt;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        return x ^ (x >> 33);
+    };
+
+    while (!frontier.empty() && r.iterations < max_iterations)
+    {
+        ++r.iterations;
+        salt = seed + 0x9e3779b97f4a7c15ULL * r.iterations;
+        parallel_for_dynamic(
+            0, frontier.size(), [&](size_t tid, size_t i)
+            {
+                size_t v = frontier[i];
+                std::vector<double> &a = acc[tid];
+                std::vector<size_t> &seen = touched[tid];
+                if (a.empty())
+                    a.assign(n, 0);
+                for (size_t j = offsets[v]; j < offsets[v + 1]; ++j)
+                {
+                    if (targets[j] == v)
+                        continue;
+                    size_t l = label[targets[j]].load(std::memory_order_relaxed);
+                    if (a[l] == 0)
+                        seen.push_back(l);
+                    a[l] += weights[j];
+                }
+                size_t own = label[v].load(std::memory_order_relaxed);
+                size_t best = own;
+                double best_weight = a[own];
+                for (size_t l : seen)
+                    if (a[l] > best_weight ||
+                        (a[l] == best_weight && best != own && tie_rank(l) < tie_rank(best)))
+                    {
+                        best = l;
+                        best_weight = a[l];
+                    }
+                for (size_t l : seen)
+                    a[l] = 0;
+                seen.clear();
+                if (best == own)
+                    return;
+                label[v].store(best, std::memory_order_relaxed);
+                for (size_t j = offsets[v]; j < offsets[v + 1]; ++j)
+                    if (!queued[targets[j]].exchange(1, std::memory_order_relaxed))
+                        next[tid].push_back(targets[j]);
+            },
+            num_threads, 256);
+        frontier.clear();
+        for (auto &part : next)
+        {
+            for (size_t v : part)
+                queued[v].store(0, std::memory_order_relaxed);
+            frontier.insert(frontier.end(), part.begin(), part.end());
+            part.clear();
+        }
+    }
+
+    // finalize: dense ids and the modularity of the labelling
+    std::vector<size_t> comm(n);
+    for (size_t v = 0; v < n; ++v)
+        comm[v] = label[v].load(std::memory_order_relaxed);
+    community_graph coarse;
+    r.communities = coarsen_communities(level, comm, coarse, num_threads);
+    r.modularity = community_modularity(level, comm, num_threads);
+    c.clear();
+    for (size_t v = 0; v < n; ++v)
+        c[descriptors[v]] = comm[v];
+    return r;
+}
+
+#endif
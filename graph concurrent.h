@@ -0,0 +1,445 @@
+#ifndef _GRAPH_CONCURRENT_H_
+#define _GRAPH_CONCURRENT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// Append-only adjacency-list graph that accepts insert_vertex and insert_edge
+/// from many threads at once without locks. It is the concurrent-ingest
+/// counterpart of graph_vector; copy_to() moves the result into any other
+/// graph once ingestion is done.
+///
+///  - Each vertex owns a chain of adjacency segments whose capacity doubles
+///    from one segment to the next. A writer reserves a position with a
+///    fetch_add on the tail segment and publishes the edge with a release
+///    store; when a segment is full the first writer to CAS in a successor
+///    wins and the others retry on it.
+///  - Edges are allocated from per-thread arenas, so the allocator is never
+///    shared between writers and edges from one thread stay contiguous.
+///  - Vertex capacity is fixed at construction; insert_vertex returns npos
+///    once it is used up. Descriptors are dense and handed out in insertion
+///    order.
+///
+/// Erasure is not supported. Iteration is exact once writers are quiescent;
+/// concurrent readers see a prefix of each adjacency list.
+////////////////////////////////////////////////////////////////////////////////
+template <typename VertexProperty, typename EdgeProperty>
+class concurrent_graph
+{
+    class vertex;
+    class edge;
+    class edge_arena;
+    struct segment;
+
+public:
+    /// required public types
+    typedef size_t vertex_descriptor;
+    typedef std::pair<size_t, size_t> edge_descriptor;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    typedef std::vector<vertex *> vertex_storage;
+    typedef typename vertex_storage::iterator vertex_iterator;
+    typedef typename vertex_storage::const_iterator const_vertex_iterator;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Walks segment chains. With a single vertex it is an adjacency iterator;
+    /// with a vertex range it visits every edge of the graph.
+    ////////////////////////////////////////////////////////////////////////////
+    class segment_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef edge *value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef edge *const *pointer;
+        typedef edge *reference;
+
+        segment_iterator() : m_graph(nullptr), m_vertex(0), m_last(0), m_segment(nullptr), m_pos(0) {}
+        segment_iterator(const concurrent_graph *g, size_t first, size_t last)
+            : m_graph(g), m_vertex(first), m_last(last), m_segment(nullptr), m_pos(0)
+        {
+            if (m_vertex < m_last)
+                m_segment = m_graph->m_vertices[m_vertex]->m_head;
+            settle();
+        }
+
+        edge *operator*() const { return m_segment->m_entries[m_pos].load(std::memory_order_acquire); }
+
+        segment_iterator &operator++()
+        {
+            ++m_pos;
+            settle();
+            return *this;
+        }
+        segment_iterator operator++(int)
+        {
+            segment_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const segment_iterator &o) const
+        {
+            return m_segment == o.m_segment && m_pos == o.m_pos;
+        }
+        bool operator!=(const segment_iterator &o) const { return !(*this == o); }
+
+    private:
+        // move forward to the next published entry, or to the end state
+        void settle()
+        {
+            while (m_segment)
+            {
+                size_t filled = std::min(m_segment->m_capacity,
+                                         m_segment->m_reserved.load(std::memory_order_acquire));
+                while (m_pos < filled && !m_segment->m_entries[m_pos].load(std::memory_order_acquire))
+                    ++m_pos; // reserved but not yet published
+                if (m_pos < filled)
+                    return;
+                m_pos = 0;
+                m_segment = m_segment->m_next.load(std::memory_order_acquire);
+                while (!m_segment && ++m_vertex < m_last)
+                    m_segment = m_graph->m_vertices[m_vertex]->m_head;
+            }
+            m_pos = 0;
+        }
+
+        const concurrent_graph *m_graph;
+        size_t m_vertex;     // Vertex whose chain is being walked
+        size_t m_last;       // One past the last vertex to walk
+        segment *m_segment;  // Current segment, null at the end
+        size_t m_pos;        // Position in the current segment
+    };
+
+    typedef segment_iterator edge_iterator;
+    typedef segment_iterator const_edge_iterator;
+    typedef segment_iterator adj_edge_iterator;
+    typedef segment_iterator const_adj_edge_iterator;
+
+    /// required constructor/destructors
+    explicit concurrent_graph(size_t vertex_capacity)
+        : m_id(next_id()), m_reserved_vd(0), m_published_vd(0),
+          m_vertices(vertex_capacity, nullptr), m_arenas(nullptr) {}
+
+    ~concurrent_graph()
+    {
+        clear();
+    }
+
+    concurrent_graph(const concurrent_graph &) = delete;
+    concurrent_graph &operator=(const concurrent_graph &) = delete;
+
+    /// required graph operations
+
+    // iterators
+    vertex_iterator vertices_begin() { return m_vertices.begin(); }
+    const_vertex_iterator vertices_cbegin() const { return m_vertices.cbegin(); }
+    vertex_iterator vertices_end() { return m_vertices.begin() + num_vertices(); }
+    const_vertex_iterator vertices_cend() const { return m_vertices.cbegin() + num_vertices(); }
+
+    edge_iterator edges_begin() const { return edges_cbegin(); }
+    const_edge_iterator edges_cbegin() const { return const_edge_iterator(this, 0, num_vertices()); }
+    edge_iterator edges_end() const { return edges_cend(); }
+    const_edge_iterator edges_cend() const { return const_edge_iterator(); }
+
+    // accessors
+    size_t capacity() const { return m_vertices.size(); }
+    size_t num_vertices() const { return m_published_vd.load(std::memory_order_acquire); }
+    size_t num_edges() const
+    {
+        size_t n = 0;
+        for (edge_arena *a = m_arenas.load(std::memory_order_acquire); a; a = a->m_next)
+            n += a->m_count.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    const_vertex_iterator find_vertex(vertex_descriptor vd) const
+    {
+        return vd < num_vertices() ? m_vertices.cbegin() + vd : vertices_cend();
+    }
+
+    const_edge_iterator find_edge(edge_descriptor ed) const
+    {
+        if (ed.first >= num_vertices())
+            return edges_cend();
+        vertex *v = m_vertices[ed.first];
+        for (auto i = v->cbegin(); i != v->cend(); ++i)
+            if ((*i)->target() == ed.second)
+                return i;
+        return edges_cend();
+    }
+
+    // modifiers, all safe to call concurrently
+
+    ///@brief Returns npos, inserting nothing, when the capacity is used up.
+    vertex_descriptor insert_vertex(const VertexProperty &vp)
+    {
+        vertex_descriptor vd = m_reserved_vd.load(std::memory_order_relaxed);
+        do
+        {
+            if (vd >= m_vertices.size())
+                return npos;
+        } while (!m_reserved_vd.compare_exchange_weak(vd, vd + 1, std::memory_order_relaxed));
+        m_vertices[vd] = new vertex(this, vd, vp);
+        // publish in descriptor order so [0, num_vertices()) is always valid
+        size_t expected = vd;
+        while (!m_published_vd.compare_exchange_weak(expected, vd + 1, std::memory_order_release,
+                                                     std::memory_order_relaxed))
+        {
+            expected = vd;
+            std::this_thread::yield();
+        }
+        return vd;
+    }
+
+    ///@brief Both endpoints must have been returned by insert_vertex already;
+    ///       otherwise nothing is inserted.
+    edge_descriptor insert_edge(vertex_descriptor sd, vertex_descriptor td,
+                                const EdgeProperty &ep)
+    {
+        size_t n = num_vertices();
+        if (sd >= n || td >= n)
+            return {sd, td};
+        edge *e = local_arena().create(sd, td, ep);
+        m_vertices[sd]->append(e);
+        return {sd, td};
+    }
+
+    void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td,
+                                const EdgeProperty &ep)
+    {
+        insert_edge(sd, td, ep);
+        insert_edge(td, sd, ep);
+    }
+
+    ///@brief Not thread safe; call only when no writer or reader is active.
+    void clear()
+    {
+        for (size_t i = 0; i < m_vertices.size(); ++i)
+        {
+            delete m_vertices[i];
+            m_vertices[i] = nullptr;
+        }
+        for (edge_arena *a = m_arenas.exchange(nullptr); a;)
+        {
+            edge_arena *next = a->m_next;
+            delete a;
+            a = next;
+        }
+        m_reserved_vd = 0;
+        m_published_vd = 0;
+        // arenas cached by threads under the old id are gone
+        m_id = next_id();
+    }
+
+    ///@brief Insert every vertex and edge into g, e.g. a graph_vector, once
+    ///       ingestion has finished. Descriptors are translated through the
+    ///       values returned by g.insert_vertex.
+    template <typename Graph>
+    void copy_to(Graph &g) const
+    {
+        std::vector<typename Graph::vertex_descriptor> map(num_vertices());
+        for (size_t i = 0; i < map.size(); ++i)
+            map[i] = g.insert_vertex(m_vertices[i]->property());
+        for (auto ei = edges_cbegin(); ei != edges_cend(); ++ei)
+            g.insert_edge(map[(*ei)->source()], map[(*ei)->target()], (*ei)->property());
+    }
+
+private:
+    static uint64_t next_id()
+    {
+        static std::atomic<uint64_t> id(0);
+        return ++id;
+    }
+
+    ///@brief Arena of the calling thread, created and linked in on first use.
+    ///       Each thread caches only the arena it used last; on a miss it looks
+    ///       for its own arena in this graph's list, so the cache never holds
+    ///       more than one entry however many graphs come and go.
+    edge_arena &local_arena()
+    {
+        thread_local uint64_t cached_id = 0;
+        thread_local edge_arena *cached = nullptr;
+        if (cached_id == m_id)
+            return *cached;
+        const std::thread::id self = std::this_thread::get_id();
+        edge_arena *a = m_arenas.load(std::memory_order_acquire);
+        while (a && a->m_owner != self)
+            a = a->m_next;
+        if (!a)
+        {
+            a = new edge_arena(self);
+            a->m_next = m_arenas.load(std::memory_order_relaxed);
+            while (!m_arenas.compare_exchange_weak(a->m_next, a, std::memory_order_release,
+                                                   std::memory_order_relaxed))
+                ;
+        }
+        cached_id = m_id;
+        cached = a;
+        return *a;
+    }
+
+    uint64_t m_id;                           // Never reused, keys the per-thread arena cache
+    std::atomic<size_t> m_reserved_vd;       // Next descriptor to hand out
+    std::atomic<size_t> m_published_vd;      // Descriptors below this are constructed
+    vertex_storage m_vertices;               // Fixed-size vertex table
+    std::atomic<edge_arena *> m_arenas;      // Lock-free list of all thread arenas
+
+    /// required internal classes
+
+    struct segment
+    {
+        explicit segment(size_t cap) : m_capacity(cap), m_reserved(0), m_next(nullptr),
+                                       m_entries(new std::atomic<edge *>[cap])
+        {
+            for (size_t i = 0; i < cap; ++i)
+                m_entries[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        const size_t m_capacity;                       // Number of entries
+        std::atomic<size_t> m_reserved;                // Positions handed out, may exceed capacity
+        std::atomic<segment *> m_next;                 // Successor, twice as large
+        std::unique_ptr<std::atomic<edge *>[]> m_entries; // Published edges
+    };
+
+    class vertex
+    {
+    public:
+        /// required constructors/destructors
+        vertex(const concurrent_graph *g, vertex_descriptor vd, const VertexProperty &v)
+            : m_graph(g), m_descriptor(vd), m_property(v), m_head(new segment(initial_capacity)), m_tail(m_head) {}
+
+        ~vertex()
+        {
+            for (segment *s = m_head; s;)
+            {
+                segment *next = s->m_next.load(std::memory_order_relaxed);
+                delete s;
+                s = next;
+            }
+        }
+
+        // iterators
+        adj_edge_iterator begin() const { return cbegin(); }
+        const_adj_edge_iterator cbegin() const { return const_adj_edge_iterator(m_graph, m_descriptor, m_descriptor + 1); }
+        adj_edge_iterator end() const { return cend(); }
+        const_adj_edge_iterator cend() const { return const_adj_edge_iterator(); }
+
+        // accessors
+        vertex_descriptor descriptor() const { return m_descriptor; }
+        VertexProperty &property() { return m_property; }
+        const VertexProperty &property() const { return m_property; }
+
+        ///@brief Lock-free append to the segment chain.
+        void append(edge *e)
+        {
+            for (;;)
+            {
+                segment *tail = m_tail.load(std::memory_order_acquire);
+                size_t pos = tail->m_reserved.fetch_add(1, std::memory_order_acq_rel);
+                if (pos < tail->m_capacity)
+                {
+                    tail->m_entries[pos].store(e, std::memory_order_release);
+                    return;
+                }
+                // full: install a successor (or adopt the one another writer won with)
+                segment *next = tail->m_next.load(std::memory_order_acquire);
+                if (!next)
+                {
+                    segment *fresh = new segment(std::min(tail->m_capacity * 2, max_capacity));
+                    if (tail->m_next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel))
+                        next = fresh;
+                    else
+                        delete fresh;
+                }
+                m_tail.compare_exchange_strong(tail, next, std::memory_order_acq_rel);
+            }
+        }
+
+    private:
+        static constexpr size_t initial_capacity = 4;
+        static constexpr size_t max_capacity = 4096;
+
+        const concurrent_graph *m_graph;
+        vertex_descriptor m_descriptor; // Unique id assigned during insertion
+        VertexProperty m_property;      // Label or weight passed during insertion
+        segment *m_head;                // First adjacency segment
+        std::atomic<segment *> m_tail;  // Segment currently receiving appends
+
+        friend class concurrent_graph;
+    };
+
+    class edge
+    {
+    public:
+        /// required constructors/destructors
+        edge(vertex_descriptor s, vertex_descriptor t,
+             const EdgeProperty &w) : m_source(s), m_target(t), m_property(w) {}
+
+        // accessors
+        vertex_descriptor source() const { return m_source; }
+        vertex_descriptor target() const { return m_target; }
+        edge_descriptor descriptor() const { return {m_source, m_target}; }
+        EdgeProperty &property() { return m_property; }
+        const EdgeProperty &property() const { return m_property; }
+
+    private:
+        vertex_descriptor m_source; // Descriptor of source vertex
+        vertex_descriptor m_target; // Descriptor of target vertex
+        EdgeProperty m_property;    // Label or weight on the edge
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Bump allocator for edges owned by a single thread.
+    ////////////////////////////////////////////////////////////////////////////
+    class edge_arena
+    {
+    public:
+        explicit edge_arena(std::thread::id owner)
+            : m_next(nullptr), m_count(0), m_owner(owner), m_used(block_size) {}
+
+        ~edge_arena()
+        {
+            std::allocator<edge> alloc;
+            for (size_t b = 0; b < m_blocks.size(); ++b)
+            {
+                size_t used = b + 1 == m_blocks.size() ? m_used : block_size;
+                for (size_t i = 0; i < used; ++i)
+                    m_blocks[b][i].~edge();
+                alloc.deallocate(m_blocks[b], block_size);
+            }
+        }
+
+        edge *create(vertex_descriptor s, vertex_descriptor t, const EdgeProperty &w)
+        {
+            if (m_used == block_size)
+            {
+                m_blocks.push_back(std::allocator<edge>().allocate(block_size));
+                m_used = 0;
+            }
+            edge *e = new (m_blocks.back() + m_used) edge(s, t, w);
+            ++m_used;
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            return e;
+        }
+
+        edge_arena *m_next;            // Next arena of the same graph
+        std::atomic<size_t> m_count;   // Edges created, read by num_edges()
+        const std::thread::id m_owner; // Only thread that allocates from it
+
+    private:
+        static constexpr size_t block_size = 4096;
+
+        std::vector<edge *> m_blocks; // Raw blocks of block_size edges
+        size_t m_used;                // Edges used in the last block
+    };
+};
+
+#endif
@@ -0,0 +1,568 @@
+#ifndef _GRAPH_CONTRACTION_HIERARCHIES_H_
+#define _GRAPH_CONTRACTION_HIERARCHIES_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph parallel.h"
+#include "graph shortest paths.h"
+
+// Contraction hierarchies (Geisberger et al.) for fast point-to-point shortest
+// path queries on a static graph with non-negative weights.
+//
+// Preprocessing contracts the vertices one by one in order of importance.
+// Contracting v removes it from the remaining graph. For every pair of
+// neighbours u -> v -> w whose shortest path must pass through v, a shortcut
+// u -> w is added that remembers v as its middle vertex. A hop-limited
+// witness search decides whether the shortcut is needed: if it finds a path
+// u -> w avoiding v that is no longer, the shortcut is skipped. Hitting the
+// hop limit only ever adds extra shortcuts, so the result stays exact.
+//
+// The contraction order comes from edge-difference priorities (shortcuts
+// added minus arcs removed, plus the number of already contracted
+// neighbours). Each round contracts an independent set of vertices whose
+// priority is a local minimum, in parallel. Witness searches of a round avoid
+// every vertex of the round, so two vertices of the same set can never rely
+// on each other as witnesses.
+//
+// The hierarchy is stored as two CSR arrays over vertex positions: upward
+// holds the arcs from each vertex to higher-ranked vertices, and downward
+// holds the arcs into each vertex from higher-ranked vertices. A query runs
+// Dijkstra upward from the source and, on the reversed downward arcs, upward
+// from the target, and stops when neither side can improve the best meeting
+// point. Shortcuts are unpacked through their middle vertices.
+//
+
+template <typename Graph, typename WeightMap = edge_property_weight>
+class contraction_hierarchy
+{
+public:
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef weight_type<Graph, WeightMap> distance_type;
+
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    ///@brief An arc of the hierarchy between vertex positions. middle is the
+    ///       contracted vertex a shortcut bypasses, npos for original edges.
+    struct arc
+    {
+        size_t to;
+        distance_type weight;
+        size_t middle;
+    };
+
+    ///@brief Counters of the preprocessing.
+    struct build_stats
+    {
+        size_t rounds = 0;           // Independent sets contracted
+        size_t shortcuts = 0;        // Shortcuts in the final hierarchy
+        size_t witness_searches = 0; // Local searches run
+        double seconds = 0;          // Wall time
+    };
+
+    contraction_hierarchy(const Graph &g, WeightMap w = WeightMap(), size_t num_threads = 0,
+                          size_t hop_limit = 5)
+        : m_hop_limit(hop_limit)
+    {
+        build(g, w, num_threads ? num_threads : default_num_threads());
+    }
+
+    contraction_hierarchy(const contraction_hierarchy &) = delete;            ///< Copy is disabled.
+    contraction_hierarchy &operator=(const contraction_hierarchy &) = delete; ///< Copy is disabled.
+
+    static distance_type infinity() { return std::numeric_limits<distance_type>::max(); }
+
+    size_t num_vertices() const { return m_descriptors.size(); }
+    size_t index_of(vertex_descriptor vd) const
+    {
+        auto i = m_index.find(vd);
+        return i == m_index.end() ? npos : i->second;
+    }
+    vertex_descriptor descriptor_of(size_t i) const { return m_descriptors[i]; }
+    size_t rank(size_t i) const { return m_rank[i]; }
+    const build_stats &stats() const { return m_stats; }
+
+    const std::vector<size_t> &upward_offsets() const { return m_up_offsets; }
+    const std::vector<arc> &upward_arcs() const { return m_up; }
+    const std::vector<size_t> &downward_offsets() const { return m_down_offsets; }
+    const std::vector<arc> &downward_arcs() const { return m_down; }
+
+    ///@brief Append to path the vertex positions of the original edges that
+    ///       the arc a -> b (with the given middle vertex) stands for,
+    ///       excluding a itself.
+    void unpack(size_t a, size_t b, size_t middle, std::vector<size_t> &path) const
+    {
+        // explicit stack of arcs still to expand, leftmost on top
+        std::vector<std::pair<std::pair<size_t, size_t>, size_t>> stack;
+        stack.push_back({{a, b}, middle});
+        while (!stack.empty())
+        {
+            auto top = stack.back();
+            stack.pop_back();
+            size_t x = top.second;
+            if (x == npos)
+            {
+                path.push_back(top.first.second);
+                continue;
+            }
+            // a -> x was a downward arc of x, x -> b an upward arc of x
+            stack.push_back({{x, top.first.second}, find_arc(m_up_offsets, m_up, x, top.first.second).middle});
+            stack.push_back({{top.first.first, x}, find_arc(m_down_offsets, m_down, x, top.first.first).middle});
+        }
+    }
+
+private:
+    // one witness search scratch per thread
+    struct witness_scratch
+    {
+        std::vector<distance_type> dist;
+        std::vector<size_t> hops;
+        std::vector<size_t> touched;
+        std::vector<std::pair<distance_type, size_t>> heap;
+    };
+
+    struct shortcut
+    {
+        size_t from;
+        size_t to;
+        distance_type weight;
+        size_t middle;
+    };
+
+    static const arc &find_arc(const std::vector<size_t> &offsets, const std::vector<arc> &arcs, size_t row, size_t to)
+    {
+        for (size_t i = offsets[row];; ++i)
+            if (arcs[i].to == to)
+                return arcs[i];
+    }
+
+    ///@brief Dijkstra from u in the remaining graph, avoiding skip and every
+    ///       vertex that is not remaining, up to limit and m_hop_limit hops.
+    void witness_search(size_t u, size_t skip, distance_type limit, witness_scratch &s) const
+    {
+        typedef std::pair<distance_type, size_t> entry;
+        std::greater<entry> cmp;
+        s.heap.clear();
+        s.dist[u] = distance_type();
+        s.hops[u] = 0;
+        s.touched.push_back(u);
+        s.heap.emplace_back(distance_type(), u);
+        while (!s.heap.empty())
+        {
+            std::pop_heap(s.heap.begin(), s.heap.end(), cmp);
+            entry top = s.heap.back();
+            s.heap.pop_back();
+            if (top.first > s.dist[top.second] || top.first > limit)
+                continue;
+            if (s.hops[top.second] >= m_hop_limit)
+                continue;
+            for (const arc &a : m_out[top.second])
+            {
+                if (a.to == skip || m_state[a.to] != remaining)
+                    continue;
+                distance_type nd = top.first + a.weight;
+                if (nd < s.dist[a.to] && nd <= limit)
+                {
+                    if (s.dist[a.to] == infinity())
+                        s.touched.push_back(a.to);
+                    s.dist[a.to] = nd;
+                    s.hops[a.to] = s.hops[top.second] + 1;
+                    s.heap.emplace_back(nd, a.to);
+                    std::push_heap(s.heap.begin(), s.heap.end(), cmp);
+                }
+            }
+        }
+    }
+
+    ///@brief Shortcuts needed to contract v (appended to out if given) and
+    ///       their count.
+    size_t contract_shortcuts(size_t v, witness_scratch &s, std::vector<shortcut> *out, size_t &searches) const
+    {
+        distance_type max_out = distance_type();
+        for (const arc &a : m_out[v])
+            max_out = std::max(max_out, a.weight);
+        size_t count = 0;
+        for (const arc &in : m_in[v])
+        {
+            ++searches;
+            witness_search(in.to, v, in.weight + max_out, s);
+            for (const arc &o : m_out[v])
+            {
+                if (o.to == in.to)
+                    continue;
+                distance_type via = in.weight + o.weight;
+                if (s.dist[o.to] > via)
+                {
+                    ++count;
+                    if (out)
+                        out->push_back({in.to, o.to, via, v});
+                }
+            }
+            for (size_t t : s.touched)
+                s.dist[t] = infinity();
+            s.touched.clear();
+        }
+        return count;
+    }
+
+    long priority(size_t v, witness_scratch &s, size_t &searches) const
+    {
+        long added = static_cast<long>(contract_shortcuts(v, s, nullptr, searches));
+        long removed = static_cast<long>(m_in[v].size() + m_out[v].size());
+        return added - removed + static_cast<long>(m_deleted[v]);
+    }
+
+    ///@brief Insert u -> w or lower its weight.
+    static void add_arc(std::vector<arc> &list, size_t to, distance_type weight, size_t middle)
+    {
+        for (arc &a : list)
+            if (a.to == to)
+            {
+                if (weight < a.weight)
+                {
+                    a.weight = weight;
+                    a.middle = middle;
+                }
+                return;
+            }
+        list.push_back({to, weight, middle});
+    }
+
+    static void remove_arc(std::vector<arc> &list, size_t to)
+    {
+        for (size_t i = 0; i < list.size(); ++i)
+            if (list[i].to == to)
+            {
+                list[i] = list.back();
+                list.pop_back();
+                return;
+            }
+    }
+
+    ///@brief Run f(tid, item) over items; witness searches vary a lot in
+    ///       cost, so the items are handed out dynamically.
+    template <typename Function>
+    static void parallel_items(const std::vector<size_t> &items, size_t num_threads, Function f)
+    {
+        parallel_for_dynamic(
+            0, items.size(), [&](size_t tid, size_t i)
+            { f(tid, items[i]); },
+            num_threads, 64);
+    }
+
+    void build(const Graph &g, WeightMap w, size_t num_threads)
+    {
+        typedef typename Graph::const_vertex_iterator vertex_iterator;
+        typedef typename Graph::const_edge_iterator edge_iterator;
+
+        // setup
+        auto start = std::chrono::steady_clock::now();
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            m_index.emplace((*vi)->descriptor(), m_descriptors.size());
+            m_descriptors.push_back((*vi)->descriptor());
+        }
+        size_t n = m_descriptors.size();
+        m_out.assign(n, std::vector<arc>());
+        m_in.assign(n, std::vector<arc>());
+        for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+        {
+            size_t s = m_index.at((*ei)->source());
+            size_t t = m_index.at((*ei)->target());
+            if (s == t)
+                continue;
+            distance_type wt = w(*ei);
+            add_arc(m_out[s], t, wt, npos);
+            add_arc(m_in[t], s, wt, npos);
+        }
+        m_state.assign(n, remaining);
+        m_deleted.assign(n, 0);
+        m_rank.assign(n, 0);
+        std::vector<long> prio(n);
+        std::vector<witness_scratch> scratch(num_threads);
+        for (auto &s : scratch)
+        {
+            s.dist.assign(n, infinity());
+            s.hops.assign(n, 0);
+        }
+        std::vector<size_t> searches(num_threads, 0);
+        std::vector<std::vector<arc>> up(n), down(n);
+
+        // initial priorities
+        std::vector<size_t> alive(n);
+        for (size_t v = 0; v < n; ++v)
+            alive[v] = v;
+        parallel_items(alive, num_threads, [&](size_t tid, size_t v)
+                       { prio[v] = priority(v, scratch[tid], searches[tid]); });
+
+        size_t next_rank = 0;
+        std::vector<size_t> set, touched;
+        std::vector<std::vector<shortcut>> shortcuts(n);
+        while (!alive.empty())
+        {
+            // independent set of local priority minima
+            auto before = [&](size_t a, size_t b)
+            { return prio[a] < prio[b] || (prio[a] == prio[b] && a < b); };
+            set.clear();
+            for (size_t v : alive)
+            {
+                bool minimum = true;
+                for (auto *list : {&m_out[v], &m_in[v]})
+                    for (const arc &a : *list)
+                        minimum = minimum && before(v, a.to);
+                if (minimum)
+                    set.push_back(v);
+            }
+            for (size_t v : set)
+                m_state[v] = in_round;
+
+            // shortcuts of the whole set, in parallel
+            parallel_items(set, num_threads, [&](size_t tid, size_t v)
+                           { contract_shortcuts(v, scratch[tid], &shortcuts[v], searches[tid]); });
+
+            // contract
+            touched.clear();
+            for (size_t v : set)
+            {
+                m_rank[v] = next_rank++;
+                up[v] = m_out[v];
+                down[v] = m_in[v];
+                for (const arc &a : m_out[v])
+                {
+                    remove_arc(m_in[a.to], v);
+                    ++m_deleted[a.to];
+                    touched.push_back(a.to);
+                }
+                for (const arc &a : m_in[v])
+                {
+                    remove_arc(m_out[a.to], v);
+                    ++m_deleted[a.to];
+                    touched.push_back(a.to);
+                }
+                std::vector<arc>().swap(m_out[v]);
+                std::vector<arc>().swap(m_in[v]);
+                m_state[v] = contracted;
+            }
+            for (size_t v : set)
+            {
+                for (const shortcut &s : shortcuts[v])
+                {
+                    add_arc(m_out[s.from], s.to, s.weight, s.middle);
+                    add_arc(m_in[s.to], s.from, s.weight, s.middle);
+                }
+                std::vector<shortcut>().swap(shortcuts[v]);
+            }
+            ++m_stats.rounds;
+
+            // refresh the priorities around the contracted vertices
+            std::sort(touched.begin(), touched.end());
+            touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+            parallel_items(touched, num_threads, [&](size_t tid, size_t v)
+                           { prio[v] = priority(v, scratch[tid], searches[tid]); });
+            alive.erase(std::remove_if(alive.begin(), alive.end(), [&](size_t v)
+                                       { return m_state[v] == contracted; }),
+                        alive.end());
+        }
+
+        // pack into CSR
+        m_up_offsets.assign(n + 1, 0);
+        m_down_offsets.assign(n + 1, 0);
+        for (size_t v = 0; v < n; ++v)
+        {
+            m_up_offsets[v + 1] = m_up_offsets[v] + up[v].size();
+            m_down_offsets[v + 1] = m_down_offsets[v] + down[v].size();
+            m_up.insert(m_up.end(), up[v].begin(), up[v].end());
+            m_down.insert(m_down.end(), down[v].begin(), down[v].end());
+        }
+        for (const arc &a : m_up)
+            m_stats.shortcuts += a.middle != npos;
+        for (const arc &a : m_down)
+            m_stats.shortcuts += a.middle != npos;
+        for (size_t s : searches)
+            m_stats.witness_searches += s;
+        std::vector<std::vector<arc>>().swap(m_out);
+        std::vector<std::vector<arc>>().swap(m_in);
+        std::vector<uint8_t>().swap(m_state);
+        std::vector<size_t>().swap(m_deleted);
+        m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    enum : uint8_t
+    {
+        remaining,
+        in_round,
+        contracted
+    };
+
+    size_t m_hop_limit;
+    std::unordered_map<vertex_descriptor, size_t> m_index;
+    std::vector<vertex_descriptor> m_descriptors;
+    std::vector<size_t> m_rank;
+    std::vector<size_t> m_up_offsets;
+    std::vector<arc> m_up;
+    std::vector<size_t> m_down_offsets;
+    std::vector<arc> m_down;
+    build_stats m_stats;
+
+    // remaining graph, only during preprocessing
+    std::vector<std::vector<arc>> m_out;
+    std::vector<std::vector<arc>> m_in;
+    std::vector<uint8_t> m_state;
+    std::vector<size_t> m_deleted; // contracted neighbours
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Query workspace over a contraction_hierarchy. Holds the per-vertex search
+/// state so repeated queries allocate nothing; use one per thread.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph, typename WeightMap = edge_property_weight>
+class ch_query
+{
+public:
+    typedef contraction_hierarchy<Graph, WeightMap> hierarchy;
+    typedef typename hierarchy::vertex_descriptor vertex_descriptor;
+    typedef typename hierarchy::distance_type distance_type;
+    typedef typename hierarchy::arc arc;
+
+    explicit ch_query(const hierarchy &ch) : m_ch(ch)
+    {
+        for (side &s : m_side)
+        {
+            s.dist.assign(ch.num_vertices(), hierarchy::infinity());
+            s.parent.assign(ch.num_vertices(), std::make_pair(hierarchy::npos, hierarchy::npos));
+        }
+    }
+
+    ///@brief Shortest path from source to target. settled counts vertices
+    ///       settled by both directions together.
+    shortest_path_result<Graph, distance_type> operator()(vertex_descriptor source, vertex_descriptor target)
+    {
+        typedef std::pair<distance_type, size_t> entry;
+        const size_t npos = hierarchy::npos;
+
+        // setup
+        shortest_path_result<Graph, distance_type> r;
+        size_t s = m_ch.index_of(source);
+        size_t t = m_ch.index_of(target);
+        if (s == npos || t == npos)
+            return r;
+        const std::vector<size_t> *offsets[2] = {&m_ch.upward_offsets(), &m_ch.downward_offsets()};
+        const std::vector<arc> *arcs[2] = {&m_ch.upward_arcs(), &m_ch.downward_arcs()};
+        reach(0, s, distance_type(), npos, npos);
+        reach(1, t, distance_type(), npos, npos);
+        distance_type best = hierarchy::infinity();
+        size_t meet = npos;
+
+        // alternate between the directions, always advancing the smaller key
+        while (true)
+        {
+            int d = -1;
+            for (int k = 0; k < 2; ++k)
+                if (!m_side[k].queue.empty() && m_side[k].queue.top().first < best &&
+                    (d < 0 || m_side[k].queue.top().first < m_side[d].queue.top().first))
+                    d = k;
+            if (d < 0)
+                break;
+            side &me = m_side[d];
+            side &other = m_side[1 - d];
+            entry top = me.queue.top();
+            me.queue.pop();
+            size_t u = top.second;
+            if (top.first > me.dist[u])
+                continue;
+            ++r.settled;
+            if (other.dist[u] != hierarchy::infinity() && top.first + other.dist[u] < best)
+            {
+                best = top.first + other.dist[u];
+                meet = u;
+            }
+            // stall on demand: a higher vertex reaches u more cheaply
+            bool stalled = false;
+            const auto &back_offsets = *offsets[1 - d];
+            const auto &back_arcs = *arcs[1 - d];
+            for (size_t i = back_offsets[u]; i < back_offsets[u + 1] && !stalled; ++i)
+                stalled = me.dist[back_arcs[i].to] != hierarchy::infinity() &&
+                          me.dist[back_arcs[i].to] + back_arcs[i].weight < top.first;
+            if (stalled)
+                continue;
+            for (size_t i = (*offsets[d])[u]; i < (*offsets[d])[u + 1]; ++i)
+            {
+                ++r.relaxed;
+                const arc &a = (*arcs[d])[i];
+                reach(d, a.to, top.first + a.weight, u, i);
+            }
+        }
+
+        // unpack
+        if (meet != npos)
+        {
+            r.found = true;
+            r.distance = best;
+            std::vector<size_t> up_chain, positions;
+            for (size_t v = meet; v != s; v = m_side[0].parent[v].first)
+                up_chain.push_back(v);
+            positions.push_back(s);
+            for (size_t i = up_chain.size(); i-- > 0;)
+            {
+                size_t v = up_chain[i];
+                const arc &a = m_ch.upward_arcs()[m_side[0].parent[v].second];
+                m_ch.unpack(m_side[0].parent[v].first, v, a.middle, positions);
+            }
+            for (size_t v = meet; v != t; v = m_side[1].parent[v].first)
+            {
+                const arc &a = m_ch.downward_arcs()[m_side[1].parent[v].second];
+                m_ch.unpack(v, m_side[1].parent[v].first, a.middle, positions);
+            }
+            for (size_t v : positions)
+                r.path.push_back(m_ch.descriptor_of(v));
+        }
+
+        // reset only what this query touched
+        for (side &sd : m_side)
+        {
+            for (size_t v : sd.touched)
+            {
+                sd.dist[v] = hierarchy::infinity();
+                sd.parent[v] = std::make_pair(npos, npos);
+            }
+            sd.touched.clear();
+            sd.queue = decltype(sd.queue)();
+        }
+        return r;
+    }
+
+private:
+    struct side
+    {
+        std::vector<distance_type> dist;
+        std::vector<std::pair<size_t, size_t>> parent; // (previous vertex, arc slot)
+        std::vector<size_t> touched;
+        std::priority_queue<std::pair<distance_type, size_t>, std::vector<std::pair<distance_type, size_t>>,
+                            std::greater<std::pair<distance_type, size_t>>>
+            queue;
+    };
+
+    void reach(int d, size_t v, distance_type dist, size_t from, size_t slot)
+    {
+        side &s = m_side[d];
+        if (dist >= s.dist[v])
+            return;
+        if (s.dist[v] == hierarchy::infinity())
+            s.touched.push_back(v);
+        s.dist[v] = dist;
+        s.parent[v] = std::make_pair(from, slot);
+        s.queue.emplace(dist, v);
+    }
+
+    const hierarchy &m_ch;
+    side m_side[2]; // forward from the source, backward from the target
+};
+
+#endif
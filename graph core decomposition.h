@@ -0,0 +1,295 @@
+#ifndef _GRAPH_CORE_DECOMPOSITION_H_
+#define _GRAPH_CORE_DECOMPOSITION_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "graph csr.h"
+#include "graph parallel.h"
+
+// k-core decomposition. The core number of a vertex is the largest k such that
+// the vertex belongs to a subgraph in which every vertex has degree >= k.
+//
+// Cores are defined on the underlying undirected simple graph: edge direction,
+// parallel edges and self loops are ignored, so a graph built with
+// insert_edge_undirected gives the usual result.
+//
+//  - CoreMap: associative container between vertex_descriptors and core
+//             numbers (size_t).
+//
+
+///@brief Dense, symmetric adjacency of g indexed by vertex position. Used by
+///       the peeling routines so they never go through find_vertex.
+template <typename Graph>
+void core_adjacency(const Graph &g,
+                    std::vector<typename Graph::vertex_descriptor> &descriptors,
+                    std::vector<std::vector<size_t>> &adj)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+
+    // setup
+    std::unordered_map<vertex_descriptor, size_t> index;
+    descriptors.clear();
+    descriptors.reserve(g.num_vertices());
+    index.reserve(g.num_vertices());
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        index.emplace((*vi)->descriptor(), descriptors.size());
+        descriptors.push_back((*vi)->descriptor());
+    }
+
+    // symmetrize
+    adj.assign(descriptors.size(), std::vector<size_t>());
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        size_t s = index.at((*ei)->source());
+        size_t t = index.at((*ei)->target());
+        if (s == t)
+            continue;
+        adj[s].push_back(t);
+        adj[t].push_back(s);
+    }
+    for (auto &a : adj)
+    {
+        std::sort(a.begin(), a.end());
+        a.erase(std::unique(a.begin(), a.end()), a.end());
+    }
+}
+
+///@brief Sequential k-core decomposition using Batagelj-Zaversnik bucket
+///       peeling. O(V + E).
+template <typename Graph, typename CoreMap>
+void core_decomposition(const Graph &g, CoreMap &core)
+{
+    // setup
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> adj;
+    core_adjacency(g, descriptors, adj);
+    size_t n = descriptors.size();
+
+    // initialize: bucket sort vertices by degree
+    size_t max_deg = 0;
+    std::vector<size_t> deg(n), pos(n), vert(n);
+    for (size_t v = 0; v < n; ++v)
+    {
+        deg[v] = adj[v].size();
+        max_deg = std::max(max_deg, deg[v]);
+    }
+    std::vector<size_t> bin(max_deg + 1, 0);
+    for (size_t v = 0; v < n; ++v)
+        ++bin[deg[v]];
+    size_t start = 0;
+    for (size_t d = 0; d <= max_deg; ++d)
+    {
+        size_t num = bin[d];
+        bin[d] = start;
+        start += num;
+    }
+    for (size_t v = 0; v < n; ++v)
+    {
+        pos[v] = bin[deg[v]]++;
+        vert[pos[v]] = v;
+    }
+    for (size_t d = max_deg; d > 0; --d)
+        bin[d] = bin[d - 1];
+    bin[0] = 0;
+
+    // peel in order of current degree
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t v = vert[i];
+        for (size_t u : adj[v])
+        {
+            if (deg[u] > deg[v])
+            {
+                // move u to the front of its bucket, then shrink the bucket
+                size_t du = deg[u];
+                size_t pu = pos[u];
+                size_t pw = bin[du];
+                size_t w = vert[pw];
+                if (u != w)
+                {
+                    pos[u] = pw;
+                    vert[pu] = w;
+                    pos[w] = pu;
+                    vert[pw] = u;
+                }
+                ++bin[du];
+                --deg[u];
+            }
+        }
+    }
+
+    core.clear();
+    for (size_t v = 0; v < n; ++v)
+        core[descriptors[v]] = deg[v];
+}
+
+///@brief Parallel k-core decomposition. Vertices are peeled level by level:
+///       every round selects all remaining vertices whose degree is at most
+///       the current level k, removes them in parallel and decrements their
+///       neighbours with atomics. The active set is compacted each round so
+///       later levels only scan surviving vertices, and empty levels are
+///       skipped by jumping k to the minimum remaining degree.
+template <typename Graph, typename CoreMap>
+void parallel_core_decomposition(const Graph &g, CoreMap &core,
+                                 size_t num_threads = 0)
+{
+    // setup
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> adj;
+    core_adjacency(g, descriptors, adj);
+    size_t n = descriptors.size();
+
+    // initialize
+    std::vector<std::atomic<size_t>> deg(n);
+    std::vector<size_t> result(n, 0);
+    std::vector<char> removed(n, 0);
+    std::vector<size_t> active(n);
+    parallel_for(
+        0, n, [&](size_t v)
+        {
+            deg[v].store(adj[v].size(), std::memory_order_relaxed);
+            active[v] = v; },
+        num_threads);
+
+    std::vector<std::vector<size_t>> local(num_threads);
+    size_t k = 0;
+    while (!active.empty())
+    {
+        // lowest remaining degree decides the next non-empty level
+        std::vector<size_t> local_min(num_threads, SIZE_MAX);
+        parallel_chunks(
+            0, active.size(), [&](size_t tid, size_t lo, size_t hi)
+            {
+                for (size_t i = lo; i < hi; ++i)
+                    local_min[tid] = std::min(local_min[tid],
+                                              deg[active[i]].load(std::memory_order_relaxed)); },
+            num_threads);
+        k = std::max(k, *std::min_element(local_min.begin(), local_min.end()));
+
+        // gather the frontier of this level
+        for (auto &l : local)
+            l.clear();
+        parallel_chunks(
+            0, active.size(), [&](size_t tid, size_t lo, size_t hi)
+            {
+                for (size_t i = lo; i < hi; ++i)
+                    if (deg[active[i]].load(std::memory_order_relaxed) <= k)
+                        local[tid].push_back(active[i]); },
+            num_threads);
+        std::vector<size_t> frontier;
+        for (auto &l : local)
+            frontier.insert(frontier.end(), l.begin(), l.end());
+
+        // peel the level; neighbours that drop to k join the same level
+        while (!frontier.empty())
+        {
+            for (size_t v : frontier)
+            {
+                removed[v] = 1;
+                result[v] = k;
+            }
+            for (auto &l : local)
+                l.clear();
+            parallel_chunks(
+                0, frontier.size(), [&](size_t tid, size_t lo, size_t hi)
+                {
+                    for (size_t i = lo; i < hi; ++i)
+                        for (size_t u : adj[frontier[i]])
+                        {
+                            if (removed[u] || deg[u].load(std::memory_order_relaxed) <= k)
+                                continue;
+                            size_t d = deg[u].fetch_sub(1, std::memory_order_relaxed);
+                            if (d == k + 1)
+                                local[tid].push_back(u);
+                            else if (d <= k)
+                                deg[u].fetch_add(1, std::memory_order_relaxed);
+                        } },
+                num_threads);
+            frontier.clear();
+            for (auto &l : local)
+                frontier.insert(frontier.end(), l.begin(), l.end());
+        }
+
+        // drop peeled vertices from the active set
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](size_t v)
+                                    { return removed[v] != 0; }),
+                     active.end());
+        ++k;
+    }
+
+    core.clear();
+    for (size_t v = 0; v < n; ++v)
+        core[descriptors[v]] = result[v];
+}
+
+///@brief Build the k-core of g into h without erasing anything from g. h is
+///       cleared first and may be any graph with clear, insert_vertex and
+///       insert_edge, or a csr_graph, which keeps the descriptors of g (see
+///       build_graph). m receives the mapping from descriptors of g to those
+///       in h for every vertex that was kept.
+template <typename Graph, typename OutGraph, typename DescriptorMap>
+void k_core_subgraph(const Graph &g, size_t k, OutGraph &h, DescriptorMap &m)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+    typedef typename std::decay<decltype((*g.vertices_cbegin())->property())>::type vertex_property;
+    typedef typename std::decay<decltype((*g.edges_cbegin())->property())>::type edge_property;
+
+    // setup
+    std::unordered_map<vertex_descriptor, size_t> core, index;
+    core_decomposition(g, core);
+    std::vector<vertex_descriptor> kept;
+    std::vector<typename OutGraph::vertex_descriptor> descriptors;
+    std::vector<vertex_property> vprops;
+    std::vector<size_t> sources, targets;
+    std::vector<edge_property> eprops;
+
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        if (core[(*vi)->descriptor()] >= k)
+        {
+            index.emplace((*vi)->descriptor(), kept.size());
+            kept.push_back((*vi)->descriptor());
+            descriptors.push_back((*vi)->descriptor());
+            vprops.push_back((*vi)->property());
+        }
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        auto s = index.find((*ei)->source());
+        auto t = index.find((*ei)->target());
+        if (s == index.end() || t == index.end())
+            continue;
+        sources.push_back(s->second);
+        targets.push_back(t->second);
+        eprops.push_back((*ei)->property());
+    }
+
+    // finalize
+    build_graph(h, descriptors, vprops, sources, targets, eprops);
+    m.clear();
+    for (size_t i = 0; i < kept.size(); ++i)
+        m[kept[i]] = descriptors[i];
+}
+
+///@brief Build the k-core of g into h, discarding the descriptor mapping.
+template <typename Graph, typename OutGraph>
+void k_core_subgraph(const Graph &g, size_t k, OutGraph &h)
+{
+    std::unordered_map<typename Graph::vertex_descriptor,
+                       typename OutGraph::vertex_descriptor>
+        m;
+    k_core_subgraph(g, k, h, m);
+}
+
+#endif
@@ -0,0 +1,449 @@
+#ifndef _GRAPH_CSR_H_
+#define _GRAPH_CSR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph instrumentation.h"
+
+///@brief Property type for graphs that carry no vertex or edge property.
+///       csr_graph stores nothing at all for empty property types.
+struct no_property
+{
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// An immutable compressed-sparse-row graph. Vertices are numbered by position
+/// (their "index") in [0, num_vertices()), the out-edges of vertex i occupy the
+/// slots [offsets()[i], offsets()[i + 1]) of targets(), and vertex and edge
+/// properties live in separate arrays addressed by index and slot.
+///
+/// The class models the same read-only interface as graph and graph_vector so
+/// that the routines in graph algorithms.h run on it unchanged: iterators
+/// dereference to handles that support ->descriptor(), ->begin(), ->target(),
+/// ->property() and so on. Vertex descriptors are kept from the source graph.
+////////////////////////////////////////////////////////////////////////////////
+template <typename VertexProperty, typename EdgeProperty>
+class csr_graph
+{
+public:
+    /// required public types
+    typedef size_t vertex_descriptor;
+    typedef std::pair<size_t, size_t> edge_descriptor;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    class edge;
+    class edge_iterator_type;
+    class vertex;
+
+    typedef typename std::vector<vertex>::const_iterator const_vertex_iterator;
+    typedef const_vertex_iterator vertex_iterator;
+    typedef edge_iterator_type const_edge_iterator;
+    typedef edge_iterator_type edge_iterator;
+    typedef edge_iterator_type const_adj_edge_iterator;
+    typedef edge_iterator_type adj_edge_iterator;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Lightweight edge handle. Returned by value from the edge iterators; the
+    /// arrow operator lets it be used like the edge* of the other graphs.
+    ////////////////////////////////////////////////////////////////////////////
+    class edge
+    {
+    public:
+        edge(const csr_graph *g, size_t slot, size_t src) : m_graph(g), m_slot(slot), m_source(src) {}
+
+        const edge *operator->() const { return this; }
+
+        // accessors
+        vertex_descriptor source() const { return m_graph->m_descriptors[m_source]; }
+        vertex_descriptor target() const { return m_graph->m_descriptors[m_graph->m_targets[m_slot]]; }
+        edge_descriptor descriptor() const { return {source(), target()}; }
+        const EdgeProperty &property() const { return m_graph->edge_property(m_slot); }
+
+        // index-based accessors
+        size_t slot() const { return m_slot; }
+        size_t source_index() const { return m_source; }
+        size_t target_index() const { return m_graph->m_targets[m_slot]; }
+
+    private:
+        const csr_graph *m_graph;
+        size_t m_slot;   // Position in targets()
+        size_t m_source; // Index of the source vertex
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Iterator over a range of edge slots. Used both for the global edge list
+    /// and for a single adjacency list; it tracks the owning source vertex as
+    /// it advances.
+    ////////////////////////////////////////////////////////////////////////////
+    class edge_iterator_type
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef edge value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const edge *pointer;
+        typedef edge reference;
+
+        edge_iterator_type() : m_graph(nullptr), m_slot(0), m_source(0) {}
+
+        ///@brief src must own slot, unless slot is one past the range. Not
+        ///       searching for it here keeps an adjacency cend() O(1) when
+        ///       many empty vertices follow.
+        edge_iterator_type(const csr_graph *g, size_t slot, size_t src) : m_graph(g), m_slot(slot), m_source(src) {}
+
+        edge operator*() const { return edge(m_graph, m_slot, m_source); }
+        edge operator->() const { return **this; }
+
+        edge_iterator_type &operator++()
+        {
+            ++m_slot;
+            skip_empty();
+            return *this;
+        }
+        edge_iterator_type operator++(int)
+        {
+            edge_iterator_type tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const edge_iterator_type &o) const { return m_slot == o.m_slot; }
+        bool operator!=(const edge_iterator_type &o) const { return m_slot != o.m_slot; }
+
+    private:
+        void skip_empty()
+        {
+            size_t n = m_graph->m_descriptors.size();
+            while (m_source < n && m_graph->m_offsets[m_source + 1] <= m_slot)
+                ++m_source;
+        }
+
+        const csr_graph *m_graph;
+        size_t m_slot;
+        size_t m_source;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Vertex handle stored once per vertex, so find_vertex can hand out a
+    /// reference like the vertex* of the other graphs.
+    ////////////////////////////////////////////////////////////////////////////
+    class vertex
+    {
+    public:
+        vertex(const csr_graph *g, size_t i) : m_graph(g), m_index(i) {}
+
+        const vertex *operator->() const { return this; }
+
+        // iterators
+        const_adj_edge_iterator begin() const { return cbegin(); }
+        const_adj_edge_iterator cbegin() const
+        {
+            return const_adj_edge_iterator(m_graph, m_graph->m_offsets[m_index], m_index);
+        }
+        const_adj_edge_iterator end() const { return cend(); }
+        const_adj_edge_iterator cend() const
+        {
+            return const_adj_edge_iterator(m_graph, m_graph->m_offsets[m_index + 1], m_index);
+        }
+
+        // accessors
+        vertex_descriptor descriptor() const { return m_graph->m_descriptors[m_index]; }
+        const VertexProperty &property() const { return m_graph->vertex_property(m_index); }
+        size_t index() const { return m_index; }
+        size_t out_degree() const { return m_graph->m_offsets[m_index + 1] - m_graph->m_offsets[m_index]; }
+
+    private:
+        const csr_graph *m_graph;
+        size_t m_index;
+    };
+
+    /// constructors/destructors
+    csr_graph() : m_identity(true), m_offsets(1, 0) {}
+
+    template <typename Graph>
+    explicit csr_graph(const Graph &g) : csr_graph()
+    {
+        assign(g);
+    }
+
+    csr_graph(const csr_graph &) = delete;            ///< Copy is disabled.
+    csr_graph &operator=(const csr_graph &) = delete; ///< Copy is disabled.
+
+    ///@brief Build from any graph exposing the common interface. Vertices keep
+    ///       the iteration order of g; every adjacency is sorted by target.
+    template <typename Graph>
+    void assign(const Graph &g)
+    {
+        typedef typename Graph::const_vertex_iterator graph_vertex_iterator;
+
+        std::vector<vertex_descriptor> descriptors;
+        std::vector<VertexProperty> vprops;
+        std::unordered_map<vertex_descriptor, size_t> index;
+        descriptors.reserve(g.num_vertices());
+        vprops.reserve(g.num_vertices());
+        index.reserve(g.num_vertices());
+        for (graph_vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            index.emplace((*vi)->descriptor(), descriptors.size());
+            descriptors.push_back((*vi)->descriptor());
+            if (!vertex_properties_empty)
+                vprops.push_back((*vi)->property());
+        }
+
+        std::vector<size_t> offsets(1, 0), targets;
+        std::vector<EdgeProperty> eprops;
+        offsets.reserve(descriptors.size() + 1);
+        targets.reserve(g.num_edges());
+        eprops.reserve(g.num_edges());
+        for (graph_vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            const auto &v = *vi;
+            for (auto aei = v->cbegin(); aei != v->cend(); ++aei)
+            {
+                targets.push_back(index.at((*aei)->target()));
+                if (!edge_properties_empty)
+                    eprops.push_back((*aei)->property());
+            }
+            offsets.push_back(targets.size());
+        }
+        assign_csr(std::move(descriptors), std::move(vprops), std::move(offsets),
+                   std::move(targets), std::move(eprops));
+    }
+
+    ///@brief Take ownership of ready-made CSR arrays. targets hold vertex
+    ///       indices, not descriptors. Rows are sorted by target unless
+    ///       sort_rows is false, in which case they must already be sorted
+    ///       for find_edge to work.
+    void assign_csr(std::vector<vertex_descriptor> descriptors,
+                    std::vector<VertexProperty> vprops,
+                    std::vector<size_t> offsets,
+                    std::vector<size_t> targets,
+                    std::vector<EdgeProperty> eprops,
+                    bool sort_rows = true)
+    {
+        m_descriptors = std::move(descriptors);
+        m_vertex_properties = std::move(vprops);
+        m_offsets = std::move(offsets);
+        m_targets = std::move(targets);
+        m_edge_properties = std::move(eprops);
+        if (vertex_properties_empty)
+            std::vector<VertexProperty>().swap(m_vertex_properties);
+        else
+            m_vertex_properties.resize(m_descriptors.size());
+        if (edge_properties_empty)
+            std::vector<EdgeProperty>().swap(m_edge_properties);
+        else
+            m_edge_properties.resize(m_targets.size());
+        if (sort_rows)
+            sort_adjacency();
+        build_index();
+    }
+
+    ///@brief Build from an edge list given as parallel arrays of source index,
+    ///       target index and property. Uses a counting sort on the source.
+    void assign_edge_list(std::vector<vertex_descriptor> descriptors,
+                          std::vector<VertexProperty> vprops,
+                          const std::vector<size_t> &sources,
+                          const std::vector<size_t> &targets,
+                          const std::vector<EdgeProperty> &eprops)
+    {
+        size_t n = descriptors.size();
+        std::vector<size_t> offsets(n + 1, 0);
+        for (size_t s : sources)
+            ++offsets[s + 1];
+        for (size_t i = 0; i < n; ++i)
+            offsets[i + 1] += offsets[i];
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        std::vector<size_t> t(targets.size());
+        std::vector<EdgeProperty> p(targets.size());
+        for (size_t e = 0; e < sources.size(); ++e)
+        {
+            size_t slot = cursor[sources[e]]++;
+            t[slot] = targets[e];
+            if (e < eprops.size() && !edge_properties_empty)
+                p[slot] = eprops[e];
+        }
+        assign_csr(std::move(descriptors), std::move(vprops), std::move(offsets),
+                   std::move(t), std::move(p));
+    }
+
+    /// required graph operations
+
+    // iterators
+    vertex_iterator vertices_begin() const { return m_vertices.cbegin(); }
+    const_vertex_iterator vertices_cbegin() const { return m_vertices.cbegin(); }
+    vertex_iterator vertices_end() const { return m_vertices.cend(); }
+    const_vertex_iterator vertices_cend() const { return m_vertices.cend(); }
+
+    edge_iterator edges_begin() const { return edges_cbegin(); }
+    const_edge_iterator edges_cbegin() const
+    {
+        // the owner of slot 0 is the last vertex whose edges start there
+        size_t src = std::upper_bound(m_offsets.begin(), m_offsets.end(), 0) - m_offsets.begin() - 1;
+        return const_edge_iterator(this, 0, src);
+    }
+    edge_iterator edges_end() const { return edges_cend(); }
+    const_edge_iterator edges_cend() const
+    {
+        return const_edge_iterator(this, m_targets.size(), m_descriptors.size());
+    }
+
+    // accessors
+    size_t num_vertices() const { return m_descriptors.size(); }
+    size_t num_edges() const { return m_targets.size(); }
+
+    const_vertex_iterator find_vertex(vertex_descriptor vd) const
+    {
+        size_t i = index_of(vd);
+        GRAPH_COUNT(vertex_lookups, 1);
+        GRAPH_COUNT(vertex_probes, 1);
+        return i == npos ? m_vertices.cend() : m_vertices.cbegin() + i;
+    }
+
+    const_edge_iterator find_edge(edge_descriptor ed) const
+    {
+        size_t s = index_of(ed.first);
+        size_t t = index_of(ed.second);
+        if (s == npos || t == npos)
+            return edges_cend();
+        auto first = m_targets.begin() + m_offsets[s];
+        auto last = m_targets.begin() + m_offsets[s + 1];
+        auto i = std::lower_bound(first, last, t);
+        GRAPH_COUNT(edge_lookups, 1);
+        GRAPH_COUNT(edge_probes, graph_instrumentation::binary_search_probes(last - first));
+        if (i == last || *i != t)
+            return edges_cend();
+        return const_edge_iterator(this, i - m_targets.begin(), s);
+    }
+
+    // index-based accessors for algorithms that work on dense arrays
+    size_t index_of(vertex_descriptor vd) const
+    {
+        if (m_identity)
+            return vd < m_descriptors.size() ? vd : npos;
+        auto i = m_index.find(vd);
+        return i == m_index.end() ? npos : i->second;
+    }
+    vertex_descriptor descriptor_of(size_t i) const { return m_descriptors[i]; }
+    size_t out_degree(size_t i) const { return m_offsets[i + 1] - m_offsets[i]; }
+    const VertexProperty &vertex_property(size_t i) const
+    {
+        if (vertex_properties_empty)
+            return m_no_vertex_property;
+        return m_vertex_properties[i];
+    }
+    const EdgeProperty &edge_property(size_t slot) const
+    {
+        if (edge_properties_empty)
+            return m_no_edge_property;
+        return m_edge_properties[slot];
+    }
+
+    const std::vector<vertex_descriptor> &descriptors() const { return m_descriptors; }
+    const std::vector<size_t> &offsets() const { return m_offsets; }
+    const std::vector<size_t> &targets() const { return m_targets; }
+    const std::vector<VertexProperty> &vertex_properties() const { return m_vertex_properties; }
+    const std::vector<EdgeProperty> &edge_properties() const { return m_edge_properties; }
+
+protected:
+    static constexpr bool vertex_properties_empty = std::is_empty<VertexProperty>::value;
+    static constexpr bool edge_properties_empty = std::is_empty<EdgeProperty>::value;
+
+    void sort_adjacency()
+    {
+        std::vector<size_t> perm;
+        std::vector<size_t> t;
+        std::vector<EdgeProperty> p;
+        for (size_t i = 0; i + 1 < m_offsets.size(); ++i)
+        {
+            auto first = m_targets.begin() + m_offsets[i];
+            auto last = m_targets.begin() + m_offsets[i + 1];
+            if (std::is_sorted(first, last))
+                continue;
+            size_t deg = last - first;
+            perm.resize(deg);
+            for (size_t j = 0; j < deg; ++j)
+                perm[j] = m_offsets[i] + j;
+            std::stable_sort(perm.begin(), perm.end(), [&](size_t a, size_t b)
+                             { return m_targets[a] < m_targets[b]; });
+            t.clear();
+            p.clear();
+            for (size_t j : perm)
+            {
+                t.push_back(m_targets[j]);
+                if (!edge_properties_empty)
+                    p.push_back(std::move(m_edge_properties[j]));
+            }
+            std::copy(t.begin(), t.end(), first);
+            if (!edge_properties_empty)
+                std::move(p.begin(), p.end(), m_edge_properties.begin() + m_offsets[i]);
+        }
+    }
+
+    void build_index()
+    {
+        m_identity = true;
+        for (size_t i = 0; i < m_descriptors.size() && m_identity; ++i)
+            m_identity = m_descriptors[i] == i;
+        m_index.clear();
+        if (!m_identity)
+        {
+            m_index.reserve(m_descriptors.size());
+            for (size_t i = 0; i < m_descriptors.size(); ++i)
+                m_index.emplace(m_descriptors[i], i);
+        }
+        m_vertices.clear();
+        m_vertices.reserve(m_descriptors.size());
+        for (size_t i = 0; i < m_descriptors.size(); ++i)
+            m_vertices.emplace_back(this, i);
+    }
+
+    bool m_identity;                                         // Descriptors are exactly 0..n-1
+    std::vector<vertex_descriptor> m_descriptors;            // Descriptor of each vertex index
+    std::vector<VertexProperty> m_vertex_properties;         // Property of each vertex index
+    std::vector<size_t> m_offsets;                           // Row starts, size num_vertices() + 1
+    std::vector<size_t> m_targets;                           // Target index of each edge slot
+    std::vector<EdgeProperty> m_edge_properties;             // Property of each edge slot
+    std::unordered_map<vertex_descriptor, size_t> m_index;   // Descriptor to index, unless identity
+    std::vector<vertex> m_vertices;                          // One handle per vertex
+    VertexProperty m_no_vertex_property;                     // Returned for empty property types
+    EdgeProperty m_no_edge_property;                         // Returned for empty property types
+};
+
+///@brief Fill h, which is cleared first, with vertices and edges given by
+///       position: vertex i has property vprops[i], edge e runs from
+///       sources[e] to targets[e] with property eprops[e]. descriptors holds
+///       the descriptor wanted for each vertex; graphs that hand out their
+///       own through insert_vertex overwrite it with those. This is how the
+///       subgraph builders write either to csr_graph or to a mutable graph.
+template <typename Graph, typename VP, typename EP>
+void build_graph(Graph &h, std::vector<typename Graph::vertex_descriptor> &descriptors,
+                 const std::vector<VP> &vprops, const std::vector<size_t> &sources,
+                 const std::vector<size_t> &targets, const std::vector<EP> &eprops)
+{
+    h.clear();
+    descriptors.resize(vprops.size());
+    for (size_t i = 0; i < vprops.size(); ++i)
+        descriptors[i] = h.insert_vertex(vprops[i]);
+    for (size_t e = 0; e < sources.size(); ++e)
+        h.insert_edge(descriptors[sources[e]], descriptors[targets[e]], eprops[e]);
+}
+
+///@brief csr_graph version of build_graph: one counting sort, descriptors
+///       kept as given.
+template <typename VertexProperty, typename EdgeProperty>
+void build_graph(csr_graph<VertexProperty, EdgeProperty> &h, std::vector<size_t> &descriptors,
+                 const std::vector<VertexProperty> &vprops, const std::vector<size_t> &sources,
+                 const std::vector<size_t> &targets, const std::vector<EdgeProperty> &eprops)
+{
+    h.assign_edge_list(descriptors, vprops, sources, targets, eprops);
+}
+
+#endif
@@ -0,0 +1,962 @@
+#ifndef _GRAPH_DISTRIBUTED_BFS_H_
+#define _GRAPH_DISTRIBUTED_BFS_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "graph partition.h"
+
+// Breadth-first search over a partitioned graph, run by one worker process
+// per part on a single Linux machine.
+//
+// Each worker owns the vertices of its part and the out edges of those
+// vertices. The search proceeds in synchronous rounds. A worker expands its
+// share of the frontier, sends the labels it offers to vertices of other parts
+// to their owners, and the owners settle them at the end of the round. All
+// communication goes through a Transport:
+//
+//  - rank() / size(): this worker's id and the number of workers.
+//  - attach(rank): called once in every worker after fork().
+//  - exchange(out, in): collective all-to-all. out[r] is delivered to worker
+//    r, and in[r] receives what worker r sent to this one, in[rank()]
+//    included. Returns false if the exchange could not be completed.
+//  - bytes_sent(): payload bytes this worker has sent to other workers.
+//
+// Two transports are provided: shared_memory_transport (anonymous shared
+// mapping plus a process-shared barrier) and socket_transport (one Unix
+// domain socket pair per pair of workers).
+//
+// Messages for a destination are aggregated per round: one message per
+// destination, one entry per target vertex carrying the smallest label offered
+// to it. The target set is sent either as delta-coded indices or as a bitmap
+// over the destination's vertices, whichever is smaller.
+//
+// The caller forks one worker per part and only supervises them. A worker
+// that fails exits with a nonzero status; the caller then kills the other
+// workers, which would otherwise wait for it forever, and reports the search
+// as failed.
+//
+// The serial breadth_first_search starts a search from each vertex not yet
+// reached, in the vertex order of g. Its root for v is therefore the first
+// vertex in that order from which v is reachable, and v's depth is its
+// distance from that root. Here all searches run in one multi-source pass
+// with a label (root position, depth, parent) per vertex: a vertex whose
+// label drops offers (root, depth + 1) to its out neighbours, and every
+// vertex keeps the smallest label offered. Vertices that no earlier root has
+// claimed are seeded as roots in growing batches, so a search started too
+// early is simply overrun by the earlier root that reaches it. When no label
+// drops any more, every vertex has the root and depth of the serial search;
+// the number of rounds follows the depth of the trees rather than the number
+// of components. Roots get parent -1. Where the serial search takes the
+// parent that discovered v first, this one takes the smallest descriptor among
+// the in neighbours one level up, so the depths match the serial search but
+// the tree itself can differ.
+//
+
+///@brief Append v as a LEB128 varint.
+inline void put_varint(std::vector<uint8_t> &buf, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        buf.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    buf.push_back(static_cast<uint8_t>(v));
+}
+
+///@brief Decode one LEB128 varint from [p, end) into v and advance p past it.
+///       Returns false if the input ends early or the value is too long.
+inline bool get_varint(const uint8_t *&p, const uint8_t *end, uint64_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64 && p != end; shift += 7)
+    {
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// All-to-all exchange through an anonymous MAP_SHARED mapping created before
+/// fork(). Every (sender, receiver) pair has a fixed-size slot; larger
+/// messages are sent in several rounds, and a process-shared barrier separates
+/// writing from reading.
+////////////////////////////////////////////////////////////////////////////////
+class shared_memory_transport
+{
+public:
+    shared_memory_transport(size_t size, size_t slot_bytes = 1 << 16)
+        : m_size(size), m_rank(0), m_slot_bytes(slot_bytes), m_bytes_sent(0)
+    {
+        m_length = sizeof(pthread_barrier_t) + m_size * m_size * (sizeof(uint64_t) + m_slot_bytes);
+        void *p = mmap(nullptr, m_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        m_base = p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+        if (!m_base)
+            return;
+        pthread_barrierattr_t attr;
+        pthread_barrierattr_init(&attr);
+        pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_barrier_init(barrier(), &attr, static_cast<unsigned>(m_size));
+        pthread_barrierattr_destroy(&attr);
+    }
+    ///@brief The barrier is not destroyed: after a failed search it may still
+    ///       count workers that were killed while waiting, and destroying it
+    ///       would block. All of its state lives in the mapping.
+    ~shared_memory_transport()
+    {
+        if (m_base)
+            munmap(m_base, m_length);
+    }
+    shared_memory_transport(const shared_memory_transport &) = delete;            ///< Copy is disabled.
+    shared_memory_transport &operator=(const shared_memory_transport &) = delete; ///< Copy is disabled.
+
+    bool is_open() const { return m_base != nullptr; }
+    size_t rank() const { return m_rank; }
+    size_t size() const { return m_size; }
+    uint64_t bytes_sent() const { return m_bytes_sent; }
+    void attach(size_t rank) { m_rank = rank; }
+
+    bool exchange(const std::vector<std::vector<uint8_t>> &out, std::vector<std::vector<uint8_t>> &in)
+    {
+        const uint64_t more = uint64_t(1) << 63;
+        in.assign(m_size, std::vector<uint8_t>());
+        std::vector<size_t> sent(m_size, 0);
+        for (size_t r = 0; r < m_size; ++r)
+            if (r != m_rank)
+                m_bytes_sent += out[r].size();
+        for (;;)
+        {
+            // write this round's piece of every message
+            for (size_t r = 0; r < m_size; ++r)
+            {
+                size_t n = std::min(m_slot_bytes, out[r].size() - sent[r]);
+                if (n)
+                    std::memcpy(slot(m_rank, r), out[r].data() + sent[r], n);
+                sent[r] += n;
+                *header(m_rank, r) = n | (sent[r] < out[r].size() ? more : 0);
+            }
+            if (!wait())
+                return false;
+
+            // read, and agree on whether anyone still has data
+            bool again = false;
+            for (size_t r = 0; r < m_size; ++r)
+            {
+                uint64_t h = *header(r, m_rank);
+                const uint8_t *s = slot(r, m_rank);
+                in[r].insert(in[r].end(), s, s + (h & ~more));
+            }
+            for (size_t i = 0; i < m_size * m_size; ++i)
+                again |= (reinterpret_cast<uint64_t *>(m_base + sizeof(pthread_barrier_t))[i] & more) != 0;
+            if (!wait())
+                return false;
+            if (!again)
+                return true;
+        }
+    }
+
+private:
+    pthread_barrier_t *barrier() { return reinterpret_cast<pthread_barrier_t *>(m_base); }
+    bool wait()
+    {
+        int rc = pthread_barrier_wait(barrier());
+        return rc == 0 || rc == PTHREAD_BARRIER_SERIAL_THREAD;
+    }
+    uint64_t *header(size_t from, size_t to)
+    {
+        return reinterpret_cast<uint64_t *>(m_base + sizeof(pthread_barrier_t)) + from * m_size + to;
+    }
+    uint8_t *slot(size_t from, size_t to)
+    {
+        return m_base + sizeof(pthread_barrier_t) + m_size * m_size * sizeof(uint64_t) +
+               (from * m_size + to) * m_slot_bytes;
+    }
+
+    size_t m_size;
+    size_t m_rank;
+    size_t m_slot_bytes;
+    uint64_t m_bytes_sent;
+    size_t m_length;
+    uint8_t *m_base;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// All-to-all exchange over Unix domain stream sockets, one socketpair per
+/// pair of workers created before fork(). Messages are length prefixed, and
+/// sends and receives are interleaved with poll() so that no pair of workers
+/// can block each other on full socket buffers.
+////////////////////////////////////////////////////////////////////////////////
+class socket_transport
+{
+public:
+    explicit socket_transport(size_t size) : m_size(size), m_rank(0), m_bytes_sent(0), m_open(true)
+    {
+        m_fds.assign(m_size * m_size, -1);
+        for (size_t i = 0; i < m_size; ++i)
+            for (size_t j = i + 1; j < m_size; ++j)
+            {
+                int sv[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+                {
+                    m_open = false;
+                    return;
+                }
+                m_fds[i * m_size + j] = sv[0];
+                m_fds[j * m_size + i] = sv[1];
+            }
+    }
+    ~socket_transport()
+    {
+        for (int fd : m_fds)
+            if (fd != -1)
+                ::close(fd);
+    }
+    socket_transport(const socket_transport &) = delete;            ///< Copy is disabled.
+    socket_transport &operator=(const socket_transport &) = delete; ///< Copy is disabled.
+
+    bool is_open() const { return m_open; }
+    size_t rank() const { return m_rank; }
+    size_t size() const { return m_size; }
+    uint64_t bytes_sent() const { return m_bytes_sent; }
+
+    ///@brief Keep only this worker's ends of the socket pairs.
+    void attach(size_t rank)
+    {
+        m_rank = rank;
+        for (size_t i = 0; i < m_fds.size(); ++i)
+            if (i / m_size != rank && m_fds[i] != -1)
+            {
+                ::close(m_fds[i]);
+                m_fds[i] = -1;
+            }
+        for (size_t r = 0; r < m_size; ++r)
+            if (fd(r) != -1)
+                fcntl(fd(r), F_SETFL, fcntl(fd(r), F_GETFL) | O_NONBLOCK);
+    }
+
+    bool exchange(const std::vector<std::vector<uint8_t>> &out, std::vector<std::vector<uint8_t>> &in)
+    {
+        // setup
+        in.assign(m_size, std::vector<uint8_t>());
+        in[m_rank] = out[m_rank];
+        std::vector<uint64_t> out_header(m_size), in_header(m_size, 0);
+        std::vector<size_t> written(m_size, 0), read(m_size, 0);
+        std::vector<bool> header_done(m_size, false);
+        size_t pending = 0;
+        for (size_t r = 0; r < m_size; ++r)
+            if (r != m_rank)
+            {
+                out_header[r] = out[r].size();
+                m_bytes_sent += out[r].size();
+                pending += 2;
+            }
+
+        std::vector<pollfd> fds;
+        std::vector<size_t> peer;
+        while (pending)
+        {
+            fds.clear();
+            peer.clear();
+            for (size_t r = 0; r < m_size; ++r)
+            {
+                if (r == m_rank)
+                    continue;
+                short events = 0;
+                if (written[r] < 8 + out[r].size())
+                    events |= POLLOUT;
+                if (!header_done[r] || read[r] < in_header[r])
+                    events |= POLLIN;
+                if (events)
+                {
+                    fds.push_back({fd(r), events, 0});
+                    peer.push_back(r);
+                }
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            for (size_t i = 0; i < fds.size(); ++i)
+            {
+                size_t r = peer[i];
+                if (fds[i].revents & POLLOUT)
+                {
+                    // the 8-byte length goes first, then the payload
+                    const uint8_t *src;
+                    size_t left;
+                    if (written[r] < 8)
+                    {
+                        src = reinterpret_cast<const uint8_t *>(&out_header[r]) + written[r];
+                        left = 8 - written[r];
+                    }
+                    else
+                    {
+                        src = out[r].data() + (written[r] - 8);
+                        left = out[r].size() - (written[r] - 8);
+                    }
+                    ssize_t n = ::send(fd(r), src, left, MSG_NOSIGNAL);
+                    if (n > 0)
+                    {
+                        written[r] += n;
+                        if (written[r] == 8 + out[r].size())
+                            --pending;
+                    }
+                    else if (n < 0 && errno != EAGAIN && errno != EINTR)
+                        return false;
+                }
+                if (fds[i].revents & (POLLIN | POLLHUP))
+                {
+                    ssize_t n;
+                    if (!header_done[r])
+                    {
+                        n = ::recv(fd(r), reinterpret_cast<uint8_t *>(&in_header[r]) + read[r], 8 - read[r], 0);
+                        if (n > 0 && (read[r] += n) == 8)
+                        {
+                            header_done[r] = true;
+                            read[r] = 0;
+                            in[r].resize(in_header[r]);
+                        }
+                    }
+                    else
+                    {
+                        n = ::recv(fd(r), in[r].data() + read[r], in_header[r] - read[r], 0);
+                        if (n > 0)
+                            read[r] += n;
+                    }
+                    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                        return false; // peer went away
+                    if (header_done[r] && read[r] == in_header[r])
+                        --pending;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    int fd(size_t peer) const { return m_fds[m_rank * m_size + peer]; }
+
+    size_t m_size;
+    size_t m_rank;
+    uint64_t m_bytes_sent;
+    bool m_open;
+    std::vector<int> m_fds; // m_fds[i * size + j]: worker i's end towards j
+};
+
+///@brief Combine one value from every worker with op into result, using
+///       t.exchange. The exchange hands every worker its own value back in
+///       in[rank], so each value is folded in exactly once. Returns false if
+///       the exchange failed.
+template <typename Transport, typename Op>
+bool transport_all_reduce(Transport &t, uint64_t v, Op op, uint64_t &result)
+{
+    std::vector<std::vector<uint8_t>> out(t.size()), in;
+    for (auto &o : out)
+        o.assign(reinterpret_cast<const uint8_t *>(&v), reinterpret_cast<const uint8_t *>(&v) + sizeof(v));
+    if (!t.exchange(out, in))
+        return false;
+    for (size_t r = 0; r < in.size(); ++r)
+    {
+        uint64_t x;
+        if (in[r].size() != sizeof(x))
+            return false;
+        std::memcpy(&x, in[r].data(), sizeof(x));
+        result = r == 0 ? x : op(result, x);
+    }
+    return true;
+}
+
+///@brief Counters reported by distributed_breadth_first_search.
+struct distributed_bfs_stats
+{
+    bool ok = false;       ///< False if a transport or worker failed
+    size_t workers = 0;    ///< Worker processes forked by the caller
+    size_t roots = 0;      ///< Roots of the resulting forest
+    size_t levels = 0;     ///< Frontier exchanges of the multi-source pass
+    uint64_t bytes = 0;    ///< Payload bytes sent between workers during the search
+    uint64_t messages = 0; ///< Non-empty frontier messages between workers
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// What one worker needs to search its part: its owned vertices in a dense
+/// numbering and their out edges, each target addressed by (owner, index in
+/// the owner's numbering). Owned vertices are numbered by ascending
+/// descriptor.
+////////////////////////////////////////////////////////////////////////////////
+struct distributed_bfs_rank
+{
+    std::vector<uint64_t> owned;        // descriptor of each owned vertex
+    std::vector<uint64_t> order;        // position of each owned vertex in g's vertex order
+    std::vector<size_t> offsets;        // out edges of vertex i are [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> target_owner; // per edge
+    std::vector<uint64_t> target_index; // per edge, in the owner's numbering
+    std::vector<size_t> part_size;      // owned vertices of every worker
+};
+
+///@brief Build the per-worker tables for the k-way partition part of g.
+///       Returns false, leaving ranks empty, if a vertex of g has no part or
+///       a part id that is not below k.
+template <typename Graph, typename PartMap>
+bool distributed_bfs_layout(const Graph &g, const PartMap &part, size_t k,
+                            std::vector<distributed_bfs_rank> &ranks)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+
+    // setup: check the partition, then number the vertices of every part
+    ranks.clear();
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        auto pi = part.find((*vi)->descriptor());
+        if (pi == part.end() || pi->second >= k)
+            return false;
+    }
+    ranks.assign(k, distributed_bfs_rank());
+    std::unordered_map<vertex_descriptor, uint64_t> order;
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        vertex_descriptor vd = (*vi)->descriptor();
+        order.emplace(vd, order.size());
+        ranks[part.at(vd)].owned.push_back(vd);
+    }
+    std::unordered_map<vertex_descriptor, uint64_t> index;
+    index.reserve(order.size());
+    for (auto &r : ranks)
+    {
+        std::sort(r.owned.begin(), r.owned.end());
+        for (size_t i = 0; i < r.owned.size(); ++i)
+            index[r.owned[i]] = i;
+        r.order.resize(r.owned.size());
+        r.offsets.assign(r.owned.size() + 1, 0);
+    }
+
+    // count the out edges of every owned vertex
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        vertex_descriptor vd = (*vi)->descriptor();
+        distributed_bfs_rank &r = ranks[part.at(vd)];
+        uint64_t i = index.at(vd);
+        r.order[i] = order.at(vd);
+        r.offsets[i + 1] = std::distance((*vi)->cbegin(), (*vi)->cend());
+    }
+    for (auto &r : ranks)
+    {
+        for (size_t i = 0; i < r.owned.size(); ++i)
+            r.offsets[i + 1] += r.offsets[i];
+        r.target_owner.resize(r.offsets.back());
+        r.target_index.resize(r.offsets.back());
+        for (auto &q : ranks)
+            r.part_size.push_back(q.owned.size());
+    }
+
+    // address every edge target by (owner, index in the owner's numbering)
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        vertex_descriptor vd = (*vi)->descriptor();
+        distributed_bfs_rank &r = ranks[part.at(vd)];
+        size_t e = r.offsets[index.at(vd)];
+        for (auto aei = (*vi)->cbegin(); aei != (*vi)->cend(); ++aei, ++e)
+        {
+            vertex_descriptor t = (*aei)->target();
+            r.target_owner[e] = static_cast<uint32_t>(part.at(t));
+            r.target_index[e] = index.at(t);
+        }
+    }
+    return true;
+}
+
+///@brief Label offered to vertex index of a worker: the position of its root
+///       in the vertex order of g, its depth below that root and the
+///       descriptor of its parent. Smaller labels win, compared in that order.
+struct distributed_bfs_label
+{
+    uint64_t index;
+    uint64_t root;
+    uint64_t depth;
+    uint64_t parent;
+
+    bool operator<(const distributed_bfs_label &o) const
+    {
+        if (root != o.root)
+            return root < o.root;
+        if (depth != o.depth)
+            return depth < o.depth;
+        return parent < o.parent;
+    }
+};
+
+///@brief Append the labels for a worker with n vertices, sorted by index with
+///       one entry per index, as delta-coded indices (tag 0) or as a bitmap
+///       over [0, n) (tag 1), whichever is shorter, followed by the root,
+///       depth and parent of every entry. Nothing is appended for no entries.
+inline void encode_frontier(const std::vector<distributed_bfs_label> &entries, size_t n,
+                            std::vector<uint8_t> &buf)
+{
+    if (entries.empty())
+        return;
+    std::vector<uint8_t> deltas;
+    uint64_t last = 0;
+    for (auto &e : entries)
+    {
+        put_varint(deltas, e.index - last);
+        last = e.index;
+    }
+    size_t bitmap_bytes = (n + 7) / 8;
+    if (bitmap_bytes < deltas.size())
+    {
+        buf.push_back(1);
+        size_t at = buf.size();
+        buf.resize(at + bitmap_bytes, 0);
+        for (auto &e : entries)
+            buf[at + e.index / 8] |= static_cast<uint8_t>(1u << (e.index % 8));
+    }
+    else
+    {
+        buf.push_back(0);
+        put_varint(buf, entries.size());
+        buf.insert(buf.end(), deltas.begin(), deltas.end());
+    }
+    for (auto &e : entries)
+    {
+        put_varint(buf, e.root);
+        put_varint(buf, e.depth);
+        put_varint(buf, e.parent);
+    }
+}
+
+///@brief Inverse of encode_frontier over [p, end); calls f(label) per entry.
+///       Returns false if the bytes are not a well-formed frontier.
+template <typename Function>
+bool decode_frontier(const uint8_t *p, const uint8_t *end, size_t n, Function f)
+{
+    if (p == end)
+        return true;
+    uint8_t tag = *p++;
+    std::vector<uint64_t> index;
+    uint64_t v;
+    if (tag == 1)
+    {
+        const uint8_t *bitmap = p;
+        if (static_cast<size_t>(end - p) < (n + 7) / 8)
+            return false;
+        p += (n + 7) / 8;
+        for (size_t w = 0; w < (n + 7) / 8; ++w)
+            for (uint8_t b = bitmap[w]; b; b &= b - 1)
+                index.push_back(w * 8 + __builtin_ctz(b));
+    }
+    else if (tag == 0)
+    {
+        uint64_t count;
+        if (!get_varint(p, end, count))
+            return false;
+        uint64_t last = 0;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            if (!get_varint(p, end, v))
+                return false;
+            index.push_back(last += v);
+        }
+    }
+    else
+        return false;
+    for (uint64_t i : index)
+    {
+        distributed_bfs_label l;
+        l.index = i;
+        if (i >= n || !get_varint(p, end, l.root) || !get_varint(p, end, l.depth) ||
+            !get_varint(p, end, l.parent))
+            return false;
+        f(l);
+    }
+    return p == end;
+}
+
+///@brief Body of one worker. Returns, on rank 0 only, the parent of every
+///       vertex of g in parents (descriptor, parent or -1 for roots). Returns
+///       false if an exchange failed or a message was malformed.
+///
+///       Each round every worker seeds its unclaimed vertices whose position
+///       lies in [first, first + window), where first is the smallest
+///       position of an unclaimed vertex on any worker, expands its frontier
+///       and exchanges the offers. Every message starts with the sender's
+///       frontier size, smallest unclaimed position, seeds and number of
+///       vertices that moved to a smaller root, so the round needs no other
+///       collective. The window halves when more vertices moved than were
+///       seeded and doubles otherwise, which covers many small components in
+///       few rounds without flooding a large one with searches that will be
+///       overrun.
+template <typename Transport>
+bool distributed_bfs_worker(const distributed_bfs_rank &r, Transport &t, distributed_bfs_stats &stats,
+                            std::vector<std::pair<uint64_t, long>> &parents)
+{
+    // setup
+    const uint64_t none = std::numeric_limits<uint64_t>::max();
+    auto sum_op = [](uint64_t a, uint64_t b)
+    { return a + b; };
+    size_t k = t.size();
+    size_t me = t.rank();
+    size_t n = r.owned.size();
+    std::vector<distributed_bfs_label> label(n), best(n);
+    for (size_t i = 0; i < n; ++i)
+        label[i] = best[i] = {i, none, none, none};
+    std::vector<size_t> by_order(n);
+    for (size_t i = 0; i < n; ++i)
+        by_order[i] = i;
+    std::sort(by_order.begin(), by_order.end(), [&](size_t a, size_t b)
+              { return r.order[a] < r.order[b]; });
+    size_t cursor = 0;
+    auto unclaimed = [&](size_t i)
+    { return label[i].root > r.order[i]; };
+    std::vector<size_t> frontier, touched;
+    std::vector<std::vector<distributed_bfs_label>> outbox(k);
+    std::vector<std::vector<uint8_t>> out(k), in;
+    uint64_t messages = 0, moved = 0, seeded;
+    uint64_t first = 0, window = 1; // position 0 is always a root
+
+    auto offer = [&](const distributed_bfs_label &l)
+    {
+        distributed_bfs_label &b = best[l.index];
+        if (!(l < b))
+            return;
+        if (!(b < label[l.index]) && !(label[l.index] < b))
+            touched.push_back(l.index);
+        b = l;
+    };
+
+    for (;;)
+    {
+        // seed the unclaimed vertices in the window
+        seeded = 0;
+        for (; cursor < n && (!unclaimed(by_order[cursor]) || r.order[by_order[cursor]] - first < window); ++cursor)
+        {
+            size_t i = by_order[cursor];
+            if (!unclaimed(i))
+                continue;
+            label[i] = best[i] = {i, r.order[i], 0, none};
+            frontier.push_back(i);
+            ++seeded;
+        }
+        uint64_t next = cursor < n ? r.order[by_order[cursor]] : none;
+
+        // expand the local frontier
+        for (size_t u : frontier)
+            for (size_t e = r.offsets[u]; e < r.offsets[u + 1]; ++e)
+            {
+                distributed_bfs_label l = {r.target_index[e], label[u].root, label[u].depth + 1, r.owned[u]};
+                if (r.target_owner[e] == me)
+                    offer(l);
+                else
+                    outbox[r.target_owner[e]].push_back(l);
+            }
+
+        // aggregate to one entry per target, keeping the smallest label
+        for (size_t q = 0; q < k; ++q)
+        {
+            auto &box = outbox[q];
+            std::sort(box.begin(), box.end(), [](const distributed_bfs_label &a, const distributed_bfs_label &b)
+                      { return a.index != b.index ? a.index < b.index : a < b; });
+            box.erase(std::unique(box.begin(), box.end(),
+                                  [](const distributed_bfs_label &a, const distributed_bfs_label &b)
+                                  { return a.index == b.index; }),
+                      box.end());
+            out[q].clear();
+            put_varint(out[q], frontier.size());
+            put_varint(out[q], next);
+            put_varint(out[q], seeded);
+            put_varint(out[q], moved);
+            encode_frontier(box, r.part_size[q], out[q]);
+            messages += !box.empty();
+            box.clear();
+        }
+        if (!t.exchange(out, in))
+            return false;
+        uint64_t active = 0, seeds = 0, overrun = 0;
+        first = none;
+        for (size_t q = 0; q < k; ++q)
+        {
+            const uint8_t *p = in[q].data();
+            const uint8_t *end = p + in[q].size();
+            uint64_t a, c, s, m;
+            if (!get_varint(p, end, a) || !get_varint(p, end, c) || !get_varint(p, end, s) ||
+                !get_varint(p, end, m) ||
+                !decode_frontier(p, end, n, offer))
+                return false;
+            active += a;
+            first = std::min(first, c);
+            seeds += s;
+            overrun += m;
+        }
+        ++stats.levels;
+        if (active == 0 && first == none)
+            break;
+        window = overrun > seeds ? std::max<uint64_t>(1, window / 2) : std::min<uint64_t>(window * 2, none / 2);
+
+        // settle this round; only a new root or depth needs to be passed on
+        frontier.clear();
+        moved = 0;
+        for (size_t i : touched)
+        {
+            if (best[i].root != label[i].root || best[i].depth != label[i].depth)
+                frontier.push_back(i);
+            moved += label[i].root != none && best[i].root < label[i].root;
+            label[i] = best[i];
+        }
+        touched.clear();
+    }
+
+    // gather the tree on rank 0
+    for (auto &o : out)
+        o.clear();
+    put_varint(out[0], n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        put_varint(out[0], r.owned[i]);
+        put_varint(out[0], label[i].depth == 0 ? 0 : label[i].parent + 1);
+    }
+    uint64_t frontier_bytes = t.bytes_sent();
+    if (!t.exchange(out, in) || !transport_all_reduce(t, frontier_bytes, sum_op, stats.bytes) ||
+        !transport_all_reduce(t, messages, sum_op, stats.messages))
+        return false;
+    if (me != 0)
+        return true;
+    parents.clear();
+    stats.roots = 0;
+    for (auto &m : in)
+    {
+        const uint8_t *p = m.data();
+        const uint8_t *end = p + m.size();
+        uint64_t count, vd, pd;
+        if (!get_varint(p, end, count))
+            return false;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            if (!get_varint(p, end, vd) || !get_varint(p, end, pd))
+                return false;
+            parents.emplace_back(vd, pd == 0 ? -1 : static_cast<long>(pd - 1));
+            stats.roots += pd == 0;
+        }
+    }
+    return true;
+}
+
+///@brief Breadth-first search of g by t.size() worker processes over the
+///       partition part. The caller forks one worker per part and waits for
+///       them; worker 0 sends it the tree through a pipe. p receives the same
+///       kind of tree as breadth_first_search. If any worker fails, the others
+///       are killed, ok is false and p is left empty.
+template <typename Graph, typename ParentMap, typename PartMap, typename Transport>
+distributed_bfs_stats distributed_breadth_first_search(const Graph &g, ParentMap &p,
+                                                       const PartMap &part, Transport &t)
+{
+    // setup
+    distributed_bfs_stats stats;
+    size_t k = t.size();
+    stats.workers = k;
+    p.clear();
+    if (!t.is_open() || k == 0)
+        return stats;
+    std::vector<distributed_bfs_rank> ranks;
+    if (!distributed_bfs_layout(g, part, k, ranks))
+        return stats;
+
+    // one pipe per worker: the worker keeps the write end, and its hang-up
+    // tells the caller that the worker has exited
+    std::vector<int> pipes(2 * k, -1);
+    auto close_pipes = [&]()
+    {
+        for (int &fd : pipes)
+            if (fd != -1)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+    };
+    for (size_t r = 0; r < k; ++r)
+        if (pipe(&pipes[2 * r]) != 0)
+        {
+            close_pipes();
+            return stats;
+        }
+
+    // fork the workers
+    std::vector<pid_t> children;
+    for (size_t r = 0; r < k; ++r)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            int fd = pipes[2 * r + 1];
+            for (size_t i = 0; i < pipes.size(); ++i)
+                if (pipes[i] != fd)
+                    ::close(pipes[i]);
+            t.attach(r);
+            distributed_bfs_stats s;
+            std::vector<std::pair<uint64_t, long>> parents;
+            if (!distributed_bfs_worker(ranks[r], t, s, parents))
+                _exit(1);
+            if (r != 0)
+                _exit(0);
+            std::vector<uint8_t> buf;
+            put_varint(buf, s.roots);
+            put_varint(buf, s.levels);
+            put_varint(buf, s.bytes);
+            put_varint(buf, s.messages);
+            put_varint(buf, parents.size());
+            for (auto &e : parents)
+            {
+                put_varint(buf, e.first);
+                put_varint(buf, static_cast<uint64_t>(e.second + 1));
+            }
+            for (size_t done = 0; done < buf.size();)
+            {
+                ssize_t w = ::write(fd, buf.data() + done, buf.size() - done);
+                if (w < 0 && errno != EINTR)
+                    _exit(1);
+                if (w > 0)
+                    done += w;
+            }
+            _exit(0);
+        }
+        if (pid < 0)
+        {
+            // the workers already started would wait forever for this one
+            for (pid_t c : children)
+                kill(c, SIGKILL);
+            for (pid_t c : children)
+                waitpid(c, nullptr, 0);
+            close_pipes();
+            return stats;
+        }
+        children.push_back(pid);
+    }
+    for (size_t r = 0; r < k; ++r)
+    {
+        ::close(pipes[2 * r + 1]);
+        pipes[2 * r + 1] = -1;
+    }
+
+    // read worker 0's result and reap every worker as it exits; the first
+    // failure kills the others, which may be blocked on the failed one
+    stats.ok = true;
+    std::vector<uint8_t> result;
+    std::vector<bool> reaped(k, false);
+    auto abort_workers = [&]()
+    {
+        stats.ok = false;
+        for (size_t r = 0; r < k; ++r)
+            if (!reaped[r])
+                kill(children[r], SIGKILL);
+    };
+    std::vector<pollfd> fds;
+    std::vector<size_t> worker;
+    for (size_t running = k; running;)
+    {
+        fds.clear();
+        worker.clear();
+        for (size_t r = 0; r < k; ++r)
+            if (pipes[2 * r] != -1)
+            {
+                fds.push_back({pipes[2 * r], POLLIN, 0});
+                worker.push_back(r);
+            }
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            abort_workers();
+            for (size_t r = 0; r < k; ++r)
+                if (!reaped[r])
+                    waitpid(children[r], nullptr, 0);
+            break;
+        }
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            if (!fds[i].revents)
+                continue;
+            size_t r = worker[i];
+            uint8_t buf[4096];
+            ssize_t n = ::read(pipes[2 * r], buf, sizeof(buf));
+            if (n > 0)
+            {
+                result.insert(result.end(), buf, buf + n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && stats.ok)
+                abort_workers();
+
+            // end of file: the worker has exited
+            ::close(pipes[2 * r]);
+            pipes[2 * r] = -1;
+            --running;
+            int status = 0;
+            bool exited = waitpid(children[r], &status, 0) == children[r];
+            reaped[r] = true;
+            if ((!exited || !WIFEXITED(status) || WEXITSTATUS(status) != 0) && stats.ok)
+                abort_workers();
+        }
+    }
+    close_pipes();
+
+    // finalize
+    if (!stats.ok)
+        return stats;
+    const uint8_t *q = result.data();
+    const uint8_t *end = q + result.size();
+    uint64_t roots = 0, levels = 0, count = 0, vd, pd;
+    if (!get_varint(q, end, roots) || !get_varint(q, end, levels) || !get_varint(q, end, stats.bytes) ||
+        !get_varint(q, end, stats.messages) || !get_varint(q, end, count))
+        stats.ok = false;
+    stats.roots = roots;
+    stats.levels = levels;
+    for (uint64_t i = 0; stats.ok && i < count; ++i)
+    {
+        if (!get_varint(q, end, vd) || !get_varint(q, end, pd))
+            stats.ok = false;
+        else
+            p[static_cast<typename Graph::vertex_descriptor>(vd)] = static_cast<long>(pd) - 1;
+    }
+    if (!stats.ok)
+        p.clear();
+    return stats;
+}
+
+///@brief Partition g into num_workers parts with multilevel_partition and
+///       search it over a Transport built for that many workers, e.g.
+///       distributed_breadth_first_search<socket_transport>(g, p, 4).
+template <typename Transport = shared_memory_transport, typename Graph, typename ParentMap>
+distributed_bfs_stats distributed_breadth_first_search(const Graph &g, ParentMap &p, size_t num_workers)
+{
+    std::unordered_map<typename Graph::vertex_descriptor, size_t> part;
+    if (!multilevel_partition(g, num_workers, part))
+    {
+        p.clear();
+        return distributed_bfs_stats();
+    }
+    Transport t(num_workers);
+    return distributed_breadth_first_search(g, p, part, t);
+}
+
+#endif
@@ -2,81 +2,16 @@
 #define _GRAPH_VECTOR_H_
 
 #include <algorithm>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <vector>
 
-template <typename VertexProperty, typename EdgeProperty>
-
-class Graph
-{
-private:
-    vector<vector<int>> adjList;
-
-public:
-    // Constructor
-    Graph(int numVertices)
-    {
-        adjList.resize(numVertices);
-    }
-
-    // Add vertex
-    void addVertex()
-    {
-        adjList.push_back(vector<int>());
-    }
-
-    // Remove vertex
-    void removeVertex(int v)
-    {
-        adjList.erase(adjList.begin() + v);
-        for (int i = 0; i < adjList.size(); i++)
-        {
-            for (int j = 0; j < adjList[i].size(); j++)
-            {
-                if (adjList[i][j] == v)
-                {
-                    adjList[i].erase(adjList[i].begin() + j);
-                    break;
-                }
-                else if (adjList[i][j] > v)
-                {
-                    adjList[i][j]--;
-                }
-            }
-        }
-    }
-
-    // Add edge
-    void addEdge(int u, int v)
-    {
-        adjList[u].push_back(v);
-        adjList[v].push_back(u);
-    }
-
-    // Remove edge
-    void removeEdge(int u, int v)
-    {
-        for (int i = 0; i < adjList[u].size(); i++)
-        {
-            if (adjList[u][i] == v)
-            {
-                adjList[u].erase(adjList[u].begin() + i);
-                break;
-            }
-        }
-        for (int i = 0; i < adjList[v].size(); i++)
-        {
-            if (adjList[v][i] == u)
-            {
-                adjList[v].erase(adjList[v].begin() + i);
-                break;
-            }
-        }
-    }
-};
+#include "graph instrumentation.h"
+#include "graph memory.h"
 
 // THE GRAPH VECTOR
+template <typename VertexProperty, typename EdgeProperty>
 class graph_vector
 {
 
@@ -140,68 +75,143 @@ public:
 
     vertex_iterator find_vertex(vertex_descriptor vd)
     {
-        return std::find_if(m_vertices.begin(), m_vertices.end(),
-                            [&](const vertex *const v)
-                            {
-                                return v->descriptor() == vd;
-                            });
+        auto i = std::find_if(m_vertices.begin(), m_vertices.end(),
+                              [&](const vertex *const v)
+                              {
+                                  return v->descriptor() == vd;
+                              });
+        GRAPH_COUNT(vertex_lookups, 1);
+        GRAPH_COUNT(vertex_probes, i - m_vertices.begin() + (i != m_vertices.end()));
+        return i;
     }
 
     const_vertex_iterator find_vertex(vertex_descriptor vd) const
     {
-        return std::find_if(m_vertices.cbegin(), m_vertices.cend(),
-                            [&](const vertex *const v)
-                            {
-                                return v->descriptor() == vd;
-                            });
+        auto i = std::find_if(m_vertices.cbegin(), m_vertices.cend(),
+                              [&](const vertex *const v)
+                              {
+                                  return v->descriptor() == vd;
+                              });
+        GRAPH_COUNT(vertex_lookups, 1);
+        GRAPH_COUNT(vertex_probes, i - m_vertices.cbegin() + (i != m_vertices.cend()));
+        return i;
     }
 
     edge_iterator find_edge(edge_descriptor ed)
     {
-        return std::find_if(m_edges.begin(), m_edges.end(),
-                            [&](const edge *const e)
-                            {
-                                return e->descriptor() == ed;
-                            });
+        auto i = std::find_if(m_edges.begin(), m_edges.end(),
+                              [&](const edge *const e)
+                              {
+                                  return e->descriptor() == ed;
+                              });
+        GRAPH_COUNT(edge_lookups, 1);
+        GRAPH_COUNT(edge_probes, i - m_edges.begin() + (i != m_edges.end()));
+        return i;
     }
 
     const_edge_iterator find_edge(edge_descriptor ed) const
     {
-        return std::find_if(m_edges.cbegin(), m_edges.cend(),
-                            [&](const edge *e)
-                            {
-                                return e->descriptor() == ed;
-                            });
+        auto i = std::find_if(m_edges.cbegin(), m_edges.cend(),
+                              [&](const edge *e)
+                              {
+                                  return e->descriptor() == ed;
+                              });
+        GRAPH_COUNT(edge_lookups, 1);
+        GRAPH_COUNT(edge_probes, i - m_edges.cbegin() + (i != m_edges.cend()));
+        return i;
     }
 
-    //@todo modifiers
+    // modifiers
+    //
+    // Descriptors of erased vertices go on a free list and are handed out
+    // again, lowest first, before m_max_vd grows.
     vertex_descriptor insert_vertex(const VertexProperty &vp)
     {
-        return m_max_vd;
+        vertex_descriptor vd;
+        if (!m_free_vds.empty())
+        {
+            std::pop_heap(m_free_vds.begin(), m_free_vds.end(), std::greater<vertex_descriptor>());
+            vd = m_free_vds.back();
+            m_free_vds.pop_back();
+        }
+        else
+            vd = m_max_vd++;
+        m_vertices.push_back(new vertex(vd, vp));
+        GRAPH_COUNT(allocations, 1);
+        return vd;
     }
 
+    // If either vertex is missing nothing is inserted. Parallel edges are
+    // allowed.
     edge_descriptor insert_edge(vertex_descriptor sd, vertex_descriptor td,
                                 const EdgeProperty &ep)
     {
+        auto si = find_vertex(sd);
+        if (si == m_vertices.end() || find_vertex(td) == m_vertices.end())
+            return {sd, td};
+        edge *e = new edge(sd, td, ep);
+        GRAPH_COUNT(allocations, 1);
+        m_edges.push_back(e);
+        (*si)->m_out_edges.push_back(e);
         return {sd, td};
     }
 
     void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td,
                                 const EdgeProperty &ep)
     {
+        insert_edge(sd, td, ep);
+        insert_edge(td, sd, ep);
     }
 
+    // Erase vd together with every edge touching it. vd is recycled by a later
+    // insert_vertex.
     void erase_vertex(vertex_descriptor vd)
     {
+        auto vi = find_vertex(vd);
+        if (vi == m_vertices.end())
+            return;
+        auto touches = [vd](const edge *e)
+        {
+            return e->source() == vd || e->target() == vd;
+        };
+        for (auto v : m_vertices)
+            if (v->descriptor() != vd)
+                v->m_out_edges.erase(std::remove_if(v->m_out_edges.begin(), v->m_out_edges.end(), touches),
+                                     v->m_out_edges.end());
+        auto dead = std::partition(m_edges.begin(), m_edges.end(),
+                                   [&](const edge *e)
+                                   {
+                                       return !touches(e);
+                                   });
+        GRAPH_COUNT(deallocations, m_edges.end() - dead + 1);
+        for (auto ei = dead; ei != m_edges.end(); ++ei)
+            delete *ei;
+        m_edges.erase(dead, m_edges.end());
+        delete *vi;
+        m_vertices.erase(vi);
+        m_free_vds.push_back(vd);
+        std::push_heap(m_free_vds.begin(), m_free_vds.end(), std::greater<vertex_descriptor>());
     }
 
+    // Erase one edge from sd to td.
     void erase_edge(edge_descriptor ed)
     {
+        auto ei = find_edge(ed);
+        if (ei == m_edges.end())
+            return;
+        edge *e = *ei;
+        auto &out = (*find_vertex(ed.first))->m_out_edges;
+        out.erase(std::find(out.begin(), out.end(), e));
+        m_edges.erase(ei);
+        delete e;
+        GRAPH_COUNT(deallocations, 1);
     }
-    // end @todo
+
     void clear()
     {
+        GRAPH_COUNT(deallocations, m_vertices.size() + m_edges.size());
         m_max_vd = 0;
+        m_free_vds.clear();
         for (auto v : m_vertices)
             delete v;
         m_vertices.clear();
@@ -210,16 +220,130 @@ public:
         m_edges.clear();
     }
 
+    // Report the bytes held by the graph, see graph memory.h.
+    graph_memory_usage memory_usage() const
+    {
+        graph_memory_usage u;
+        u.vertex_nodes = m_vertices.size() * (sizeof(vertex) - sizeof(VertexProperty));
+        u.edge_nodes = m_edges.size() * (sizeof(edge) - sizeof(EdgeProperty));
+        u.properties = m_vertices.size() * sizeof(VertexProperty) + m_edges.size() * sizeof(EdgeProperty);
+        account_vector(m_vertices, u, &graph_memory_usage::containers);
+        account_vector(m_edges, u, &graph_memory_usage::containers);
+        account_vector(m_free_vds, u, &graph_memory_usage::containers);
+        for (auto v : m_vertices)
+            account_vector(v->m_out_edges, u, &graph_memory_usage::adjacency);
+        return u;
+    }
+
+    // Release the spare capacity of every vector. Vectors keep their capacity
+    // after erasures, so call this once a large batch of erasures is done.
+    void shrink_to_fit()
+    {
+        m_vertices.shrink_to_fit();
+        m_edges.shrink_to_fit();
+        m_free_vds.shrink_to_fit();
+        for (auto v : m_vertices)
+            v->m_out_edges.shrink_to_fit();
+    }
+
+    // Renumber the live vertices to [0, num_vertices()), keeping their relative
+    // order, and empty the free list. The returned table maps each old
+    // descriptor d to its new one, or to -1 if d was not in use, so external
+    // maps can be migrated in one pass.
+    std::vector<vertex_descriptor> compact()
+    {
+        std::vector<vertex_descriptor> old_to_new(m_max_vd, vertex_descriptor(-1));
+        for (auto v : m_vertices)
+            old_to_new[v->descriptor()] = 0;
+        vertex_descriptor next = 0;
+        for (auto &d : old_to_new)
+            if (d == 0)
+                d = next++;
+        relabel(old_to_new);
+        return old_to_new;
+    }
+
+    // Renumber every vertex through old_to_new and rebuild the vertex, edge and
+    // adjacency storage in the new order. Vertices end up sorted by descriptor,
+    // edges by (source, target), and nodes are reallocated in that order so
+    // neighbouring ids are also neighbours in memory. old_to_new must map each
+    // live descriptor to a distinct descriptor.
+    template <typename DescriptorMap>
+    void relabel(const DescriptorMap &old_to_new)
+    {
+        // order vertices and edges by their new descriptors
+        std::vector<std::pair<vertex_descriptor, vertex *>> vorder;
+        vorder.reserve(m_vertices.size());
+        for (auto v : m_vertices)
+            vorder.emplace_back(old_to_new.at(v->descriptor()), v);
+        std::sort(vorder.begin(), vorder.end(),
+                  [](const std::pair<vertex_descriptor, vertex *> &a,
+                     const std::pair<vertex_descriptor, vertex *> &b)
+                  { return a.first < b.first; });
+        std::vector<std::pair<edge_descriptor, edge *>> eorder;
+        eorder.reserve(m_edges.size());
+        for (auto e : m_edges)
+            eorder.emplace_back(edge_descriptor(old_to_new.at(e->source()),
+                                                old_to_new.at(e->target())),
+                                e);
+        std::sort(eorder.begin(), eorder.end(),
+                  [](const std::pair<edge_descriptor, edge *> &a,
+                     const std::pair<edge_descriptor, edge *> &b)
+                  { return a.first < b.first; });
+
+        // reallocate in the new order
+        vertex_storage vertices;
+        edge_storage edges;
+        vertices.reserve(vorder.size());
+        edges.reserve(eorder.size());
+        size_t max_vd = 0;
+        for (auto &p : vorder)
+        {
+            vertices.push_back(new vertex(p.first, std::move(p.second->m_property)));
+            max_vd = std::max(max_vd, p.first + 1);
+        }
+        size_t src = 0;
+        for (auto &p : eorder)
+        {
+            edge *e = new edge(p.first.first, p.first.second, std::move(p.second->property()));
+            edges.push_back(e);
+            // edges are sorted by source, so the owning vertex only moves forward
+            while (vertices[src]->descriptor() != p.first.first)
+                ++src;
+            vertices[src]->m_out_edges.push_back(e);
+        }
+
+        GRAPH_COUNT(allocations, vertices.size() + edges.size());
+        GRAPH_COUNT(deallocations, m_vertices.size() + m_edges.size());
+        for (auto v : m_vertices)
+            delete v;
+        for (auto e : m_edges)
+            delete e;
+        m_vertices.swap(vertices);
+        m_edges.swap(edges);
+        m_max_vd = max_vd;
+
+        // descriptors below m_max_vd that are no longer used become free
+        std::vector<bool> used(m_max_vd, false);
+        for (auto &p : vorder)
+            used[p.first] = true;
+        m_free_vds.clear();
+        for (vertex_descriptor d = 0; d < m_max_vd; ++d)
+            if (!used[d])
+                m_free_vds.push_back(d);
+    }
+
     template <typename V, typename E>
-    friend std::istream &operator>>(std::istream &is, graph<V, E> &g);
+    friend std::istream &operator>>(std::istream &is, graph_vector<V, E> &g);
 
     template <typename V, typename E>
-    friend std::ostream &operator<<(std::ostream &os, const graph<V, E> &g);
+    friend std::ostream &operator<<(std::ostream &os, const graph_vector<V, E> &g);
 
 private:
-    size_t m_max_vd;           // Id generator for next vertex to be inserted
-    vertex_storage m_vertices; // List of all vertices in the graph
-    edge_storage m_edges;      // List of  all edges in the graph
+    size_t m_max_vd;                           // Id generator for next vertex to be inserted
+    vertex_storage m_vertices;                 // List of all vertices in the graph
+    edge_storage m_edges;                      // List of  all edges in the graph
+    std::vector<vertex_descriptor> m_free_vds; // Min-heap of erased descriptors to reuse
 
     /// required internal classes
 
@@ -279,7 +403,7 @@ std::istream &operator>>(std::istream &is, graph_vector<V, E> &g)
     size_t num_verts, num_edges;
     is >> num_verts >> num_edges;
     g.m_vertices.reserve(num_verts);
-    g.m_vertices.reserve(num_edges);
+    g.m_edges.reserve(num_edges);
     for (size_t i = 0; i < num_verts; ++i)
     {
         V v;
@@ -288,7 +412,7 @@ std::istream &operator>>(std::istream &is, graph_vector<V, E> &g)
     }
     for (size_t i = 0; i < num_edges; ++i)
     {
-        typename graph<V, E>::vertex_descriptor s, t;
+        typename graph_vector<V, E>::vertex_descriptor s, t;
         E e;
         is >> s >> t >> e;
         g.insert_edge(s, t, e);
@@ -0,0 +1,465 @@
+#ifndef _GRAPH_DYNAMIC_CONNECTIVITY_H_
+#define _GRAPH_DYNAMIC_CONNECTIVITY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fully dynamic connectivity for undirected graphs: a spanning forest kept as
+/// Euler tours in treaps, plus the non-tree edges of every vertex.
+///
+///  - connected(u, v) compares the roots of the tours of u and v: O(log n).
+///  - Inserting an edge between two trees links the tours: O(log n).
+///    Otherwise the edge is recorded as a non-tree edge: O(1).
+///  - Erasing a non-tree edge is O(1). Erasing a tree edge cuts the tour and
+///    then searches the smaller of the two trees for a non-tree edge leading
+///    into the other one. Each treap node carries a flag telling whether its
+///    subtree holds a vertex with non-tree edges, so the search only visits
+///    such vertices. The replacement, if found, is linked back in.
+///
+/// This is the level-0 structure of Holm-de Lichtenberg-Thorup without the
+/// edge levels. Queries and insertions are polylogarithmic; a deletion costs
+/// O(log n) per non-tree edge inspected in the smaller tree.
+////////////////////////////////////////////////////////////////////////////////
+template <typename VertexDescriptor = size_t>
+class dynamic_connectivity
+{
+public:
+    typedef VertexDescriptor vertex_descriptor;
+
+    dynamic_connectivity() : m_seed(0x9e3779b9u), m_num_components(0) {}
+
+    dynamic_connectivity(const dynamic_connectivity &) = delete;
+    dynamic_connectivity &operator=(const dynamic_connectivity &) = delete;
+
+    // accessors
+
+    size_t num_components() const { return m_num_components; }
+
+    bool connected(vertex_descriptor u, vertex_descriptor v) const
+    {
+        auto a = m_vertex_node.find(u);
+        auto b = m_vertex_node.find(v);
+        if (a == m_vertex_node.end() || b == m_vertex_node.end())
+            return false;
+        return root(a->second) == root(b->second);
+    }
+
+    ///@brief Number of vertices in the component of v.
+    size_t component_size(vertex_descriptor v) const
+    {
+        auto a = m_vertex_node.find(v);
+        return a == m_vertex_node.end() ? 0 : m_nodes[root(a->second)].vcount;
+    }
+
+    // modifiers
+
+    void insert_vertex(vertex_descriptor v)
+    {
+        if (m_vertex_node.count(v))
+            return;
+        m_vertex_node[v] = new_node(true, v);
+        ++m_num_components;
+    }
+
+    ///@brief Erase v and every edge incident to it.
+    void erase_vertex(vertex_descriptor v)
+    {
+        auto i = m_vertex_node.find(v);
+        if (i == m_vertex_node.end())
+            return;
+        std::vector<vertex_descriptor> neighbours(m_adjacent[v]);
+        for (auto u : neighbours)
+            erase_edge(u, v);
+        free_node(m_vertex_node[v]);
+        m_vertex_node.erase(v);
+        m_non_tree.erase(v);
+        m_adjacent.erase(v);
+        --m_num_components;
+    }
+
+    void insert_edge(vertex_descriptor u, vertex_descriptor v)
+    {
+        insert_vertex(u);
+        insert_vertex(v);
+        if (u == v)
+            return;
+        edge_record &e = m_edges[key(u, v)];
+        ++e.copies;
+        m_adjacent[u].push_back(v);
+        m_adjacent[v].push_back(u);
+        if (e.copies == 1 && !connected(u, v))
+            link(u, v, e);
+        else
+            add_non_tree(u, v);
+    }
+
+    ///@brief Erase one copy of the undirected edge {u, v}.
+    void erase_edge(vertex_descriptor u, vertex_descriptor v)
+    {
+        auto i = m_edges.find(key(u, v));
+        if (i == m_edges.end())
+            return;
+        edge_record &e = i->second;
+        bool tree = e.arc[0] != npos;
+        drop(m_adjacent[u], v);
+        drop(m_adjacent[v], u);
+        // any non-tree copy goes first; a parallel copy can replace the tree edge
+        if (!tree || e.copies > 1)
+        {
+            remove_non_tree(u, v);
+            if (--e.copies == 0)
+                m_edges.erase(i);
+            return;
+        }
+        cut(e);
+        m_edges.erase(i);
+        replace(u, v);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct node
+    {
+        size_t left, right, parent;
+        uint32_t priority;
+        size_t count;  // Nodes in the subtree
+        size_t vcount; // Vertex nodes in the subtree
+        bool is_vertex;
+        bool has_non_tree;     // This vertex has non-tree edges
+        bool sub_non_tree;     // Some vertex in the subtree has
+        vertex_descriptor vd;  // Vertex of a vertex node
+    };
+
+    struct edge_record
+    {
+        size_t copies = 0;              // Parallel copies of {u, v}
+        size_t arc[2] = {npos, npos};   // Tour nodes (u,v) and (v,u) if a tree edge
+    };
+
+    typedef std::pair<vertex_descriptor, vertex_descriptor> edge_key;
+
+    static edge_key key(vertex_descriptor u, vertex_descriptor v)
+    {
+        return u < v ? edge_key(u, v) : edge_key(v, u);
+    }
+
+    // treap plumbing
+
+    size_t count(size_t x) const { return x == npos ? 0 : m_nodes[x].count; }
+    size_t vcount(size_t x) const { return x == npos ? 0 : m_nodes[x].vcount; }
+    bool flag(size_t x) const { return x != npos && m_nodes[x].sub_non_tree; }
+
+    void update(size_t x)
+    {
+        node &n = m_nodes[x];
+        n.count = 1 + count(n.left) + count(n.right);
+        n.vcount = (n.is_vertex ? 1 : 0) + vcount(n.left) + vcount(n.right);
+        n.sub_non_tree = n.has_non_tree || flag(n.left) || flag(n.right);
+    }
+
+    size_t new_node(bool is_vertex, vertex_descriptor vd)
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        node n{npos, npos, npos, m_seed, 1, is_vertex ? 1u : 0u, is_vertex, false, false, vd};
+        size_t x;
+        if (!m_free.empty())
+        {
+            x = m_free.back();
+            m_free.pop_back();
+            m_nodes[x] = n;
+        }
+        else
+        {
+            x = m_nodes.size();
+            m_nodes.push_back(n);
+        }
+        return x;
+    }
+
+    void free_node(size_t x) { m_free.push_back(x); }
+
+    size_t root(size_t x) const
+    {
+        while (m_nodes[x].parent != npos)
+            x = m_nodes[x].parent;
+        return x;
+    }
+
+    ///@brief Position of x in its tour.
+    size_t position(size_t x) const
+    {
+        size_t p = count(m_nodes[x].left);
+        for (; m_nodes[x].parent != npos; x = m_nodes[x].parent)
+        {
+            size_t up = m_nodes[x].parent;
+            if (m_nodes[up].right == x)
+                p += count(m_nodes[up].left) + 1;
+        }
+        return p;
+    }
+
+    size_t merge(size_t a, size_t b)
+    {
+        if (a == npos)
+            return b;
+        if (b == npos)
+            return a;
+        if (m_nodes[a].priority > m_nodes[b].priority)
+        {
+            size_t r = merge(m_nodes[a].right, b);
+            m_nodes[a].right = r;
+            m_nodes[r].parent = a;
+            update(a);
+            m_nodes[a].parent = npos;
+            return a;
+        }
+        size_t l = merge(a, m_nodes[b].left);
+        m_nodes[b].left = l;
+        m_nodes[l].parent = b;
+        update(b);
+        m_nodes[b].parent = npos;
+        return b;
+    }
+
+    ///@brief Split the treap t into its first k nodes and the rest.
+    std::pair<size_t, size_t> split(size_t t, size_t k)
+    {
+        if (t == npos)
+            return {npos, npos};
+        m_nodes[t].parent = npos;
+        size_t lc = count(m_nodes[t].left);
+        if (k <= lc)
+        {
+            auto s = split(m_nodes[t].left, k);
+            m_nodes[t].left = s.second;
+            if (s.second != npos)
+                m_nodes[s.second].parent = t;
+            update(t);
+            return {s.first, t};
+        }
+        auto s = split(m_nodes[t].right, k - lc - 1);
+        m_nodes[t].right = s.first;
+        if (s.first != npos)
+            m_nodes[s.first].parent = t;
+        update(t);
+        return {t, s.second};
+    }
+
+    ///@brief Rotate the tour containing x so it starts at x; returns the root.
+    size_t reroot(size_t x)
+    {
+        size_t r = root(x);
+        auto s = split(r, position(x));
+        return merge(s.second, s.first);
+    }
+
+    void refresh_path(size_t x)
+    {
+        for (; x != npos; x = m_nodes[x].parent)
+            update(x);
+    }
+
+    // forest operations
+
+    void link(vertex_descriptor u, vertex_descriptor v, edge_record &e)
+    {
+        size_t tu = reroot(m_vertex_node[u]);
+        size_t tv = reroot(m_vertex_node[v]);
+        e.arc[0] = new_node(false, u);
+        e.arc[1] = new_node(false, v);
+        merge(merge(merge(tu, e.arc[0]), tv), e.arc[1]);
+        --m_num_components;
+    }
+
+    void cut(edge_record &e)
+    {
+        size_t a = e.arc[0], b = e.arc[1];
+        if (position(a) > position(b))
+            std::swap(a, b);
+        size_t r = root(a);
+        size_t pa = position(a);
+        size_t pb = position(b);
+        auto s1 = split(r, pa);                 // [0, pa) | [pa, ...)
+        auto s2 = split(s1.second, 1);          // a | (pa, ...)
+        auto s3 = split(s2.second, pb - pa - 1); // (pa, pb) | [pb, ...)
+        auto s4 = split(s3.second, 1);          // b | (pb, ...)
+        merge(s1.first, s4.second);
+        free_node(e.arc[0]);
+        free_node(e.arc[1]);
+        e.arc[0] = e.arc[1] = npos;
+        ++m_num_components;
+    }
+
+    void set_non_tree_flag(vertex_descriptor v)
+    {
+        size_t x = m_vertex_node[v];
+        m_nodes[x].has_non_tree = !m_non_tree[v].empty();
+        refresh_path(x);
+    }
+
+    void add_non_tree(vertex_descriptor u, vertex_descriptor v)
+    {
+        m_non_tree[u].push_back(v);
+        m_non_tree[v].push_back(u);
+        set_non_tree_flag(u);
+        set_non_tree_flag(v);
+    }
+
+    ///@brief Remove one occurrence of x from l, not preserving order.
+    static void drop(std::vector<vertex_descriptor> &l, vertex_descriptor x)
+    {
+        auto i = std::find(l.begin(), l.end(), x);
+        if (i != l.end())
+        {
+            *i = l.back();
+            l.pop_back();
+        }
+    }
+
+    void remove_non_tree(vertex_descriptor u, vertex_descriptor v)
+    {
+        drop(m_non_tree[u], v);
+        drop(m_non_tree[v], u);
+        set_non_tree_flag(u);
+        set_non_tree_flag(v);
+    }
+
+    ///@brief After cutting {u, v}, look for a non-tree edge reconnecting the
+    ///       two trees, scanning the smaller one.
+    void replace(vertex_descriptor u, vertex_descriptor v)
+    {
+        size_t ru = root(m_vertex_node[u]);
+        size_t rv = root(m_vertex_node[v]);
+        size_t small = vcount(ru) <= vcount(rv) ? ru : rv;
+
+        std::vector<size_t> stack;
+        if (flag(small))
+            stack.push_back(small);
+        while (!stack.empty())
+        {
+            size_t x = stack.back();
+            stack.pop_back();
+            const node &n = m_nodes[x];
+            if (n.has_non_tree)
+            {
+                for (vertex_descriptor y : m_non_tree[n.vd])
+                {
+                    if (root(m_vertex_node[y]) != small)
+                    {
+                        vertex_descriptor a = n.vd;
+                        remove_non_tree(a, y);
+                        link(a, y, m_edges[key(a, y)]);
+                        return;
+                    }
+                }
+            }
+            if (flag(n.left))
+                stack.push_back(n.left);
+            if (flag(n.right))
+                stack.push_back(n.right);
+        }
+    }
+
+    uint32_t m_seed;                                                       // Treap priorities
+    size_t m_num_components;                                               // Trees in the forest
+    std::vector<node> m_nodes;                                             // Tour nodes
+    std::vector<size_t> m_free;                                            // Recycled tour nodes
+    std::unordered_map<vertex_descriptor, size_t> m_vertex_node;           // Vertex to its tour node
+    std::unordered_map<vertex_descriptor, std::vector<vertex_descriptor>> m_non_tree; // Non-tree neighbours
+    std::unordered_map<vertex_descriptor, std::vector<vertex_descriptor>> m_adjacent; // All neighbours, one per copy
+    std::unordered_map<edge_key, edge_record, boost::hash<edge_key>> m_edges; // Every undirected edge
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Keeps a dynamic_connectivity index in step with an undirected graph. Edges
+/// are added with insert_edge_undirected; erasing either direction of an
+/// undirected edge with erase_edge erases one edge in each direction from the
+/// graph. The initial graph need not be stored symmetrically.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph>
+class connectivity_index
+{
+public:
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::edge_descriptor edge_descriptor;
+    typedef typename std::decay<decltype((*std::declval<typename Graph::const_edge_iterator>())->property())>::type edge_property;
+    typedef typename std::decay<decltype((*std::declval<typename Graph::const_vertex_iterator>())->property())>::type vertex_property;
+
+    ///@brief Index the current contents of g. Each stored edge is taken as
+    ///       the undirected edge {min, max}; {u, v} gets as many copies as the
+    ///       more frequent of its two directions, so a symmetric pair counts
+    ///       once and a one-directional edge is not lost.
+    explicit connectivity_index(Graph &g) : m_graph(g)
+    {
+        for (auto vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+            m_index.insert_vertex((*vi)->descriptor());
+        std::unordered_map<std::pair<vertex_descriptor, vertex_descriptor>, std::pair<size_t, size_t>,
+                           boost::hash<std::pair<vertex_descriptor, vertex_descriptor>>>
+            copies; // {min, max} to (min -> max, max -> min) counts
+        for (auto ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+        {
+            vertex_descriptor s = (*ei)->source(), t = (*ei)->target();
+            auto &c = copies[std::make_pair(std::min(s, t), std::max(s, t))];
+            ++(s <= t ? c.first : c.second);
+        }
+        for (auto &c : copies)
+            for (size_t k = std::max(c.second.first, c.second.second); k; --k)
+                m_index.insert_edge(c.first.first, c.first.second);
+    }
+
+    bool connected(vertex_descriptor u, vertex_descriptor v) const { return m_index.connected(u, v); }
+    size_t component_size(vertex_descriptor v) const { return m_index.component_size(v); }
+    size_t num_components() const { return m_index.num_components(); }
+
+    vertex_descriptor insert_vertex(const vertex_property &vp)
+    {
+        vertex_descriptor vd = m_graph.insert_vertex(vp);
+        m_index.insert_vertex(vd);
+        return vd;
+    }
+
+    void erase_vertex(vertex_descriptor vd)
+    {
+        m_graph.erase_vertex(vd);
+        m_index.erase_vertex(vd);
+    }
+
+    // The index holds max(#(u -> v), #(v -> u)) copies of {u, v}. The graph
+    // decides how many edges an update really adds or removes (graph ignores
+    // a duplicate direction, graph_vector keeps parallel edges), so both
+    // modifiers look at the change in num_edges.
+
+    void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td, const edge_property &ep)
+    {
+        size_t before = m_graph.num_edges();
+        m_graph.insert_edge_undirected(sd, td, ep);
+        // both directions new: one more copy; only one new: the pair existed
+        if (m_graph.num_edges() == before + 2)
+            m_index.insert_edge(sd, td);
+    }
+
+    void erase_edge(edge_descriptor ed)
+    {
+        size_t before = m_graph.num_edges();
+        m_graph.erase_edge(ed);
+        if (ed.first != ed.second)
+            m_graph.erase_edge(edge_descriptor(ed.second, ed.first));
+        if (m_graph.num_edges() < before)
+            m_index.erase_edge(ed.first, ed.second);
+    }
+
+private:
+    Graph &m_graph;
+    dynamic_connectivity<vertex_descriptor> m_index;
+};
+
+#endif
@@ -0,0 +1,408 @@
+#ifndef _GRAPH_DYNAMIC_TRAVERSAL_H_
+#define _GRAPH_DYNAMIC_TRAVERSAL_H_
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "graph shortest paths.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Single-source shortest paths (or BFS levels with unit_weight) that are kept
+/// up to date while edges are inserted into and erased from the graph.
+///
+/// All modifications go through this object, which forwards them to the graph
+/// and repairs the distance and parent maps:
+///
+///  - insert: if the new edge shortens the path to its target, the improvement
+///    is propagated with Dijkstra-style re-relaxation from that target only.
+///  - erase: if the edge is a tree edge, the subtree below it is the affected
+///    set (Ramalingam-Reps). Affected vertices are reset, seeded from their
+///    unaffected in-neighbours and settled with a Dijkstra restricted to the
+///    affected set.
+///
+/// When a single repair would touch more than recompute_ratio * num_vertices
+/// vertices, or a batch holds more than recompute_ratio * num_edges updates,
+/// the maps are recomputed from scratch instead.
+///
+/// Weights must be non-negative. The object mirrors the adjacency with weights
+/// so repairs never go through find_vertex. The mirror follows the edge
+/// multiplicity of the graph: an insert is mirrored only if the graph stored a
+/// new edge (graph ignores a duplicate (source, target), graph_vector keeps
+/// parallel edges), and an erase drops the arc with the weight of the edge
+/// the graph actually erased.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph, typename WeightMap = edge_property_weight>
+class dynamic_shortest_paths
+{
+public:
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::edge_descriptor edge_descriptor;
+    typedef typename std::decay<decltype(std::declval<WeightMap>()(*std::declval<typename Graph::const_edge_iterator>()))>::type distance_type;
+    typedef typename std::decay<decltype((*std::declval<typename Graph::const_edge_iterator>())->property())>::type edge_property;
+    typedef typename std::decay<decltype((*std::declval<typename Graph::const_vertex_iterator>())->property())>::type vertex_property;
+
+    ///@brief One modification of a batch.
+    struct update
+    {
+        bool insert;            // insert or erase
+        vertex_descriptor source;
+        vertex_descriptor target;
+        edge_property property; // used by inserts only
+    };
+
+    /// statistics of the last repairs
+    struct repair_stats
+    {
+        size_t incremental = 0;   // Updates repaired incrementally
+        size_t recomputations = 0; // Full recomputations
+        size_t relaxed = 0;        // Vertices whose distance was updated incrementally
+    };
+
+    dynamic_shortest_paths(Graph &g, vertex_descriptor source, WeightMap w = WeightMap(),
+                           double recompute_ratio = 0.1)
+        : m_graph(g), m_source(source), m_weight(w), m_ratio(recompute_ratio)
+    {
+        typedef typename Graph::const_edge_iterator edge_iterator;
+        typedef typename Graph::const_vertex_iterator vertex_iterator;
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            m_out[(*vi)->descriptor()];
+            m_in[(*vi)->descriptor()];
+        }
+        for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+            add_arc((*ei)->source(), (*ei)->target(), m_weight(*ei));
+        recompute();
+    }
+
+    dynamic_shortest_paths(const dynamic_shortest_paths &) = delete;
+    dynamic_shortest_paths &operator=(const dynamic_shortest_paths &) = delete;
+
+    // queries
+
+    static distance_type infinity() { return std::numeric_limits<distance_type>::max(); }
+
+    vertex_descriptor source() const { return m_source; }
+    bool reachable(vertex_descriptor v) const { return distance(v) != infinity(); }
+    distance_type distance(vertex_descriptor v) const
+    {
+        auto i = m_dist.find(v);
+        return i == m_dist.end() ? infinity() : i->second;
+    }
+    ///@brief Parent in the shortest-path tree, -1 for the source and for
+    ///       unreachable vertices (as in breadth_first_search).
+    long parent(vertex_descriptor v) const
+    {
+        auto i = m_parent.find(v);
+        return i == m_parent.end() ? -1 : i->second;
+    }
+
+    ///@brief Copy the tree into any ParentMap / DistanceMap.
+    template <typename ParentMap>
+    void parents(ParentMap &p) const
+    {
+        p.clear();
+        for (auto &v : m_out)
+            p[v.first] = parent(v.first);
+    }
+    template <typename DistanceMap>
+    void distances(DistanceMap &d) const
+    {
+        d.clear();
+        for (auto &v : m_dist)
+            d[v.first] = v.second;
+    }
+
+    const repair_stats &stats() const { return m_stats; }
+
+    // modifiers, forwarded to the graph
+
+    vertex_descriptor insert_vertex(const vertex_property &vp)
+    {
+        vertex_descriptor vd = m_graph.insert_vertex(vp);
+        m_out[vd];
+        m_in[vd];
+        return vd;
+    }
+
+    edge_descriptor insert_edge(vertex_descriptor sd, vertex_descriptor td, const edge_property &ep)
+    {
+        distance_type w;
+        edge_descriptor ed = forward_insert(sd, td, ep, w);
+        if (w != infinity())
+            repair_insert(sd, td, w);
+        return ed;
+    }
+
+    void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td, const edge_property &ep)
+    {
+        insert_edge(sd, td, ep);
+        insert_edge(td, sd, ep);
+    }
+
+    void erase_edge(edge_descriptor ed)
+    {
+        if (forward_erase(ed))
+            repair_erase(ed.first, ed.second);
+    }
+
+    void erase_vertex(vertex_descriptor vd)
+    {
+        // detach through the repair path, then drop the vertex
+        std::vector<edge_descriptor> incident;
+        for (auto &a : m_out[vd])
+            incident.emplace_back(vd, a.first);
+        for (auto &a : m_in[vd])
+            if (a.first != vd)
+                incident.emplace_back(a.first, vd);
+        for (auto &ed : incident)
+            if (remove_arc(ed.first, ed.second))
+                repair_erase(ed.first, ed.second);
+        m_graph.erase_vertex(vd);
+        m_out.erase(vd);
+        m_in.erase(vd);
+        m_dist.erase(vd);
+        m_parent.erase(vd);
+        if (vd == m_source)
+            recompute();
+    }
+
+    ///@brief Apply several updates; falls back to one recomputation when the
+    ///       batch is large relative to the graph.
+    void apply(const std::vector<update> &batch)
+    {
+        if (batch.size() > m_ratio * std::max<size_t>(1, m_graph.num_edges()))
+        {
+            for (const update &u : batch)
+            {
+                distance_type w;
+                if (u.insert)
+                    forward_insert(u.source, u.target, u.property, w);
+                else
+                    forward_erase(edge_descriptor(u.source, u.target));
+            }
+            recompute();
+            return;
+        }
+        for (const update &u : batch)
+        {
+            if (u.insert)
+                insert_edge(u.source, u.target, u.property);
+            else
+                erase_edge(edge_descriptor(u.source, u.target));
+        }
+    }
+
+    ///@brief Dijkstra from the source over the mirrored adjacency.
+    void recompute()
+    {
+        ++m_stats.recomputations;
+        m_dist.clear();
+        m_parent.clear();
+        if (!m_out.count(m_source))
+            return;
+        m_dist[m_source] = distance_type();
+        settle({{distance_type(), m_source}}, nullptr, nullptr);
+    }
+
+private:
+    ///@brief Edge handle over an edge that is being inserted, so the weight is
+    ///       taken from the inserted property even if parallel edges exist.
+    struct new_edge
+    {
+        new_edge(vertex_descriptor s, vertex_descriptor t, const edge_property &p) : m_source(s), m_target(t), m_property(p) {}
+
+        const new_edge *operator->() const { return this; }
+        vertex_descriptor source() const { return m_source; }
+        vertex_descriptor target() const { return m_target; }
+        edge_descriptor descriptor() const { return {m_source, m_target}; }
+        const edge_property &property() const { return m_property; }
+
+        vertex_descriptor m_source;
+        vertex_descriptor m_target;
+        const edge_property &m_property;
+    };
+
+    typedef std::pair<distance_type, vertex_descriptor> queue_entry;
+    typedef std::priority_queue<queue_entry, std::vector<queue_entry>, std::greater<queue_entry>> min_queue;
+    typedef std::vector<std::pair<vertex_descriptor, distance_type>> arc_list;
+
+    void add_arc(vertex_descriptor s, vertex_descriptor t, distance_type w)
+    {
+        m_out[s].emplace_back(t, w);
+        m_in[t].emplace_back(s, w);
+    }
+
+    ///@brief Insert into the graph and mirror the arc if the graph stored a
+    ///       new edge. w receives its weight, or infinity() if the graph
+    ///       ignored the insert.
+    edge_descriptor forward_insert(vertex_descriptor sd, vertex_descriptor td, const edge_property &ep,
+                                   distance_type &w)
+    {
+        size_t before = m_graph.num_edges();
+        edge_descriptor ed = m_graph.insert_edge(sd, td, ep);
+        w = infinity();
+        if (m_graph.num_edges() == before)
+            return ed;
+        w = m_weight(new_edge(sd, td, ep));
+        add_arc(sd, td, w);
+        return ed;
+    }
+
+    ///@brief Erase ed from the graph and the mirrored arc of the same
+    ///       weight; false if the graph had no such edge. Among parallel
+    ///       edges the graph picks which one goes, so look it up first.
+    bool forward_erase(edge_descriptor ed)
+    {
+        auto ei = m_graph.find_edge(ed);
+        if (ei == m_graph.edges_end())
+            return false;
+        distance_type w = m_weight(*ei);
+        m_graph.erase_edge(ed);
+        return remove_arc(ed.first, ed.second, &w);
+    }
+
+    ///@brief Remove one s->t arc, of weight *w if given; false if there was
+    ///       none.
+    bool remove_arc(vertex_descriptor s, vertex_descriptor t, const distance_type *w = nullptr)
+    {
+        auto drop = [w](arc_list &l, vertex_descriptor x)
+        {
+            auto i = std::find_if(l.begin(), l.end(), [&](const std::pair<vertex_descriptor, distance_type> &a)
+                                  { return a.first == x && (!w || a.second == *w); });
+            if (i == l.end())
+                return false;
+            l.erase(i);
+            return true;
+        };
+        auto o = m_out.find(s);
+        auto i = m_in.find(t);
+        if (o == m_out.end() || i == m_in.end() || !drop(o->second, t))
+            return false;
+        drop(i->second, s);
+        return true;
+    }
+
+    ///@brief Dijkstra from the seeds. If limit is given, vertices outside it
+    ///       are not updated; if budget is given, stop and return false once
+    ///       more than *budget vertices were settled.
+    bool settle(std::vector<queue_entry> seeds, const std::unordered_set<vertex_descriptor> *limit,
+                const size_t *budget)
+    {
+        min_queue q(std::greater<queue_entry>(), std::move(seeds));
+        size_t settled = 0;
+        while (!q.empty())
+        {
+            queue_entry top = q.top();
+            q.pop();
+            if (top.first != distance(top.second))
+                continue; // stale
+            if (budget && ++settled > *budget)
+                return false;
+            for (auto &a : m_out[top.second])
+            {
+                if (limit && !limit->count(a.first))
+                    continue;
+                distance_type nd = top.first + a.second;
+                if (nd < distance(a.first))
+                {
+                    m_dist[a.first] = nd;
+                    m_parent[a.first] = top.second;
+                    q.emplace(nd, a.first);
+                }
+            }
+        }
+        m_stats.relaxed += settled;
+        return true;
+    }
+
+    void repair_insert(vertex_descriptor s, vertex_descriptor t, distance_type w)
+    {
+        if (!reachable(s) || distance(s) + w >= distance(t))
+            return;
+        m_dist[t] = distance(s) + w;
+        m_parent[t] = s;
+        size_t budget = static_cast<size_t>(m_ratio * m_out.size()) + 1;
+        if (settle({{m_dist[t], t}}, nullptr, &budget))
+            ++m_stats.incremental;
+        else
+            recompute();
+    }
+
+    void repair_erase(vertex_descriptor s, vertex_descriptor t)
+    {
+        if (parent(t) != static_cast<long>(s))
+            return; // not a tree edge
+        // an equally short parallel edge keeps the tree valid
+        for (auto &a : m_in[t])
+            if (a.first == s && distance(s) + a.second == distance(t))
+                return;
+
+        // affected set: subtree of t in the shortest-path tree
+        size_t budget = static_cast<size_t>(m_ratio * m_out.size()) + 1;
+        std::unordered_set<vertex_descriptor> affected;
+        std::vector<vertex_descriptor> stack(1, t);
+        affected.insert(t);
+        while (!stack.empty())
+        {
+            vertex_descriptor x = stack.back();
+            stack.pop_back();
+            for (auto &a : m_out[x])
+                if (parent(a.first) == static_cast<long>(x) && affected.insert(a.first).second)
+                    stack.push_back(a.first);
+            if (affected.size() > budget)
+            {
+                recompute();
+                return;
+            }
+        }
+
+        // reset and seed from unaffected in-neighbours
+        for (auto x : affected)
+        {
+            m_dist.erase(x);
+            m_parent.erase(x);
+        }
+        std::vector<queue_entry> seeds;
+        for (auto x : affected)
+        {
+            for (auto &a : m_in[x])
+            {
+                if (affected.count(a.first) || !reachable(a.first))
+                    continue;
+                distance_type nd = distance(a.first) + a.second;
+                if (nd < distance(x))
+                {
+                    m_dist[x] = nd;
+                    m_parent[x] = a.first;
+                }
+            }
+            if (reachable(x))
+                seeds.emplace_back(m_dist[x], x);
+        }
+        settle(std::move(seeds), &affected, nullptr);
+        ++m_stats.incremental;
+    }
+
+    Graph &m_graph;                                             // Graph being maintained
+    vertex_descriptor m_source;                                 // Root of the tree
+    WeightMap m_weight;                                         // Edge weight functor
+    double m_ratio;                                             // Recompute threshold
+    std::unordered_map<vertex_descriptor, arc_list> m_out;      // Mirrored out-arcs with weights
+    std::unordered_map<vertex_descriptor, arc_list> m_in;       // Mirrored in-arcs with weights
+    std::unordered_map<vertex_descriptor, distance_type> m_dist; // Reachable vertices only
+    std::unordered_map<vertex_descriptor, vertex_descriptor> m_parent;
+    repair_stats m_stats;
+};
+
+///@brief BFS tree maintained under edge updates.
+template <typename Graph>
+using dynamic_breadth_first_search = dynamic_shortest_paths<Graph, unit_weight>;
+
+#endif
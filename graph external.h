@@ -0,0 +1,434 @@
+#ifndef _GRAPH_EXTERNAL_H_
+#define _GRAPH_EXTERNAL_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Semi-external traversal for graphs whose adjacency does not fit in memory.
+// Per-vertex state (parents, visited bits) stays in RAM. The adjacency lives
+// in a sharded edge file on disk and is read in sequential blocks.
+//
+// File layout (all integers uint64 in the byte order of the machine that
+// wrote the file, so blocks are read straight into memory):
+//
+//   header   "GRAPHEXT", num_vertices, num_edges, num_blocks,
+//            descriptors offset, block index offset, version, byte order mark
+//   blocks   for the vertices [first, last) of each block: last - first + 1
+//            offsets into the block's target list, then the targets
+//   table    the descriptor of every vertex
+//   index    first, last, file offset and byte size of every block
+//
+// Vertices are numbered densely in the vertex iteration order of the graph
+// the file was written from, and targets are stored as those dense ids. Each
+// block holds whole adjacency lists of about block_bytes. Edge properties are
+// not stored.
+//
+// A reader rejects a file whose magic, version or byte order mark differ, or
+// whose header and block index point outside the file; a block whose offsets
+// or targets are out of range fails the search that reads it.
+//
+
+///@brief The 64-byte header at the start of the edge file.
+struct external_header
+{
+    static constexpr uint64_t current_version = 1;
+    static constexpr uint64_t byte_order = 0x0102030405060708;
+
+    char magic[8];
+    uint64_t num_vertices;
+    uint64_t num_edges;
+    uint64_t num_blocks;
+    uint64_t descriptors_offset;
+    uint64_t blocks_offset;
+    uint64_t version;
+    uint64_t byte_order_mark;
+};
+
+///@brief One shard of the edge file: the out edges of vertices [first, last).
+struct external_block
+{
+    uint64_t first;
+    uint64_t last;
+    uint64_t offset; // file offset of the block
+    uint64_t bytes;  // block size in bytes
+};
+
+///@brief Write the adjacency of g to path in blocks of about block_bytes.
+///       Returns false if the file cannot be written.
+template <typename Graph>
+bool write_external_edges(const Graph &g, const std::string &path, size_t block_bytes = 1 << 20)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+
+    // setup
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os)
+        return false;
+    std::unordered_map<vertex_descriptor, uint64_t> index;
+    std::vector<uint64_t> descriptors;
+    index.reserve(g.num_vertices());
+    descriptors.reserve(g.num_vertices());
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        index.emplace((*vi)->descriptor(), descriptors.size());
+        descriptors.push_back((*vi)->descriptor());
+    }
+    external_header header = external_header();
+    std::memcpy(header.magic, "GRAPHEXT", 8);
+    header.version = external_header::current_version;
+    header.byte_order_mark = external_header::byte_order;
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // blocks
+    std::vector<external_block> blocks;
+    std::vector<uint64_t> offsets(1, 0), targets;
+    uint64_t num_edges = 0;
+    uint64_t first = 0;
+    auto flush = [&](uint64_t last)
+    {
+        external_block b;
+        b.first = first;
+        b.last = last;
+        b.offset = static_cast<uint64_t>(os.tellp());
+        b.bytes = (offsets.size() + targets.size()) * sizeof(uint64_t);
+        os.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        os.write(reinterpret_cast<const char *>(targets.data()), targets.size() * sizeof(uint64_t));
+        blocks.push_back(b);
+        offsets.assign(1, 0);
+        targets.clear();
+        first = last;
+    };
+    uint64_t v = 0;
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi, ++v)
+    {
+        for (auto aei = (*vi)->cbegin(); aei != (*vi)->cend(); ++aei)
+            targets.push_back(index.at((*aei)->target()));
+        offsets.push_back(targets.size());
+        num_edges += offsets.back() - offsets[offsets.size() - 2];
+        if ((offsets.size() + targets.size()) * sizeof(uint64_t) >= block_bytes)
+            flush(v + 1);
+    }
+    if (v > first || blocks.empty())
+        flush(v);
+
+    // descriptor table and block index
+    header.num_vertices = descriptors.size();
+    header.num_edges = num_edges;
+    header.num_blocks = blocks.size();
+    header.descriptors_offset = static_cast<uint64_t>(os.tellp());
+    os.write(reinterpret_cast<const char *>(descriptors.data()), descriptors.size() * sizeof(uint64_t));
+    header.blocks_offset = static_cast<uint64_t>(os.tellp());
+    os.write(reinterpret_cast<const char *>(blocks.data()), blocks.size() * sizeof(external_block));
+    os.seekp(0);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    return static_cast<bool>(os);
+}
+
+///@brief I/O counters of an external_edge_file.
+struct external_io_stats
+{
+    uint64_t bytes_read = 0;  // Bytes read from the file
+    uint64_t read_calls = 0;  // pread calls issued
+    uint64_t blocks_read = 0; // Blocks loaded, counting repeats
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read access to a file written by write_external_edges. Only the header and
+/// the block index are kept in memory. The file is closed (is_open() false) if
+/// the header or the block index does not fit the file.
+////////////////////////////////////////////////////////////////////////////////
+class external_edge_file
+{
+public:
+    explicit external_edge_file(const std::string &path) : m_fd(::open(path.c_str(), O_RDONLY))
+    {
+        if (!open_file())
+            close_file();
+        m_io = external_io_stats();
+    }
+    ~external_edge_file() { close_file(); }
+    external_edge_file(const external_edge_file &) = delete;            ///< Copy is disabled.
+    external_edge_file &operator=(const external_edge_file &) = delete; ///< Copy is disabled.
+
+    bool is_open() const { return m_fd >= 0; }
+    uint64_t num_vertices() const { return m_num_vertices; }
+    uint64_t num_edges() const { return m_num_edges; }
+    const std::vector<external_block> &blocks() const { return m_blocks; }
+    const external_io_stats &io() const { return m_io; }
+
+    ///@brief Block holding the adjacency of dense vertex v.
+    size_t block_of(uint64_t v) const
+    {
+        auto i = std::upper_bound(m_blocks.begin(), m_blocks.end(), v,
+                                  [](uint64_t x, const external_block &b)
+                                  { return x < b.first; });
+        return i - m_blocks.begin() - 1;
+    }
+
+    ///@brief Read the consecutive blocks [b, e) with one sequential read.
+    bool read_blocks(size_t b, size_t e, std::vector<uint64_t> &buf)
+    {
+        uint64_t bytes = m_blocks[e - 1].offset + m_blocks[e - 1].bytes - m_blocks[b].offset;
+        buf.resize(bytes / sizeof(uint64_t));
+        m_io.blocks_read += e - b;
+        return read_at(m_blocks[b].offset, buf.data(), bytes);
+    }
+
+    ///@brief Read the descriptors of dense vertices [first, first + count).
+    bool read_descriptors(uint64_t first, uint64_t count, uint64_t *out)
+    {
+        return read_at(m_descriptors_offset + first * sizeof(uint64_t), out, count * sizeof(uint64_t));
+    }
+
+private:
+    ///@brief Read and check the header and the block index: the blocks must
+    ///       cover [0, num_vertices) in order, lie back to back after the
+    ///       header and hold at least their offset lists.
+    bool open_file()
+    {
+        external_header header;
+        struct stat st;
+        if (m_fd < 0 || ::fstat(m_fd, &st) != 0 || !read_at(0, &header, sizeof(header)))
+            return false;
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        const uint64_t word = sizeof(uint64_t);
+        if (std::memcmp(header.magic, "GRAPHEXT", 8) != 0 || header.version != external_header::current_version ||
+            header.byte_order_mark != external_header::byte_order)
+            return false;
+        if (header.num_vertices > size / word || header.num_edges > size / word ||
+            header.num_blocks == 0 || header.num_blocks > size / sizeof(external_block) ||
+            header.descriptors_offset > size - header.num_vertices * word ||
+            header.blocks_offset > size - header.num_blocks * sizeof(external_block))
+            return false;
+        m_blocks.resize(header.num_blocks);
+        if (!read_at(header.blocks_offset, m_blocks.data(), m_blocks.size() * sizeof(external_block)))
+            return false;
+        uint64_t first = 0, offset = sizeof(header);
+        for (auto &b : m_blocks)
+        {
+            if (b.first != first || b.last < b.first || b.last > header.num_vertices || b.offset != offset ||
+                b.bytes % word != 0 || b.bytes > size - b.offset || b.bytes / word < b.last - b.first + 1)
+                return false;
+            first = b.last;
+            offset += b.bytes;
+        }
+        if (first != header.num_vertices)
+            return false;
+        m_num_vertices = header.num_vertices;
+        m_num_edges = header.num_edges;
+        m_descriptors_offset = header.descriptors_offset;
+        return true;
+    }
+
+    bool read_at(uint64_t offset, void *out, uint64_t bytes)
+    {
+        char *dst = static_cast<char *>(out);
+        while (bytes)
+        {
+            ssize_t r = ::pread(m_fd, dst, bytes, static_cast<off_t>(offset));
+            ++m_io.read_calls;
+            if (r <= 0)
+                return false;
+            m_io.bytes_read += r;
+            dst += r;
+            offset += r;
+            bytes -= r;
+        }
+        return true;
+    }
+
+    void close_file()
+    {
+        if (m_fd >= 0)
+            ::close(m_fd);
+        m_fd = -1;
+        m_num_vertices = 0;
+        m_num_edges = 0;
+        m_blocks.clear();
+    }
+
+    int m_fd;
+    uint64_t m_num_vertices = 0;
+    uint64_t m_num_edges = 0;
+    uint64_t m_descriptors_offset = 0;
+    std::vector<external_block> m_blocks;
+    external_io_stats m_io;
+};
+
+///@brief Counters reported by external_breadth_first_search.
+struct external_bfs_stats
+{
+    bool ok = false;             // False on I/O errors or a budget below the minimum
+    size_t roots = 0;            // Searches started, one per root
+    size_t levels = 0;           // Levels over all searches
+    size_t buffer_bytes = 0;     // Size of the adjacency read buffer
+    size_t peak_state_bytes = 0; // In-RAM vertex state: parents, visited bits and queue
+    external_io_stats io;        // I/O of this search
+    double seconds = 0;          // Wall time
+};
+
+///@brief Semi-external breadth-first search over an edge file, with the same
+///       roots and parent convention as breadth_first_search (roots in vertex
+///       order, parent -1). Each level's frontier is sorted by dense id, which
+///       is block order, so every needed block is read once per level, and
+///       runs of consecutive needed blocks are fetched with a single read as
+///       large as the buffer allows.
+///
+///       memory_budget bounds everything the search allocates except p: the
+///       parent array, the visited bits, one queue of n entries holding the
+///       current and next level, and the read buffer, which gets the rest and
+///       must hold the largest block. The queue is reused as the descriptor
+///       table for the final translation. That is about 16 bytes per vertex
+///       plus the buffer; a smaller budget fails before any I/O.
+template <typename ParentMap>
+external_bfs_stats external_breadth_first_search(external_edge_file &f, ParentMap &p,
+                                                 size_t memory_budget = size_t(256) << 20)
+{
+    // setup
+    external_bfs_stats stats;
+    auto start = std::chrono::steady_clock::now();
+    external_io_stats io_before = f.io();
+    p.clear();
+    if (!f.is_open())
+        return stats;
+    const uint64_t none = std::numeric_limits<uint64_t>::max();
+    const uint64_t root = none - 1;
+    const auto &blocks = f.blocks();
+    uint64_t n = f.num_vertices();
+    size_t state = 2 * n * sizeof(uint64_t) + (n + 63) / 64 * sizeof(uint64_t);
+    size_t largest = 0, total = 0;
+    for (auto &b : blocks)
+    {
+        largest = std::max<size_t>(largest, b.bytes);
+        total += b.bytes;
+    }
+    if (memory_budget < state + largest)
+        return stats;
+    stats.buffer_bytes = std::min(memory_budget - state, total);
+    stats.peak_state_bytes = state;
+
+    std::vector<uint64_t> parent(n, none);
+    std::vector<uint64_t> visited((n + 63) / 64, 0);
+    auto test_and_set = [&](uint64_t v)
+    {
+        uint64_t bit = uint64_t(1) << (v & 63);
+        bool was = visited[v >> 6] & bit;
+        visited[v >> 6] |= bit;
+        return was;
+    };
+    // a search visits every vertex at most once, so the current level
+    // [head, level_end) and the next one [level_end, tail) fit in n entries
+    std::vector<uint64_t> queue(n);
+    std::vector<uint64_t> buf;
+    buf.reserve(stats.buffer_bytes / sizeof(uint64_t));
+    size_t resident_begin = 0, resident_end = 0; // blocks held in buf
+    auto fail = [&]()
+    {
+        stats.io.bytes_read = f.io().bytes_read - io_before.bytes_read;
+        return stats;
+    };
+
+    // one search per root, in vertex order
+    for (uint64_t r = 0; r < n; ++r)
+    {
+        if (test_and_set(r))
+            continue;
+        ++stats.roots;
+        parent[r] = root;
+        size_t head = 0, tail = 0;
+        queue[tail++] = r;
+        while (head < tail)
+        {
+            ++stats.levels;
+            size_t level_end = tail;
+            size_t i = head;
+            while (i < level_end)
+            {
+                // load the run of needed blocks starting at queue[i]
+                size_t b = f.block_of(queue[i]);
+                if (b < resident_begin || b >= resident_end)
+                {
+                    size_t e = b + 1;
+                    size_t bytes = blocks[b].bytes;
+                    for (size_t j = i; j < level_end; ++j)
+                    {
+                        if (queue[j] < blocks[e - 1].last)
+                            continue;
+                        if (e == blocks.size() || queue[j] >= blocks[e].last ||
+                            bytes + blocks[e].bytes > stats.buffer_bytes)
+                            break;
+                        bytes += blocks[e].bytes;
+                        ++e;
+                    }
+                    if (!f.read_blocks(b, e, buf))
+                        return fail();
+                    resident_begin = b;
+                    resident_end = e;
+                }
+
+                // expand every frontier vertex held in the buffer
+                uint64_t last = blocks[resident_end - 1].last;
+                for (; i < level_end && queue[i] < last; ++i)
+                {
+                    uint64_t u = queue[i];
+                    size_t bu = f.block_of(u);
+                    const uint64_t *block = buf.data() + (blocks[bu].offset - blocks[resident_begin].offset) / sizeof(uint64_t);
+                    uint64_t count = blocks[bu].last - blocks[bu].first;
+                    uint64_t k = u - blocks[bu].first;
+                    const uint64_t *targets = block + count + 1;
+                    uint64_t num_targets = blocks[bu].bytes / sizeof(uint64_t) - count - 1;
+                    if (block[k] > block[k + 1] || block[k + 1] > num_targets)
+                        return fail();
+                    for (uint64_t e = block[k]; e < block[k + 1]; ++e)
+                    {
+                        uint64_t t = targets[e];
+                        if (t >= n)
+                            return fail();
+                        if (!test_and_set(t))
+                        {
+                            parent[t] = u;
+                            queue[tail++] = t;
+                        }
+                    }
+                }
+            }
+            std::sort(queue.begin() + level_end, queue.begin() + tail);
+            head = level_end;
+        }
+    }
+
+    // translate to descriptors, reading the table into the queue
+    std::vector<uint64_t>().swap(visited);
+    std::vector<uint64_t>().swap(buf);
+    std::vector<uint64_t> &descriptors = queue;
+    if (!f.read_descriptors(0, n, descriptors.data()))
+        return fail();
+    for (uint64_t v = 0; v < n; ++v)
+    {
+        if (parent[v] == root)
+            p[descriptors[v]] = -1;
+        else
+            p[descriptors[v]] = descriptors[parent[v]];
+    }
+
+    stats.io.bytes_read = f.io().bytes_read - io_before.bytes_read;
+    stats.io.read_calls = f.io().read_calls - io_before.read_calls;
+    stats.io.blocks_read = f.io().blocks_read - io_before.blocks_read;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.ok = true;
+    return stats;
+}
+
+#endif
@@ -0,0 +1,406 @@
+#ifndef _GRAPH_HYPERANF_H_
+#define _GRAPH_HYPERANF_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "graph core decomposition.h"
+#include "graph parallel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// HyperLogLog counters with one byte per register, so that the union of two
+/// counters is a byte-wise max that SIMD does 16, 32 or 64 registers at a
+/// time.
+////////////////////////////////////////////////////////////////////////////////
+
+///@brief dst = max(dst, src) over m registers; true if dst changed.
+inline bool hll_merge(uint8_t *dst, const uint8_t *src, size_t m)
+{
+    size_t i = 0;
+    bool changed = false;
+#if defined(__AVX512BW__)
+    for (; i + 64 <= m; i += 64)
+    {
+        __m512i d = _mm512_loadu_si512(dst + i);
+        __m512i x = _mm512_max_epu8(d, _mm512_loadu_si512(src + i));
+        changed |= _mm512_cmpneq_epu8_mask(d, x) != 0;
+        _mm512_storeu_si512(dst + i, x);
+    }
+#endif
+#if defined(__AVX2__)
+    for (; i + 32 <= m; i += 32)
+    {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i x = _mm256_max_epu8(d, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+        changed |= _mm256_movemask_epi8(_mm256_cmpeq_epi8(d, x)) != -1;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), x);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 16 <= m; i += 16)
+    {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i x = _mm_max_epu8(d, _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        changed |= _mm_movemask_epi8(_mm_cmpeq_epi8(d, x)) != 0xffff;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), x);
+    }
+#endif
+    for (; i < m; ++i)
+        if (src[i] > dst[i])
+        {
+            dst[i] = src[i];
+            changed = true;
+        }
+    return changed;
+}
+
+///@brief Add the element with 64-bit hash h to the m = 2^log2m registers.
+inline void hll_add(uint8_t *registers, unsigned log2m, uint64_t h)
+{
+    size_t j = h >> (64 - log2m);
+    uint64_t w = h << log2m;
+    uint8_t rank = w ? static_cast<uint8_t>(__builtin_clzll(w) + 1) : static_cast<uint8_t>(64 - log2m + 1);
+    registers[j] = std::max(registers[j], rank);
+}
+
+///@brief Cardinality estimate of m = 2^log2m registers, with linear counting
+///       for small cardinalities (Flajolet et al.).
+inline double hll_estimate(const uint8_t *registers, unsigned log2m)
+{
+    size_t m = size_t(1) << log2m;
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t j = 0; j < m; ++j)
+    {
+        sum += std::ldexp(1.0, -registers[j]);
+        zeros += registers[j] == 0;
+    }
+    double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709 : 0.7213 / (1 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros)
+        e = m * std::log(static_cast<double>(m) / zeros);
+    return e;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// HyperANF (Boldi, Rosa and Vigna): approximate neighbourhood function,
+/// harmonic and closeness centrality, and effective diameter.
+///
+/// Every vertex v holds a HyperLogLog counter of its ball B(v, t), the
+/// vertices that reach v in at most t steps. Iteration t + 1 sets
+///
+///     B(v, t + 1) = B(v, t) united with B(u, t) for each edge u -> v
+///
+/// sweeping the edges grouped by target, so each thread owns the counters it
+/// writes. A counter only changes if the counter of an in-neighbour changed in
+/// the previous iteration, so unchanged regions are skipped; the run ends
+/// when no counter changes. The increments of |B(v, t)| give for every v the
+/// number of vertices at distance exactly t, from which
+///
+///   - the neighbourhood function N(t) = sum over v of |B(v, t)|,
+///   - harmonic centrality sum over u != v of 1 / d(u, v),
+///   - closeness centrality (reachable - 1) / sum of d(u, v)
+///
+/// follow. Precision is 2^log2m registers per vertex (log2m in [4, 16]),
+/// relative standard deviation 1.04 / sqrt(2^log2m), memory 2 n 2^log2m bytes.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph>
+class hyperanf
+{
+public:
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+
+    hyperanf(const Graph &g, unsigned log2m = 6, uint64_t seed = 1)
+        : m_log2m(std::min(16u, std::max(4u, log2m))), m_m(size_t(1) << m_log2m)
+    {
+        typedef typename Graph::const_vertex_iterator vertex_iterator;
+        typedef typename Graph::const_edge_iterator edge_iterator;
+
+        // setup: in-edges grouped by target
+        std::unordered_map<vertex_descriptor, size_t> index;
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            index.emplace((*vi)->descriptor(), m_descriptors.size());
+            m_descriptors.push_back((*vi)->descriptor());
+        }
+        size_t n = m_descriptors.size();
+        std::vector<std::pair<size_t, size_t>> edges;
+        for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+            edges.emplace_back(index.at((*ei)->target()), index.at((*ei)->source()));
+        m_offsets.assign(n + 1, 0);
+        for (auto &e : edges)
+            ++m_offsets[e.first + 1];
+        for (size_t v = 0; v < n; ++v)
+            m_offsets[v + 1] += m_offsets[v];
+        std::vector<size_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+        m_sources.resize(edges.size());
+        for (auto &e : edges)
+            m_sources[fill[e.first]++] = e.second;
+
+        // B(v, 0) = {v}
+        m_counters.assign(n * m_m, 0);
+        for (size_t v = 0; v < n; ++v)
+            hll_add(&m_counters[v * m_m], m_log2m, mix(v ^ (seed * 0x9e3779b97f4a7c15ULL)));
+        m_size.resize(n);
+        for (size_t v = 0; v < n; ++v)
+            m_size[v] = hll_estimate(&m_counters[v * m_m], m_log2m);
+        m_harmonic.assign(n, 0);
+        m_distance_sum.assign(n, 0);
+        m_changed.assign(n, 1);
+        double total = 0;
+        for (double s : m_size)
+            total += s;
+        m_nf.assign(1, total);
+    }
+
+    hyperanf(const hyperanf &) = delete;            ///< Copy is disabled.
+    hyperanf &operator=(const hyperanf &) = delete; ///< Copy is disabled.
+
+    static double relative_standard_deviation(unsigned log2m) { return 1.04 / std::sqrt(double(size_t(1) << log2m)); }
+
+    ///@brief Iterate until no counter changes or max_iterations more
+    ///       iterations ran. Returns true if the counters have converged.
+    bool run(size_t max_iterations = std::numeric_limits<size_t>::max(), size_t num_threads = 0)
+    {
+        if (num_threads == 0)
+            num_threads = default_num_threads();
+        size_t n = m_descriptors.size();
+        std::vector<uint8_t> next(m_counters.size());
+        std::vector<uint8_t> next_changed(n);
+        std::vector<double> sums(num_threads);
+        std::vector<size_t> changes(num_threads);
+        for (size_t it = 0; it < max_iterations && !m_converged; ++it)
+        {
+            double t = static_cast<double>(m_nf.size());
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(changes.begin(), changes.end(), 0);
+            parallel_chunks(
+                0, n, [&](size_t tid, size_t lo, size_t hi)
+                {
+                    for (size_t v = lo; v < hi; ++v)
+                    {
+                        uint8_t *dst = &next[v * m_m];
+                        std::memcpy(dst, &m_counters[v * m_m], m_m);
+                        bool changed = false;
+                        for (size_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i)
+                            if (m_changed[m_sources[i]])
+                                changed |= hll_merge(dst, &m_counters[m_sources[i] * m_m], m_m);
+                        next_changed[v] = changed;
+                        if (changed)
+                        {
+                            double size = hll_estimate(dst, m_log2m);
+                            double delta = std::max(0.0, size - m_size[v]);
+                            m_harmonic[v] += delta / t;
+                            m_distance_sum[v] += delta * t;
+                            m_size[v] = std::max(size, m_size[v]);
+                            ++changes[tid];
+                        }
+                        sums[tid] += m_size[v];
+                    } },
+                num_threads);
+            m_counters.swap(next);
+            m_changed.swap(next_changed);
+            size_t changed = 0;
+            double total = 0;
+            for (size_t k = 0; k < num_threads; ++k)
+            {
+                changed += changes[k];
+                total += sums[k];
+            }
+            if (changed == 0)
+                m_converged = true;
+            else
+                m_nf.push_back(total);
+        }
+        return m_converged;
+    }
+
+    ///@brief N(t) for t = 0, 1, ... up to the last iteration that changed a
+    ///       counter: the number of pairs (u, v) with d(u, v) <= t.
+    const std::vector<double> &neighbourhood_function() const { return m_nf; }
+
+    ///@brief Smallest t, interpolated between iterations, with
+    ///       N(t) >= alpha N(last). alpha = 0.9 is the usual effective diameter.
+    double effective_diameter(double alpha = 0.9) const
+    {
+        double goal = alpha * m_nf.back();
+        size_t t = 0;
+        while (m_nf[t] < goal)
+            ++t;
+        if (t == 0)
+            return 0;
+        return (t - 1) + (goal - m_nf[t - 1]) / (m_nf[t] - m_nf[t - 1]);
+    }
+
+    ///@brief c[vd] = sum over u != vd of 1 / d(u, vd), estimated.
+    template <typename CentralityMap>
+    void harmonic_centrality(CentralityMap &c) const
+    {
+        c.clear();
+        for (size_t v = 0; v < m_descriptors.size(); ++v)
+            c[m_descriptors[v]] = m_harmonic[v];
+    }
+
+    ///@brief c[vd] = (vertices reaching vd - 1) / sum of their distances to
+    ///       vd, estimated; 0 if nothing else reaches vd.
+    template <typename CentralityMap>
+    void closeness_centrality(CentralityMap &c) const
+    {
+        c.clear();
+        for (size_t v = 0; v < m_descriptors.size(); ++v)
+            c[m_descriptors[v]] = m_distance_sum[v] > 0 ? (m_size[v] - 1) / m_distance_sum[v] : 0.0;
+    }
+
+    ///@brief Estimated number of vertices reaching the vertex at position v
+    ///       (in the order of vertices_cbegin()) within the iterations run so
+    ///       far, v included.
+    double reach(size_t v) const { return m_size[v]; }
+
+private:
+    ///@brief splitmix64 finaliser.
+    static uint64_t mix(uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    unsigned m_log2m;
+    size_t m_m; // Registers per counter
+    std::vector<vertex_descriptor> m_descriptors;
+    std::vector<size_t> m_offsets;      // In-edges of v are [m_offsets[v], m_offsets[v + 1])
+    std::vector<size_t> m_sources;      // Source of each in-edge
+    std::vector<uint8_t> m_counters;    // m_m registers per vertex
+    std::vector<uint8_t> m_changed;     // Counter changed in the last iteration
+    std::vector<double> m_size;         // Current |B(v, t)| estimate
+    std::vector<double> m_harmonic;     // Sum of increment / t
+    std::vector<double> m_distance_sum; // Sum of increment * t
+    std::vector<double> m_nf;           // Neighbourhood function
+    bool m_converged = false;
+};
+
+///@brief Outcome of undirected_diameter.
+struct diameter_result
+{
+    size_t diameter = 0; // Largest eccentricity over all components
+    size_t bfs_runs = 0; // Full BFS traversals spent
+};
+
+///@brief BFS over adj from s; dist must be all npos and is restored before
+///       returning. Returns (eccentricity of s, a vertex at that distance);
+///       the visited vertices by level are left in order, levels in level.
+inline std::pair<size_t, size_t> diameter_bfs(const std::vector<std::vector<size_t>> &adj, size_t s,
+                                              std::vector<size_t> &dist, std::vector<size_t> &order,
+                                              std::vector<size_t> *level = nullptr)
+{
+    const size_t npos = std::numeric_limits<size_t>::max();
+    order.assign(1, s);
+    dist[s] = 0;
+    for (size_t head = 0; head < order.size(); ++head)
+    {
+        size_t u = order[head];
+        for (size_t t : adj[u])
+            if (dist[t] == npos)
+            {
+                dist[t] = dist[u] + 1;
+                order.push_back(t);
+            }
+    }
+    size_t far = order.back();
+    size_t ecc = dist[far];
+    if (level)
+        for (size_t v : order)
+            (*level)[v] = dist[v];
+    for (size_t v : order)
+        dist[v] = npos;
+    return std::make_pair(ecc, far);
+}
+
+///@brief Exact diameter of the undirected graph underlying g, by iFUB
+///       (Crescenzi et al.) started from the midpoint of a double sweep.
+///       After a BFS from the centre u, the eccentricities of the vertices
+///       in the deepest level i bound every diameter path with an endpoint
+///       below level i by 2(i - 1), so levels are peeled from the bottom
+///       until that bound cannot beat the best eccentricity found. Usually
+///       a handful of BFS runs per component instead of n.
+template <typename Graph>
+diameter_result undirected_diameter(const Graph &g)
+{
+    const size_t npos = std::numeric_limits<size_t>::max();
+
+    // setup
+    diameter_result r;
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> adj;
+    core_adjacency(g, descriptors, adj);
+    size_t n = descriptors.size();
+    std::vector<size_t> dist(n, npos), order, level(n), from_a(n), component;
+    std::vector<bool> done(n, false);
+
+    for (size_t root = 0; root < n; ++root)
+    {
+        if (done[root])
+            continue;
+        // component of root and its highest degree vertex
+        diameter_bfs(adj, root, dist, component);
+        size_t start = root;
+        for (size_t v : component)
+        {
+            done[v] = true;
+            if (adj[v].size() > adj[start].size())
+                start = v;
+        }
+        if (component.size() == 1)
+            continue;
+        ++r.bfs_runs;
+
+        // double sweep: start -> a -> b gives a lower bound and the midpoint
+        size_t a = diameter_bfs(adj, start, dist, order).second;
+        auto ab = diameter_bfs(adj, a, dist, order, &from_a);
+        r.bfs_runs += 2;
+        size_t lower = ab.first;
+        size_t u = ab.second;
+        for (size_t steps = lower / 2; steps > 0; --steps)
+            for (size_t t : adj[u])
+                if (from_a[t] + 1 == from_a[u])
+                {
+                    u = t;
+                    break;
+                }
+
+        // iFUB from the midpoint
+        size_t ecc = diameter_bfs(adj, u, dist, order, &level).first;
+        ++r.bfs_runs;
+        lower = std::max(lower, ecc);
+        std::vector<std::vector<size_t>> fringe(ecc + 1);
+        for (size_t v : order)
+            fringe[level[v]].push_back(v);
+        for (size_t i = ecc; i > 0 && 2 * i > lower; --i)
+        {
+            size_t best = 0;
+            for (size_t v : fringe[i])
+            {
+                best = std::max(best, diameter_bfs(adj, v, dist, order).first);
+                ++r.bfs_runs;
+            }
+            lower = std::max(lower, best);
+            if (lower > 2 * (i - 1))
+                break;
+        }
+        r.diameter = std::max(r.diameter, lower);
+    }
+    return r;
+}
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef _GRAPH_INSTRUMENTATION_H_
+#define _GRAPH_INSTRUMENTATION_H_
+
+// Hot-path instrumentation for the graph classes and algorithms.
+//
+// Compile with -DGRAPH_INSTRUMENTATION to enable it. Otherwise every macro
+// below expands to nothing and costs nothing. When enabled:
+//
+//  - GRAPH_COUNT(counter, n) adds n to one of the counters listed in
+//    graph_instrumentation::counter (lookups, probe lengths, edges examined,
+//    frontier pushes, parent map writes, node allocations, ...).
+//  - GRAPH_MAX(counter, n) raises a counter to at least n (e.g. the largest
+//    frontier seen).
+//  - GRAPH_PHASE("name") times the enclosing scope. Wall time and call count
+//    are accumulated per phase name.
+//
+// Counters live in per-thread blocks written without atomic read-modify-write
+// operations. snapshot() sums all blocks, and write_json dumps the result.
+//
+// With -DGRAPH_INSTRUMENTATION_PERF as well, each phase also records CPU
+// cycles, instructions, cache misses and branch misses for the calling
+// thread, read through perf_event_open (Linux only; the values stay 0 if the
+// kernel refuses access).
+//
+
+#ifdef GRAPH_INSTRUMENTATION
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(GRAPH_INSTRUMENTATION_PERF) && defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define GRAPH_INSTRUMENTATION_HAS_PERF 1
+#endif
+
+class graph_instrumentation
+{
+public:
+    enum counter
+    {
+        vertex_lookups,  // find_vertex calls
+        vertex_probes,   // Slots or bucket entries inspected by find_vertex
+        edge_lookups,    // find_edge calls
+        edge_probes,     // Slots or bucket entries inspected by find_edge
+        edges_examined,  // Adjacency entries visited by traversals
+        frontier_pushes, // Vertices pushed on a queue or stack
+        max_frontier,    // Largest queue or stack seen
+        parent_writes,   // Writes into a ParentMap
+        allocations,     // Vertex and edge nodes allocated
+        deallocations,   // Vertex and edge nodes freed
+        num_counters
+    };
+
+    enum hardware_counter
+    {
+        cycles,
+        instructions,
+        cache_misses,
+        branch_misses,
+        num_hardware_counters
+    };
+
+    static const char *counter_name(int c)
+    {
+        static const char *names[] = {"vertex_lookups", "vertex_probes", "edge_lookups", "edge_probes",
+                                      "edges_examined", "frontier_pushes", "max_frontier", "parent_writes",
+                                      "allocations", "deallocations"};
+        return names[c];
+    }
+
+    static const char *hardware_counter_name(int c)
+    {
+        static const char *names[] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+        return names[c];
+    }
+
+    ///@brief Accumulated cost of one named phase.
+    struct phase_stat
+    {
+        uint64_t calls = 0;
+        uint64_t nanoseconds = 0;
+        uint64_t hardware[num_hardware_counters] = {0, 0, 0, 0};
+    };
+
+    ///@brief Sum of all threads at one point in time.
+    struct snapshot_type
+    {
+        uint64_t counters[num_counters] = {};
+        std::map<std::string, phase_stat> phases;
+
+        uint64_t operator[](counter c) const { return counters[c]; }
+
+        void write_json(std::ostream &os) const
+        {
+            os << "{\"counters\":{";
+            for (int c = 0; c < num_counters; ++c)
+                os << (c ? "," : "") << '"' << counter_name(c) << "\":" << counters[c];
+            os << "},\"phases\":{";
+            bool first = true;
+            for (const auto &p : phases)
+            {
+                os << (first ? "" : ",") << '"' << p.first << "\":{\"calls\":" << p.second.calls
+                   << ",\"seconds\":" << p.second.nanoseconds * 1e-9;
+                for (int h = 0; h < num_hardware_counters; ++h)
+                    os << ",\"" << hardware_counter_name(h) << "\":" << p.second.hardware[h];
+                os << '}';
+                first = false;
+            }
+            os << "}}";
+        }
+    };
+
+    static void add(counter c, uint64_t n)
+    {
+        std::atomic<uint64_t> &a = local().counters[c];
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void raise(counter c, uint64_t n)
+    {
+        std::atomic<uint64_t> &a = local().counters[c];
+        if (a.load(std::memory_order_relaxed) < n)
+            a.store(n, std::memory_order_relaxed);
+    }
+
+    ///@brief Probes a binary search makes over n entries, for sorted containers.
+    static uint64_t binary_search_probes(size_t n)
+    {
+        uint64_t k = 0;
+        for (; n; n >>= 1)
+            ++k;
+        return k;
+    }
+
+    ///@brief Sum every thread's counters and phases.
+    static snapshot_type snapshot()
+    {
+        snapshot_type s;
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (auto &b : registry())
+        {
+            for (int c = 0; c < num_counters; ++c)
+            {
+                uint64_t v = b->counters[c].load(std::memory_order_relaxed);
+                s.counters[c] = c == max_frontier ? std::max(s.counters[c], v) : s.counters[c] + v;
+            }
+            std::lock_guard<std::mutex> phase_lock(b->phase_mutex);
+            for (auto &p : b->phases)
+            {
+                phase_stat &d = s.phases[p.first];
+                d.calls += p.second.calls;
+                d.nanoseconds += p.second.nanoseconds;
+                for (int h = 0; h < num_hardware_counters; ++h)
+                    d.hardware[h] += p.second.hardware[h];
+            }
+        }
+        return s;
+    }
+
+    ///@brief Zero every counter and forget all phases.
+    static void reset()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (auto &b : registry())
+        {
+            for (int c = 0; c < num_counters; ++c)
+                b->counters[c].store(0, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> phase_lock(b->phase_mutex);
+            b->phases.clear();
+        }
+    }
+
+    static void write_json(std::ostream &os) { snapshot().write_json(os); }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Times its scope and adds the result to the named phase.
+    ////////////////////////////////////////////////////////////////////////////
+    class scoped_phase
+    {
+    public:
+        explicit scoped_phase(const char *name) : m_name(name), m_start(std::chrono::steady_clock::now())
+        {
+            local().read_hardware(m_hardware);
+        }
+        ~scoped_phase()
+        {
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+            uint64_t hw[num_hardware_counters];
+            thread_block &b = local();
+            b.read_hardware(hw);
+            std::lock_guard<std::mutex> lock(b.phase_mutex);
+            phase_stat &p = b.phases[m_name];
+            ++p.calls;
+            p.nanoseconds += ns;
+            for (int h = 0; h < num_hardware_counters; ++h)
+                p.hardware[h] += hw[h] - m_hardware[h];
+        }
+        scoped_phase(const scoped_phase &) = delete;
+        scoped_phase &operator=(const scoped_phase &) = delete;
+
+    private:
+        const char *m_name;
+        std::chrono::steady_clock::time_point m_start;
+        uint64_t m_hardware[num_hardware_counters];
+    };
+
+private:
+    struct thread_block
+    {
+        thread_block()
+        {
+            for (int c = 0; c < num_counters; ++c)
+                counters[c].store(0, std::memory_order_relaxed);
+#ifdef GRAPH_INSTRUMENTATION_HAS_PERF
+            static const uint64_t configs[num_hardware_counters] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+            group = -1;
+            for (int h = 0; h < num_hardware_counters; ++h)
+            {
+                struct perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = configs[h];
+                attr.disabled = group == -1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                fds[h] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+                if (group == -1)
+                    group = fds[h];
+            }
+            if (group != -1)
+            {
+                ioctl(group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+#endif
+        }
+
+        ~thread_block()
+        {
+#ifdef GRAPH_INSTRUMENTATION_HAS_PERF
+            for (int h = 0; h < num_hardware_counters; ++h)
+                if (fds[h] != -1)
+                    close(fds[h]);
+#endif
+        }
+
+        void read_hardware(uint64_t *out)
+        {
+            for (int h = 0; h < num_hardware_counters; ++h)
+                out[h] = 0;
+#ifdef GRAPH_INSTRUMENTATION_HAS_PERF
+            if (group == -1)
+                return;
+            uint64_t buf[1 + num_hardware_counters] = {};
+            if (read(group, buf, sizeof(buf)) <= 0)
+                return;
+            // counters that failed to open are missing from the group
+            for (int h = 0, k = 0; h < num_hardware_counters && k < static_cast<int>(buf[0]); ++h)
+                if (fds[h] != -1)
+                    out[h] = buf[1 + k++];
+#endif
+        }
+
+        std::atomic<uint64_t> counters[num_counters];
+        std::mutex phase_mutex;
+        std::unordered_map<std::string, phase_stat> phases;
+#ifdef GRAPH_INSTRUMENTATION_HAS_PERF
+        int group;
+        int fds[num_hardware_counters];
+#endif
+    };
+
+    static std::mutex &registry_mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    // blocks outlive their threads so totals are kept after a thread exits
+    static std::vector<std::shared_ptr<thread_block>> &registry()
+    {
+        static std::vector<std::shared_ptr<thread_block>> r;
+        return r;
+    }
+
+    static thread_block &local()
+    {
+        thread_local std::shared_ptr<thread_block> block = []()
+        {
+            auto b = std::make_shared<thread_block>();
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            registry().push_back(b);
+            return b;
+        }();
+        return *block;
+    }
+};
+
+#define GRAPH_INSTRUMENTATION_CONCAT2(a, b) a##b
+#define GRAPH_INSTRUMENTATION_CONCAT(a, b) GRAPH_INSTRUMENTATION_CONCAT2(a, b)
+#define GRAPH_COUNT(c, n) graph_instrumentation::add(graph_instrumentation::c, static_cast<uint64_t>(n))
+#define GRAPH_MAX(c, n) graph_instrumentation::raise(graph_instrumentation::c, static_cast<uint64_t>(n))
+#define GRAPH_PHASE(name) \
+    graph_instrumentation::scoped_phase GRAPH_INSTRUMENTATION_CONCAT(graph_phase_, __LINE__)(name)
+
+#else
+
+#define GRAPH_COUNT(c, n) ((void)0)
+#define GRAPH_MAX(c, n) ((void)0)
+#define GRAPH_PHASE(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _GRAPH_MEMORY_H_
+#define _GRAPH_MEMORY_H_
+
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+
+// Memory accounting for the pointer-based graphs (graph and graph_vector).
+//
+// The figures are computed from container sizes and capacities, not measured
+// from the allocator, so they exclude malloc headers and any heap memory a
+// property owns itself (e.g. the buffer of a std::string). Hash set nodes are
+// counted with the usual layout of a next pointer, the stored value and a
+// cached hash code.
+//
+
+///@brief Bytes held by a graph, broken down by what they are used for.
+struct graph_memory_usage
+{
+    size_t vertex_nodes = 0; ///< Vertex objects, excluding their properties
+    size_t edge_nodes = 0;   ///< Edge objects, excluding their properties
+    size_t buckets = 0;      ///< Hash bucket arrays at the load factor they need
+    size_t containers = 0;   ///< Set nodes or vector slots of the vertex and edge lists
+    size_t adjacency = 0;    ///< Adjacency containers of all vertices
+    size_t properties = 0;   ///< Vertex and edge properties
+    size_t slack = 0;        ///< Reserved but unused capacity and surplus buckets
+
+    size_t total() const
+    {
+        return vertex_nodes + edge_nodes + buckets + containers + adjacency + properties + slack;
+    }
+
+    graph_memory_usage &operator+=(const graph_memory_usage &o)
+    {
+        vertex_nodes += o.vertex_nodes;
+        edge_nodes += o.edge_nodes;
+        buckets += o.buckets;
+        containers += o.containers;
+        adjacency += o.adjacency;
+        properties += o.properties;
+        slack += o.slack;
+        return *this;
+    }
+};
+
+///@brief Add the footprint of an unordered container: its nodes go to
+///       u.*nodes and its bucket array to u.buckets, except for buckets beyond
+///       what the current size needs, which count as slack.
+template <typename HashContainer>
+void account_hash_container(const HashContainer &c, graph_memory_usage &u, size_t graph_memory_usage::*nodes)
+{
+    const size_t node_bytes = sizeof(void *) + sizeof(typename HashContainer::value_type) + sizeof(size_t);
+    size_t needed = static_cast<size_t>(std::ceil(c.size() / c.max_load_factor()));
+    if (needed > c.bucket_count())
+        needed = c.bucket_count();
+    u.*nodes += c.size() * node_bytes;
+    u.buckets += needed * sizeof(void *);
+    u.slack += (c.bucket_count() - needed) * sizeof(void *);
+}
+
+///@brief Add the footprint of a vector: used slots go to u.*slots, unused
+///       capacity to u.slack.
+template <typename Vector>
+void account_vector(const Vector &c, graph_memory_usage &u, size_t graph_memory_usage::*slots)
+{
+    u.*slots += c.size() * sizeof(typename Vector::value_type);
+    u.slack += (c.capacity() - c.size()) * sizeof(typename Vector::value_type);
+}
+
+inline std::ostream &operator<<(std::ostream &os, const graph_memory_usage &u)
+{
+    return os << "vertex_nodes " << u.vertex_nodes << " edge_nodes " << u.edge_nodes
+              << " buckets " << u.buckets << " containers " << u.containers
+              << " adjacency " << u.adjacency << " properties " << u.properties
+              << " slack " << u.slack << " total " << u.total();
+}
+
+#endif
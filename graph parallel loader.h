@@ -0,0 +1,429 @@
+#ifndef _GRAPH_PARALLEL_LOADER_H_
+#define _GRAPH_PARALLEL_LOADER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph csr.h"
+#include "graph parallel.h"
+#include "graph stream.h"
+
+// Parallel loaders producing a csr_graph from text.
+//
+//  - parallel_load reads the format written by operator<< ("num_verts
+//    num_edges", one vertex property per line, then "source target property"
+//    per edge) from one file.
+//  - parallel_load_shards reads every regular file of a directory, each holding
+//    "source target [property]" lines with global vertex descriptors; the
+//    number of vertices is one past the largest descriptor seen.
+//
+// Files are memory mapped and cut into chunks on line boundaries. Threads pull
+// chunks from a shared counter and parse them into thread-local edge buffers.
+// Out-degrees are counted with atomics, turned into row offsets with a
+// parallel prefix sum, and the buffers are scattered into the CSR arrays in
+// parallel before each row is sorted by target. Parallel edges (same source
+// and target) end up in an order that depends on thread timing.
+//
+// Edge lines whose source or target is not a decimal integer or names a
+// vertex outside the graph, or whose property does not parse, are skipped and
+// counted in load_stats::malformed; so are vertex lines whose property does
+// not parse (the vertex keeps a default property). Both loaders refuse more
+// than max_vertices vertices, so a stray huge descriptor or header count
+// cannot make them allocate an enormous table.
+//
+
+///@brief Read-only memory mapping of a whole file.
+class mapped_file
+{
+public:
+    explicit mapped_file(const std::string &path) : m_data(nullptr), m_size(0)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                m_data = static_cast<const char *>(p);
+                m_size = st.st_size;
+                madvise(p, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+    ~mapped_file()
+    {
+        if (m_data)
+            munmap(const_cast<char *>(m_data), m_size);
+    }
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    bool is_open() const { return m_data != nullptr; }
+    const char *begin() const { return m_data; }
+    const char *end() const { return m_data + m_size; }
+    size_t size() const { return m_size; }
+
+private:
+    const char *m_data;
+    size_t m_size;
+};
+
+///@brief Counters reported by the parallel loaders.
+struct load_stats
+{
+    size_t bytes = 0;     // Input bytes
+    size_t vertices = 0;  // Vertices loaded
+    size_t edges = 0;     // Edges loaded
+    size_t malformed = 0; // Lines skipped or defaulted because a token did not parse or was out of range
+    size_t chunks = 0;    // Line-aligned chunks parsed
+    size_t threads = 0;   // Threads used
+    double seconds = 0;   // Wall time including the CSR merge
+    bool ok = true;       // False if the file could not be opened or had too many vertices
+
+    double gigabytes_per_second() const { return seconds > 0 ? bytes / seconds / 1e9 : 0.0; }
+};
+
+///@brief Split [b, e) into pieces of about chunk_bytes that start and end on
+///       line boundaries (each piece owns the lines that start inside it).
+inline void split_lines(const char *b, const char *e, size_t chunk_bytes,
+                        std::vector<std::pair<const char *, const char *>> &chunks)
+{
+    auto line_start = [&](const char *p)
+    {
+        if (p <= b)
+            return b;
+        if (p >= e)
+            return e;
+        const char *nl = static_cast<const char *>(std::memchr(p - 1, '\n', e - (p - 1)));
+        return nl ? nl + 1 : e;
+    };
+    for (const char *p = b; p < e;)
+    {
+        const char *q = line_start(p + std::min<size_t>(chunk_bytes, e - p));
+        if (q > p)
+            chunks.emplace_back(p, q);
+        p = q;
+    }
+}
+
+///@brief Thread-local result of parsing edge lines.
+template <typename EdgeProperty>
+struct parsed_edges
+{
+    std::vector<size_t> sources;
+    std::vector<size_t> targets;
+    std::vector<EdgeProperty> properties;
+    size_t max_descriptor = 0;
+    size_t malformed = 0; // Lines skipped
+    bool any = false;
+};
+
+///@brief Parse "source target [property]" lines of [b, e) into out. Lines
+///       naming a descriptor >= limit count as malformed.
+template <typename EdgeProperty>
+void parse_edge_lines(const char *b, const char *e, size_t limit, parsed_edges<EdgeProperty> &out)
+{
+    auto blank = [](char c)
+    { return c == ' ' || c == '\t' || c == '\r' || c == ','; };
+    while (b < e)
+    {
+        const char *nl = static_cast<const char *>(std::memchr(b, '\n', e - b));
+        const char *end = nl ? nl : e;
+        const char *tok[3][2];
+        int n = 0;
+        for (const char *p = b; n < 3;)
+        {
+            while (p != end && blank(*p))
+                ++p;
+            if (p == end || (n == 0 && *p == '#'))
+                break;
+            tok[n][0] = p;
+            while (p != end && !blank(*p))
+                ++p;
+            tok[n][1] = p;
+            ++n;
+        }
+        if (n >= 2)
+        {
+            size_t s = 0, t = 0;
+            auto rs = std::from_chars(tok[0][0], tok[0][1], s);
+            auto rt = std::from_chars(tok[1][0], tok[1][1], t);
+            EdgeProperty ep = EdgeProperty();
+            if (rs.ec != std::errc() || rs.ptr != tok[0][1] || rt.ec != std::errc() || rt.ptr != tok[1][1] ||
+                s >= limit || t >= limit || (n == 3 && !parse_stream_property(tok[2][0], tok[2][1], ep)))
+                ++out.malformed;
+            else
+            {
+                out.sources.push_back(s);
+                out.targets.push_back(t);
+                out.properties.push_back(std::move(ep));
+                out.max_descriptor = std::max(out.max_descriptor, std::max(s, t));
+                out.any = true;
+            }
+        }
+        b = end + 1;
+    }
+}
+
+///@brief Merge thread-local edge buffers into g over n vertices with
+///       descriptors 0..n-1. Every endpoint must be < n, which
+///       parse_edge_lines ensures when given n as its limit.
+template <typename VertexProperty, typename EdgeProperty>
+void merge_parsed_edges(std::vector<parsed_edges<EdgeProperty>> &parts, size_t n,
+                        std::vector<VertexProperty> vprops, csr_graph<VertexProperty, EdgeProperty> &g,
+                        size_t num_threads)
+{
+    // count out-degrees
+    std::vector<size_t> offsets(n + 1, 0);
+    {
+        std::vector<std::atomic<size_t>> degree(n);
+        parallel_for(0, n, [&](size_t i)
+                     { degree[i].store(0, std::memory_order_relaxed); },
+                     num_threads);
+        parallel_invoke(parts.size(), [&](size_t tid)
+                        {
+                            const auto &p = parts[tid];
+                            for (size_t e = 0; e < p.sources.size(); ++e)
+                                degree[p.sources[e]].fetch_add(1, std::memory_order_relaxed); });
+        parallel_for(0, n, [&](size_t i)
+                     { offsets[i] = degree[i].load(std::memory_order_relaxed); },
+                     num_threads);
+    }
+    size_t m = parallel_exclusive_scan(offsets, num_threads);
+    offsets[n] = m;
+
+    // scatter
+    std::vector<size_t> targets(m);
+    std::vector<EdgeProperty> eprops(m);
+    {
+        std::vector<std::atomic<size_t>> cursor(n);
+        parallel_for(0, n, [&](size_t i)
+                     { cursor[i].store(offsets[i], std::memory_order_relaxed); },
+                     num_threads);
+        parallel_invoke(parts.size(), [&](size_t tid)
+                        {
+                            auto &p = parts[tid];
+                            for (size_t e = 0; e < p.sources.size(); ++e)
+                            {
+                                size_t slot = cursor[p.sources[e]].fetch_add(1, std::memory_order_relaxed);
+                                targets[slot] = p.targets[e];
+                                eprops[slot] = std::move(p.properties[e]);
+                            }
+                            p = parsed_edges<EdgeProperty>(); });
+    }
+
+    // sort rows by target; only parallel edges keep a timing-dependent order
+    parallel_for(
+        0, n, [&](size_t i)
+        {
+            size_t lo = offsets[i], hi = offsets[i + 1];
+            if (std::is_sorted(targets.begin() + lo, targets.begin() + hi))
+                return;
+            std::vector<std::pair<size_t, EdgeProperty>> row;
+            row.reserve(hi - lo);
+            for (size_t j = lo; j < hi; ++j)
+                row.emplace_back(targets[j], std::move(eprops[j]));
+            std::sort(row.begin(), row.end(), [](const std::pair<size_t, EdgeProperty> &a,
+                                                 const std::pair<size_t, EdgeProperty> &b)
+                      { return a.first < b.first; });
+            for (size_t j = lo; j < hi; ++j)
+            {
+                targets[j] = row[j - lo].first;
+                eprops[j] = std::move(row[j - lo].second);
+            } },
+        num_threads);
+
+    std::vector<size_t> descriptors(n);
+    parallel_for(0, n, [&](size_t i)
+                 { descriptors[i] = i; },
+                 num_threads);
+    g.assign_csr(std::move(descriptors), std::move(vprops), std::move(offsets),
+                 std::move(targets), std::move(eprops), false);
+}
+
+///@brief Parse every chunk with num_threads threads pulling from a shared
+///       counter, skipping descriptors >= limit. Returns one buffer per
+///       thread.
+template <typename EdgeProperty>
+std::vector<parsed_edges<EdgeProperty>>
+parse_edge_chunks(const std::vector<std::pair<const char *, const char *>> &chunks, size_t limit,
+                  size_t num_threads)
+{
+    std::vector<parsed_edges<EdgeProperty>> parts(num_threads);
+    std::atomic<size_t> next(0);
+    parallel_invoke(num_threads, [&](size_t tid)
+                    {
+                        for (size_t c; (c = next.fetch_add(1)) < chunks.size();)
+                            parse_edge_lines(chunks[c].first, chunks[c].second, limit, parts[tid]); });
+    return parts;
+}
+
+///@brief Load a file in the operator<< text format into g in parallel.
+///       Returns stats with ok == false and g untouched if the file cannot
+///       be opened (bytes == 0 then) or its header asks for more than
+///       max_vertices vertices.
+template <typename VertexProperty, typename EdgeProperty>
+load_stats parallel_load(const std::string &path, csr_graph<VertexProperty, EdgeProperty> &g,
+                         size_t num_threads = 0, size_t chunk_bytes = 16 << 20,
+                         size_t max_vertices = UINT32_MAX)
+{
+    // setup
+    load_stats stats;
+    auto start = std::chrono::steady_clock::now();
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    stats.threads = num_threads;
+    mapped_file f(path);
+    if (!f.is_open())
+    {
+        stats.ok = false;
+        return stats;
+    }
+    stats.bytes = f.size();
+
+    // header
+    const char *p = f.begin();
+    const char *header_end = static_cast<const char *>(std::memchr(p, '\n', f.size()));
+    header_end = header_end ? header_end + 1 : f.end();
+    size_t num_verts = 0, num_edges = 0;
+    {
+        const char *q = p;
+        while (q < header_end && (*q == ' ' || *q == '\t'))
+            ++q;
+        q = std::from_chars(q, header_end, num_verts).ptr;
+        while (q < header_end && (*q == ' ' || *q == '\t'))
+            ++q;
+        std::from_chars(q, header_end, num_edges);
+    }
+    if (num_verts > max_vertices)
+    {
+        stats.ok = false;
+        return stats;
+    }
+
+    // vertex lines: cut into chunks, count lines per chunk, parse in place
+    std::vector<std::pair<const char *, const char *>> chunks;
+    const char *vend = header_end;
+    for (size_t i = 0; i < num_verts && vend < f.end(); ++i)
+    {
+        const char *nl = static_cast<const char *>(std::memchr(vend, '\n', f.end() - vend));
+        vend = nl ? nl + 1 : f.end();
+    }
+    split_lines(header_end, vend, chunk_bytes, chunks);
+    std::vector<size_t> first_line(chunks.size() + 1, 0);
+    parallel_for(
+        0, chunks.size(), [&](size_t c)
+        { first_line[c] = std::count(chunks[c].first, chunks[c].second, '\n'); },
+        num_threads);
+    parallel_exclusive_scan(first_line, num_threads);
+    std::vector<VertexProperty> vprops(num_verts);
+    std::atomic<size_t> bad_vertices(0);
+    parallel_for(
+        0, chunks.size(), [&](size_t c)
+        {
+            size_t line = first_line[c];
+            for (const char *b = chunks[c].first; b < chunks[c].second && line < num_verts; ++line)
+            {
+                const char *nl = static_cast<const char *>(std::memchr(b, '\n', chunks[c].second - b));
+                const char *e = nl ? nl : chunks[c].second;
+                const char *t = e;
+                while (t > b && (t[-1] == '\r' || t[-1] == ' '))
+                    --t;
+                if (!parse_stream_property(b, t, vprops[line]))
+                {
+                    vprops[line] = VertexProperty();
+                    bad_vertices.fetch_add(1, std::memory_order_relaxed);
+                }
+                b = e + 1;
+            } },
+        num_threads);
+    stats.chunks += chunks.size();
+
+    // edge lines
+    chunks.clear();
+    split_lines(vend, f.end(), chunk_bytes, chunks);
+    stats.chunks += chunks.size();
+    auto parts = parse_edge_chunks<EdgeProperty>(chunks, num_verts, num_threads);
+    stats.malformed = bad_vertices.load();
+    for (const auto &part : parts)
+        stats.malformed += part.malformed;
+    merge_parsed_edges(parts, num_verts, std::move(vprops), g, num_threads);
+
+    stats.vertices = g.num_vertices();
+    stats.edges = g.num_edges();
+    (void)num_edges; // the header count is advisory; the edge lines decide
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+///@brief Load every regular file of directory, each a list of
+///       "source target [property]" lines, into g in parallel. Vertex
+///       properties are default constructed. Lines naming a descriptor
+///       >= max_vertices are skipped as malformed.
+template <typename VertexProperty, typename EdgeProperty>
+load_stats parallel_load_shards(const std::string &directory, csr_graph<VertexProperty, EdgeProperty> &g,
+                                size_t num_threads = 0, size_t chunk_bytes = 16 << 20,
+                                size_t max_vertices = UINT32_MAX)
+{
+    // setup
+    load_stats stats;
+    auto start = std::chrono::steady_clock::now();
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    stats.threads = num_threads;
+
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+        if (entry.is_regular_file())
+            paths.push_back(entry.path().string());
+    std::sort(paths.begin(), paths.end());
+
+    // map every shard, chunk them all into one work list
+    std::vector<std::unique_ptr<mapped_file>> files;
+    std::vector<std::pair<const char *, const char *>> chunks;
+    for (const auto &path : paths)
+    {
+        files.emplace_back(new mapped_file(path));
+        if (!files.back()->is_open())
+            continue;
+        stats.bytes += files.back()->size();
+        split_lines(files.back()->begin(), files.back()->end(), chunk_bytes, chunks);
+    }
+    stats.chunks = chunks.size();
+
+    auto parts = parse_edge_chunks<EdgeProperty>(chunks, max_vertices, num_threads);
+    size_t n = 0;
+    for (const auto &p : parts)
+    {
+        if (p.any)
+            n = std::max(n, p.max_descriptor + 1);
+        stats.malformed += p.malformed;
+    }
+    merge_parsed_edges(parts, n, std::vector<VertexProperty>(n), g, num_threads);
+
+    stats.vertices = g.num_vertices();
+    stats.edges = g.num_edges();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+#endif
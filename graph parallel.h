@@ -0,0 +1,117 @@
+#ifndef _GRAPH_PARALLEL_H_
+#define _GRAPH_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Small fork/join helpers shared by the parallel graph algorithms. Every
+// helper takes a thread count where 0 means "use the hardware concurrency".
+
+///@brief Number of threads used when an algorithm is asked for 0 threads.
+inline size_t default_num_threads()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+///@brief Run f(tid) on num_threads threads (tid in [0, num_threads)) and join.
+///       The calling thread runs tid 0 itself.
+template <typename Function>
+void parallel_invoke(size_t num_threads, Function f)
+{
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads - 1);
+    for (size_t tid = 1; tid < num_threads; ++tid)
+        workers.emplace_back([&f, tid]()
+                             { f(tid); });
+    f(0);
+    for (auto &w : workers)
+        w.join();
+}
+
+///@brief Split [begin, end) into one contiguous chunk per thread and call
+///       f(tid, lo, hi) for each chunk. Chunks may be empty.
+template <typename Function>
+void parallel_chunks(size_t begin, size_t end, Function f, size_t num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    size_t n = end > begin ? end - begin : 0;
+    // no point in waking threads for tiny ranges
+    num_threads = std::max<size_t>(1, std::min(num_threads, n / 1024 + 1));
+    size_t chunk = (n + num_threads - 1) / num_threads;
+    parallel_invoke(num_threads, [&](size_t tid)
+                    {
+                        size_t lo = std::min(end, begin + tid * chunk);
+                        size_t hi = std::min(end, lo + chunk);
+                        f(tid, lo, hi); });
+}
+
+///@brief Call f(i) for every i in [begin, end) using static chunking.
+template <typename Function>
+void parallel_for(size_t begin, size_t end, Function f, size_t num_threads = 0)
+{
+    parallel_chunks(
+        begin, end, [&](size_t, size_t lo, size_t hi)
+        {
+            for (size_t i = lo; i < hi; ++i)
+                f(i); },
+        num_threads);
+}
+
+///@brief Call f(tid, i) for every i in [begin, end), handing out grain
+///       indices at a time from a shared counter. For work items of very
+///       uneven cost, or too few of them for parallel_chunks to split.
+template <typename Function>
+void parallel_for_dynamic(size_t begin, size_t end, Function f, size_t num_threads = 0, size_t grain = 1)
+{
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    size_t n = end > begin ? end - begin : 0;
+    num_threads = std::max<size_t>(1, std::min(num_threads, (n + grain - 1) / grain));
+    std::atomic<size_t> next(begin);
+    parallel_invoke(num_threads, [&](size_t tid)
+                    {
+                        for (size_t lo; (lo = next.fetch_add(grain)) < end;)
+                            for (size_t i = lo; i < std::min(end, lo + grain); ++i)
+                                f(tid, i); });
+}
+
+///@brief In-place exclusive prefix sum of v; returns the total. Each thread
+///       sums its block, the block totals are scanned serially, then each
+///       thread rescans its block from its offset.
+template <typename T>
+T parallel_exclusive_scan(std::vector<T> &v, size_t num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = default_num_threads();
+    std::vector<T> sums(num_threads + 1, T());
+    parallel_chunks(
+        0, v.size(), [&](size_t tid, size_t lo, size_t hi)
+        {
+            T s = T();
+            for (size_t i = lo; i < hi; ++i)
+                s += v[i];
+            sums[tid + 1] = s; },
+        num_threads);
+    for (size_t t = 0; t < num_threads; ++t)
+        sums[t + 1] += sums[t];
+    parallel_chunks(
+        0, v.size(), [&](size_t tid, size_t lo, size_t hi)
+        {
+            T s = sums[tid];
+            for (size_t i = lo; i < hi; ++i)
+            {
+                T x = v[i];
+                v[i] = s;
+                s += x;
+            } },
+        num_threads);
+    return sums[num_threads];
+}
+
+#endif
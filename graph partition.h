@@ -0,0 +1,594 @@
+#ifndef _GRAPH_PARTITION_H_
+#define _GRAPH_PARTITION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph core decomposition.h"
+#include "graph csr.h"
+
+// k-way vertex partitioning, so that a graph can be split across several
+// processes.
+//
+// Partitioning works on the underlying undirected simple graph, like the core
+// decomposition: direction, parallel edges and self loops are ignored when
+// choosing parts. The metrics and the per-part subgraphs count the edges of g
+// as they are stored.
+//
+//  - PartMap: associative container between vertex_descriptors and part ids
+//             (size_t in [0, k)).
+//
+// Every partitioner keeps each part at most ceil((1 + imbalance) * n / k)
+// vertices. They return false, leaving part empty, if k is 0.
+//
+
+///@brief Quality of a partition.
+struct partition_metrics
+{
+    size_t edge_cut = 0;           ///< Edges whose endpoints lie in different parts
+    size_t boundary_vertices = 0;  ///< Vertices with at least one cut edge
+    std::vector<size_t> part_size; ///< Vertices per part
+    double balance = 0;            ///< Largest part over the average part size
+};
+
+///@brief Largest part size allowed for n vertices in k > 0 parts.
+inline size_t partition_capacity(size_t n, size_t k, double imbalance)
+{
+    size_t c = static_cast<size_t>(std::ceil((1.0 + imbalance) * n / k));
+    return std::max<size_t>(c, (n + k - 1) / k);
+}
+
+///@brief Shared body of the streaming partitioners. Vertices arrive in the
+///       iteration order of g and each is placed once, in the part with the
+///       highest score(neighbours already in the part, part size); ties go to
+///       the smaller part.
+template <typename Graph, typename PartMap, typename Score>
+bool streaming_partition(const Graph &g, size_t k, PartMap &part, double imbalance, Score score)
+{
+    part.clear();
+    if (k == 0)
+        return false;
+
+    // setup
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> adj;
+    core_adjacency(g, descriptors, adj);
+    size_t n = descriptors.size();
+    size_t capacity = partition_capacity(n, k, imbalance);
+    const size_t unassigned = std::numeric_limits<size_t>::max();
+    std::vector<size_t> assigned(n, unassigned);
+    std::vector<size_t> size(k, 0);
+    std::vector<size_t> neighbours(k, 0);
+
+    // stream
+    for (size_t v = 0; v < n; ++v)
+    {
+        for (size_t u : adj[v])
+            if (assigned[u] != unassigned)
+                ++neighbours[assigned[u]];
+        size_t best = unassigned;
+        double best_score = 0;
+        for (size_t p = 0; p < k; ++p)
+        {
+            if (size[p] >= capacity)
+                continue;
+            double s = score(neighbours[p], size[p]);
+            if (best == unassigned || s > best_score || (s == best_score && size[p] < size[best]))
+            {
+                best = p;
+                best_score = s;
+            }
+        }
+        assigned[v] = best;
+        ++size[best];
+        for (size_t u : adj[v])
+            if (assigned[u] != unassigned)
+                neighbours[assigned[u]] = 0;
+    }
+
+    for (size_t v = 0; v < n; ++v)
+        part[descriptors[v]] = assigned[v];
+    return true;
+}
+
+///@brief Linear deterministic greedy (Stanton and Kliot): place each vertex in
+///       the part holding most of its neighbours, weighted by the free room
+///       left, |N(v) in P| * (1 - |P| / C).
+template <typename Graph, typename PartMap>
+bool ldg_partition(const Graph &g, size_t k, PartMap &part, double imbalance = 0.05)
+{
+    if (k == 0)
+    {
+        part.clear();
+        return false;
+    }
+    double capacity = static_cast<double>(partition_capacity(g.num_vertices(), k, imbalance));
+    return streaming_partition(g, k, part, imbalance,
+                               [capacity](size_t neighbours, size_t size)
+                               {
+                                   return neighbours * (1.0 - size / capacity);
+                               });
+}
+
+///@brief Fennel (Tsourakakis et al.): place each vertex in the part
+///       maximising |N(v) in P| - alpha * gamma * |P|^(gamma - 1), with
+///       alpha = m * k^(gamma - 1) / n^gamma.
+template <typename Graph, typename PartMap>
+bool fennel_partition(const Graph &g, size_t k, PartMap &part,
+                      double gamma = 1.5, double imbalance = 0.05)
+{
+    if (k == 0)
+    {
+        part.clear();
+        return false;
+    }
+    double n = static_cast<double>(std::max<size_t>(g.num_vertices(), 1));
+    double m = static_cast<double>(g.num_edges());
+    double alpha = m * std::pow(static_cast<double>(k), gamma - 1) / std::pow(n, gamma);
+    return streaming_partition(g, k, part, imbalance,
+                               [alpha, gamma](size_t neighbours, size_t size)
+                               {
+                                   return neighbours - alpha * gamma * std::pow(static_cast<double>(size), gamma - 1);
+                               });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// One level of the multilevel hierarchy: a vertex- and edge-weighted
+/// symmetric graph indexed by position.
+////////////////////////////////////////////////////////////////////////////////
+struct partition_level
+{
+    std::vector<size_t> vertex_weight;
+    std::vector<std::vector<std::pair<size_t, size_t>>> adj; // (neighbour, edge weight)
+    std::vector<size_t> coarse;                              // vertex of the next level
+
+    size_t size() const { return vertex_weight.size(); }
+};
+
+///@brief Heavy-edge matching: visit vertices in random order and merge each
+///       unmatched vertex with the unmatched neighbour joined by the heaviest
+///       edge, unless the merged weight would exceed max_weight. Fills
+///       fine.coarse and returns the coarser level.
+inline partition_level coarsen_level(partition_level &fine, size_t max_weight, std::mt19937_64 &rng)
+{
+    size_t n = fine.size();
+    const size_t unmatched = std::numeric_limits<size_t>::max();
+    std::vector<size_t> order(n), mate(n, unmatched);
+    for (size_t v = 0; v < n; ++v)
+        order[v] = v;
+    std::shuffle(order.begin(), order.end(), rng);
+
+    // match
+    for (size_t v : order)
+    {
+        if (mate[v] != unmatched)
+            continue;
+        size_t best = v;
+        size_t best_weight = 0;
+        for (auto &a : fine.adj[v])
+            if (mate[a.first] == unmatched && a.first != v && a.second > best_weight &&
+                fine.vertex_weight[v] + fine.vertex_weight[a.first] <= max_weight)
+            {
+                best = a.first;
+                best_weight = a.second;
+            }
+        mate[v] = best;
+        mate[best] = v;
+    }
+
+    // number coarse vertices
+    partition_level coarse;
+    fine.coarse.assign(n, unmatched);
+    for (size_t v : order)
+        if (fine.coarse[v] == unmatched)
+        {
+            fine.coarse[v] = fine.coarse[mate[v]] = coarse.vertex_weight.size();
+            coarse.vertex_weight.push_back(fine.vertex_weight[v] + (mate[v] != v ? fine.vertex_weight[mate[v]] : 0));
+        }
+
+    // merge adjacency, summing the weights of edges that become parallel
+    size_t cn = coarse.size();
+    coarse.adj.assign(cn, {});
+    std::vector<size_t> slot(cn, unmatched);
+    for (size_t v = 0; v < n; ++v)
+    {
+        size_t c = fine.coarse[v];
+        if (mate[v] < v)
+            continue; // handled with its mate
+        auto &out = coarse.adj[c];
+        for (size_t w : {v, mate[v]})
+        {
+            for (auto &a : fine.adj[w])
+            {
+                size_t d = fine.coarse[a.first];
+                if (d == c)
+                    continue;
+                if (slot[d] == unmatched)
+                {
+                    slot[d] = out.size();
+                    out.emplace_back(d, 0);
+                }
+                out[slot[d]].second += a.second;
+            }
+            if (mate[v] == v)
+                break;
+        }
+        for (auto &a : out)
+            slot[a.first] = unmatched;
+    }
+    return coarse;
+}
+
+///@brief Edge cut of an assignment on one level, counting each undirected
+///       edge once.
+inline size_t level_edge_cut(const partition_level &level, const std::vector<size_t> &assigned)
+{
+    size_t cut = 0;
+    for (size_t v = 0; v < level.size(); ++v)
+        for (auto &a : level.adj[v])
+            if (assigned[v] != assigned[a.first])
+                cut += a.second;
+    return cut / 2;
+}
+
+///@brief Initial partition of the coarsest level: grow the parts one after
+///       the other by breadth-first search from a random start, always taking
+///       the frontier vertex most connected to the growing part. The best of
+///       several tries is kept.
+inline std::vector<size_t> initial_level_partition(const partition_level &level, size_t k,
+                                                   size_t max_weight, std::mt19937_64 &rng,
+                                                   size_t tries = 8)
+{
+    size_t n = level.size();
+    size_t total = 0;
+    for (size_t w : level.vertex_weight)
+        total += w;
+    const size_t unassigned = std::numeric_limits<size_t>::max();
+    std::vector<size_t> best;
+    size_t best_cut = std::numeric_limits<size_t>::max();
+
+    for (size_t t = 0; t < tries; ++t)
+    {
+        std::vector<size_t> assigned(n, unassigned);
+        std::vector<size_t> gain(n, 0);
+        size_t remaining = total;
+        for (size_t p = 0; p + 1 < k; ++p)
+        {
+            size_t target = remaining / (k - p);
+            size_t weight = 0;
+            // max-heap of (connection to part p, vertex); stale entries skipped
+            std::priority_queue<std::pair<size_t, size_t>> frontier;
+            while (weight < target)
+            {
+                if (frontier.empty())
+                {
+                    // (re)seed from a random unassigned vertex
+                    std::vector<size_t> free;
+                    for (size_t v = 0; v < n; ++v)
+                        if (assigned[v] == unassigned)
+                            free.push_back(v);
+                    if (free.empty())
+                        break;
+                    size_t s = free[rng() % free.size()];
+                    frontier.emplace(0, s);
+                }
+                auto top = frontier.top();
+                frontier.pop();
+                size_t v = top.second;
+                if (assigned[v] != unassigned || top.first != gain[v])
+                    continue;
+                if (weight + level.vertex_weight[v] > max_weight && weight > 0)
+                    break;
+                assigned[v] = p;
+                weight += level.vertex_weight[v];
+                for (auto &a : level.adj[v])
+                    if (assigned[a.first] == unassigned)
+                    {
+                        gain[a.first] += a.second;
+                        frontier.emplace(gain[a.first], a.first);
+                    }
+            }
+            remaining -= weight;
+            for (size_t v = 0; v < n; ++v)
+                gain[v] = 0;
+        }
+        for (size_t v = 0; v < n; ++v)
+            if (assigned[v] == unassigned)
+                assigned[v] = k - 1;
+        size_t cut = level_edge_cut(level, assigned);
+        if (cut < best_cut)
+        {
+            best_cut = cut;
+            best.swap(assigned);
+        }
+    }
+    return best;
+}
+
+///@brief Greedy k-way boundary refinement. Each pass visits the vertices in
+///       random order and moves a vertex to the neighbouring part with the
+///       largest cut reduction, as long as the target stays within
+///       max_weight. Zero-gain moves are taken when they improve balance, and
+///       a vertex of an overweight part may move even at a loss. Stops after
+///       a pass without moves.
+inline void refine_level(const partition_level &level, size_t k, std::vector<size_t> &assigned,
+                         size_t max_weight, std::mt19937_64 &rng, size_t passes = 8)
+{
+    size_t n = level.size();
+    std::vector<size_t> part_weight(k, 0);
+    for (size_t v = 0; v < n; ++v)
+        part_weight[assigned[v]] += level.vertex_weight[v];
+    std::vector<size_t> order(n);
+    for (size_t v = 0; v < n; ++v)
+        order[v] = v;
+    std::vector<size_t> connection(k, 0);
+    std::vector<size_t> touched;
+
+    for (size_t pass = 0; pass < passes; ++pass)
+    {
+        std::shuffle(order.begin(), order.end(), rng);
+        size_t moves = 0;
+        for (size_t v : order)
+        {
+            size_t own = assigned[v];
+            size_t w = level.vertex_weight[v];
+            touched.clear();
+            bool boundary = false;
+            for (auto &a : level.adj[v])
+            {
+                size_t q = assigned[a.first];
+                if (connection[q] == 0)
+                    touched.push_back(q);
+                connection[q] += a.second;
+                boundary |= q != own;
+            }
+            bool overweight = part_weight[own] > max_weight;
+            if (boundary || overweight)
+            {
+                long best_gain = std::numeric_limits<long>::min();
+                size_t best = own;
+                auto consider = [&](size_t q)
+                {
+                    if (q == own || part_weight[q] + w > max_weight)
+                        return;
+                    long gain = static_cast<long>(connection[q]) - static_cast<long>(connection[own]);
+                    if (gain > best_gain || (gain == best_gain && part_weight[q] < part_weight[best]))
+                    {
+                        best_gain = gain;
+                        best = q;
+                    }
+                };
+                for (size_t q : touched)
+                    consider(q);
+                if (overweight && best == own)
+                    for (size_t q = 0; q < k; ++q)
+                        consider(q);
+                bool move = best != own &&
+                            (overweight || best_gain > 0 ||
+                             (best_gain == 0 && part_weight[best] + w < part_weight[own]));
+                if (move)
+                {
+                    part_weight[own] -= w;
+                    part_weight[best] += w;
+                    assigned[v] = best;
+                    ++moves;
+                }
+            }
+            for (size_t q : touched)
+                connection[q] = 0;
+        }
+        if (moves == 0)
+            break;
+    }
+}
+
+///@brief Multilevel partitioning in the style of METIS: coarsen by
+///       heavy-edge matching until about 20 vertices per part remain, split
+///       the coarsest graph by greedy growing, then project back level by
+///       level with greedy k-way refinement of the cut at each level.
+template <typename Graph, typename PartMap>
+bool multilevel_partition(const Graph &g, size_t k, PartMap &part,
+                          double imbalance = 0.03, uint64_t seed = 1)
+{
+    part.clear();
+    if (k == 0)
+        return false;
+
+    // setup
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> adj;
+    core_adjacency(g, descriptors, adj);
+    size_t n = descriptors.size();
+    size_t max_weight = partition_capacity(n, k, imbalance);
+    std::mt19937_64 rng(seed);
+
+    std::vector<partition_level> levels(1);
+    levels[0].vertex_weight.assign(n, 1);
+    levels[0].adj.resize(n);
+    for (size_t v = 0; v < n; ++v)
+        for (size_t u : adj[v])
+            levels[0].adj[v].emplace_back(u, 1);
+    adj.clear();
+
+    // coarsen; merged vertices stay small enough to be moved during refinement
+    size_t coarsest = std::max<size_t>(20 * k, 64);
+    size_t max_vertex_weight = std::max<size_t>(1, max_weight / 4);
+    while (levels.back().size() > coarsest)
+    {
+        partition_level next = coarsen_level(levels.back(), max_vertex_weight, rng);
+        if (next.size() > levels.back().size() * 95 / 100)
+        {
+            levels.back().coarse.clear();
+            break;
+        }
+        levels.push_back(std::move(next));
+    }
+
+    // initial partition, then uncoarsen and refine
+    std::vector<size_t> assigned = initial_level_partition(levels.back(), k, max_weight, rng);
+    refine_level(levels.back(), k, assigned, max_weight, rng);
+    for (size_t l = levels.size() - 1; l-- > 0;)
+    {
+        std::vector<size_t> finer(levels[l].size());
+        for (size_t v = 0; v < finer.size(); ++v)
+            finer[v] = assigned[levels[l].coarse[v]];
+        assigned.swap(finer);
+        refine_level(levels[l], k, assigned, max_weight, rng);
+    }
+
+    for (size_t v = 0; v < n; ++v)
+        part[descriptors[v]] = assigned[v];
+    return true;
+}
+
+///@brief Edge cut, boundary vertices and balance of a k-way partition of g.
+template <typename Graph, typename PartMap>
+partition_metrics partition_quality(const Graph &g, size_t k, const PartMap &part)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+
+    partition_metrics m;
+    if (k == 0)
+        return m;
+    m.part_size.assign(k, 0);
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        ++m.part_size[part.at((*vi)->descriptor())];
+    std::unordered_map<vertex_descriptor, bool> boundary;
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        vertex_descriptor s = (*ei)->source();
+        vertex_descriptor t = (*ei)->target();
+        if (part.at(s) != part.at(t))
+        {
+            ++m.edge_cut;
+            boundary[s] = boundary[t] = true;
+        }
+    }
+    m.boundary_vertices = boundary.size();
+    size_t largest = *std::max_element(m.part_size.begin(), m.part_size.end());
+    m.balance = g.num_vertices() ? static_cast<double>(largest) * k / g.num_vertices() : 1.0;
+    return m;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// One part of a partitioned graph. local holds the owned vertices followed by
+/// a ghost copy of every vertex of another part that an owned vertex has an
+/// edge to, and every edge of g whose source is owned, so each edge of g lands
+/// in exactly one part. Ghosts carry their property but no out edges.
+///
+/// LocalGraph is the type of local: by default the type of g, which then needs
+/// clear, insert_vertex and insert_edge, or a csr_graph, which is built in one
+/// pass with descriptors 0..num_owned-1 for the owned vertices and the
+/// following ones for the ghosts (see build_graph in graph csr.h).
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph, typename LocalGraph = Graph>
+struct graph_part
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+
+    ///@brief A vertex stored here but owned by another part.
+    struct ghost
+    {
+        vertex_descriptor global; ///< Descriptor in the partitioned graph
+        size_t owner;             ///< Part that owns it
+    };
+
+    size_t id = 0;
+    LocalGraph local;
+    std::unordered_map<vertex_descriptor, vertex_descriptor> global_to_local; // owned and ghost
+    std::unordered_map<vertex_descriptor, vertex_descriptor> local_to_global; // owned and ghost
+    std::unordered_map<vertex_descriptor, ghost> ghosts;                      // keyed by local descriptor
+    std::vector<vertex_descriptor> boundary; ///< Owned local vertices with a cut out edge
+    size_t num_owned = 0;
+
+    bool is_ghost(vertex_descriptor local_vd) const { return ghosts.count(local_vd) != 0; }
+};
+
+///@brief Build part p of g under the assignment part into out, which is
+///       cleared first.
+template <typename Graph, typename PartMap, typename LocalGraph>
+void extract_part(const Graph &g, const PartMap &part, size_t p, graph_part<Graph, LocalGraph> &out)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+    typedef typename std::decay<decltype((*g.vertices_cbegin())->property())>::type vertex_property;
+    typedef typename std::decay<decltype((*g.edges_cbegin())->property())>::type edge_property;
+
+    // setup: local vertices and edges by position, owned vertices first
+    std::unordered_map<vertex_descriptor, size_t> position;
+    std::vector<vertex_descriptor> global;
+    std::vector<vertex_property> vprops;
+    std::vector<size_t> sources, targets;
+    std::vector<edge_property> eprops;
+    std::vector<size_t> boundary;
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        vertex_descriptor vd = (*vi)->descriptor();
+        if (part.at(vd) != p)
+            continue;
+        position.emplace(vd, global.size());
+        global.push_back(vd);
+        vprops.push_back((*vi)->property());
+    }
+    size_t num_owned = global.size();
+
+    // out edges of owned vertices, creating ghosts on demand
+    std::vector<char> on_boundary(num_owned, 0);
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        vertex_descriptor s = (*ei)->source();
+        vertex_descriptor t = (*ei)->target();
+        if (part.at(s) != p)
+            continue;
+        auto lt = position.find(t);
+        if (lt == position.end())
+        {
+            lt = position.emplace(t, global.size()).first;
+            global.push_back(t);
+            vprops.push_back((*g.find_vertex(t))->property());
+        }
+        size_t ls = position.at(s);
+        sources.push_back(ls);
+        targets.push_back(lt->second);
+        eprops.push_back((*ei)->property());
+        if (part.at(t) != p && !on_boundary[ls])
+        {
+            on_boundary[ls] = 1;
+            boundary.push_back(ls);
+        }
+    }
+
+    // finalize
+    std::vector<typename LocalGraph::vertex_descriptor> local(global.size());
+    for (size_t i = 0; i < local.size(); ++i)
+        local[i] = i;
+    build_graph(out.local, local, vprops, sources, targets, eprops);
+    out.id = p;
+    out.num_owned = num_owned;
+    out.global_to_local.clear();
+    out.local_to_global.clear();
+    out.ghosts.clear();
+    out.boundary.clear();
+    for (size_t i = 0; i < global.size(); ++i)
+    {
+        out.global_to_local[global[i]] = local[i];
+        out.local_to_global[local[i]] = global[i];
+        if (i >= num_owned)
+            out.ghosts[local[i]] = {global[i], static_cast<size_t>(part.at(global[i]))};
+    }
+    for (size_t i : boundary)
+        out.boundary.push_back(local[i]);
+}
+
+#endif
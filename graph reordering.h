@@ -0,0 +1,277 @@
+#ifndef _GRAPH_REORDERING_H_
+#define _GRAPH_REORDERING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Vertex reordering for cache locality. Each routine computes a permutation of
+// the vertices of g and stores it in a vertex_permutation; apply_permutation
+// then renumbers the graph through its relabel() member so that the vertex,
+// edge and adjacency storage is rebuilt in the new order.
+//
+// New descriptors are always dense: the vertex placed first gets 0, the next
+// 1, and so on. The permutation keeps both directions so callers can translate
+// ids they hold outside the graph.
+//
+
+///@brief Bidirectional old <-> new descriptor map produced by the orderings.
+template <typename Graph>
+struct vertex_permutation
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+
+    std::unordered_map<vertex_descriptor, vertex_descriptor> old_to_new;
+    std::vector<vertex_descriptor> new_to_old; // indexed by new descriptor
+
+    vertex_descriptor to_new(vertex_descriptor vd) const { return old_to_new.at(vd); }
+    vertex_descriptor to_old(vertex_descriptor vd) const { return new_to_old.at(vd); }
+    size_t size() const { return new_to_old.size(); }
+
+    ///@brief Fill both directions from the list of old descriptors in their
+    ///       new order.
+    void assign(std::vector<vertex_descriptor> order)
+    {
+        new_to_old = std::move(order);
+        old_to_new.clear();
+        old_to_new.reserve(new_to_old.size());
+        for (size_t i = 0; i < new_to_old.size(); ++i)
+            old_to_new[new_to_old[i]] = i;
+    }
+};
+
+///@brief Index-based out/in adjacency of g in vertex iteration order, shared
+///       by the orderings below.
+template <typename Graph>
+void reorder_adjacency(const Graph &g,
+                       std::vector<typename Graph::vertex_descriptor> &descriptors,
+                       std::vector<std::vector<size_t>> &out,
+                       std::vector<std::vector<size_t>> &in)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename Graph::const_vertex_iterator vertex_iterator;
+    typedef typename Graph::const_edge_iterator edge_iterator;
+
+    std::unordered_map<vertex_descriptor, size_t> index;
+    descriptors.clear();
+    index.reserve(g.num_vertices());
+    for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+    {
+        index.emplace((*vi)->descriptor(), descriptors.size());
+        descriptors.push_back((*vi)->descriptor());
+    }
+    out.assign(descriptors.size(), std::vector<size_t>());
+    in.assign(descriptors.size(), std::vector<size_t>());
+    for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+    {
+        size_t s = index.at((*ei)->source());
+        size_t t = index.at((*ei)->target());
+        out[s].push_back(t);
+        in[t].push_back(s);
+    }
+}
+
+///@brief Degree-descending order (in + out degree, ties keep the original
+///       order). Puts frequently touched vertices at the front of storage.
+template <typename Graph>
+void degree_sort_order(const Graph &g, vertex_permutation<Graph> &perm)
+{
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> out, in;
+    reorder_adjacency(g, descriptors, out, in);
+
+    std::vector<size_t> order(descriptors.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                     { return out[a].size() + in[a].size() > out[b].size() + in[b].size(); });
+
+    std::vector<typename Graph::vertex_descriptor> result;
+    result.reserve(order.size());
+    for (size_t i : order)
+        result.push_back(descriptors[i]);
+    perm.assign(std::move(result));
+}
+
+///@brief Hub clustering: vertices whose degree is above the average are
+///       packed together at the front, everything else follows, both groups
+///       in their original relative order. Cheaper than a full degree sort and
+///       keeps whatever locality the input order already had.
+template <typename Graph>
+void hub_cluster_order(const Graph &g, vertex_permutation<Graph> &perm)
+{
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> out, in;
+    reorder_adjacency(g, descriptors, out, in);
+
+    size_t n = descriptors.size();
+    double average = n ? 2.0 * g.num_edges() / n : 0.0;
+    std::vector<typename Graph::vertex_descriptor> hubs, rest;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (out[i].size() + in[i].size() > average)
+            hubs.push_back(descriptors[i]);
+        else
+            rest.push_back(descriptors[i]);
+    }
+    hubs.insert(hubs.end(), rest.begin(), rest.end());
+    perm.assign(std::move(hubs));
+}
+
+///@brief Reverse Cuthill-McKee on the symmetrized graph. Each component is
+///       started from its lowest-degree vertex and neighbours are visited in
+///       increasing degree, which keeps the bandwidth of the adjacency matrix
+///       small so BFS-like sweeps touch nearby memory.
+template <typename Graph>
+void reverse_cuthill_mckee_order(const Graph &g, vertex_permutation<Graph> &perm)
+{
+    // setup
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> out, in;
+    reorder_adjacency(g, descriptors, out, in);
+    size_t n = descriptors.size();
+
+    std::vector<std::vector<size_t>> adj(n);
+    for (size_t v = 0; v < n; ++v)
+    {
+        adj[v] = out[v];
+        adj[v].insert(adj[v].end(), in[v].begin(), in[v].end());
+        std::sort(adj[v].begin(), adj[v].end());
+        adj[v].erase(std::unique(adj[v].begin(), adj[v].end()), adj[v].end());
+    }
+    auto by_degree = [&](size_t a, size_t b)
+    {
+        return adj[a].size() < adj[b].size() || (adj[a].size() == adj[b].size() && a < b);
+    };
+    for (auto &a : adj)
+        std::sort(a.begin(), a.end(), by_degree);
+
+    // start vertices in increasing degree
+    std::vector<size_t> starts(n);
+    for (size_t i = 0; i < n; ++i)
+        starts[i] = i;
+    std::sort(starts.begin(), starts.end(), by_degree);
+
+    // Cuthill-McKee BFS
+    std::vector<char> visited(n, 0);
+    std::vector<size_t> order;
+    order.reserve(n);
+    for (size_t s : starts)
+    {
+        if (visited[s])
+            continue;
+        visited[s] = 1;
+        size_t head = order.size();
+        order.push_back(s);
+        while (head < order.size())
+        {
+            size_t v = order[head++];
+            for (size_t u : adj[v])
+            {
+                if (!visited[u])
+                {
+                    visited[u] = 1;
+                    order.push_back(u);
+                }
+            }
+        }
+    }
+
+    // reverse
+    std::vector<typename Graph::vertex_descriptor> result;
+    result.reserve(n);
+    for (auto i = order.rbegin(); i != order.rend(); ++i)
+        result.push_back(descriptors[*i]);
+    perm.assign(std::move(result));
+}
+
+///@brief Gorder (Wei et al.): greedily append the vertex that has the most
+///       locality with the last `window` placed vertices, where locality is
+///       the number of edges between them plus the number of shared
+///       in-neighbours. In-neighbours with more than sqrt(n) out-edges are not
+///       expanded when counting siblings, which bounds the cost on skewed
+///       graphs.
+template <typename Graph>
+void gorder_order(const Graph &g, vertex_permutation<Graph> &perm,
+                  size_t window = 5)
+{
+    // setup
+    std::vector<typename Graph::vertex_descriptor> descriptors;
+    std::vector<std::vector<size_t>> out, in;
+    reorder_adjacency(g, descriptors, out, in);
+    size_t n = descriptors.size();
+    size_t hub_limit = static_cast<size_t>(std::sqrt(static_cast<double>(n))) + 1;
+
+    std::vector<long> key(n, 0);
+    std::vector<char> placed(n, 0);
+    std::priority_queue<std::pair<long, size_t>> heap; // lazily updated (key, -v) max-heap
+    auto push = [&](size_t v)
+    {
+        heap.emplace(key[v], n - 1 - v);
+    };
+    auto update = [&](size_t v, long delta)
+    {
+        // scores of the window members themselves are irrelevant
+        auto bump = [&](size_t u)
+        {
+            if (!placed[u])
+            {
+                key[u] += delta;
+                push(u);
+            }
+        };
+        for (size_t u : out[v])
+            bump(u);
+        for (size_t u : in[v])
+        {
+            bump(u);
+            if (out[u].size() <= hub_limit)
+                for (size_t w : out[u])
+                    if (w != v)
+                        bump(w);
+        }
+    };
+
+    // initialize: ties go to the lowest original position
+    for (size_t v = 0; v < n; ++v)
+        push(v);
+
+    std::vector<size_t> order;
+    order.reserve(n);
+    while (order.size() < n)
+    {
+        size_t v;
+        for (;;)
+        {
+            auto top = heap.top();
+            heap.pop();
+            v = n - 1 - top.second;
+            if (!placed[v] && top.first == key[v])
+                break;
+        }
+        placed[v] = 1;
+        order.push_back(v);
+        update(v, 1);
+        if (order.size() > window)
+            update(order[order.size() - window - 1], -1);
+    }
+
+    std::vector<typename Graph::vertex_descriptor> result;
+    result.reserve(n);
+    for (size_t i : order)
+        result.push_back(descriptors[i]);
+    perm.assign(std::move(result));
+}
+
+///@brief Renumber g with perm. Afterwards descriptor perm.to_new(v) refers to
+///       the vertex formerly known as v.
+template <typename Graph>
+void apply_permutation(Graph &g, const vertex_permutation<Graph> &perm)
+{
+    g.relabel(perm.old_to_new);
+}
+
+#endif
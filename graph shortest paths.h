@@ -0,0 +1,663 @@
+#ifndef _GRAPH_SHORTEST_PATHS_H_
+#define _GRAPH_SHORTEST_PATHS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph parallel.h"
+
+// Shortest paths with non-negative edge weights, and at the end of the file
+// Bellman-Ford and SPFA for weights that may be negative.
+//
+//  - WeightMap: functor taking an edge (as dereferenced from an edge or
+//               adjacency iterator) and returning its weight, e.g.
+//               edge_property_weight or unit_weight.
+//
+//  - Heuristic: functor h(vp, target_vp) over two VertexProperties giving a
+//               lower bound on the distance between the two vertices, e.g.
+//               euclidean_heuristic on coordinates.
+//
+// The point-to-point searches (dijkstra_shortest_path, astar_shortest_path,
+// alt_shortest_path) share one A* loop and report how many vertices they
+// settled, so the pruning of a heuristic can be measured against plain
+// Dijkstra on the same query.
+//
+
+///@brief Weight functor that reads the edge property itself.
+struct edge_property_weight
+{
+    template <typename Edge>
+    auto operator()(const Edge &e) const -> typename std::decay<decltype(e->property())>::type
+    {
+        return e->property();
+    }
+};
+
+///@brief Weight functor giving every edge weight 1, i.e. BFS levels.
+struct unit_weight
+{
+    template <typename Edge>
+    size_t operator()(const Edge &) const { return 1; }
+};
+
+///@brief Heuristic that knows nothing; A* with it is Dijkstra.
+struct zero_heuristic
+{
+    template <typename VertexProperty>
+    double operator()(const VertexProperty &, const VertexProperty &) const { return 0; }
+};
+
+///@brief Straight-line distance between vertex properties holding planar
+///       coordinates (std::pair, std::tuple or std::array with the x and y
+///       first). scale is the smallest weight per unit of length, so the
+///       estimate stays admissible when weights are not plain lengths.
+struct euclidean_heuristic
+{
+    double scale = 1.0;
+
+    template <typename VertexProperty>
+    double operator()(const VertexProperty &a, const VertexProperty &b) const
+    {
+        double dx = static_cast<double>(std::get<0>(a)) - static_cast<double>(std::get<0>(b));
+        double dy = static_cast<double>(std::get<1>(a)) - static_cast<double>(std::get<1>(b));
+        return scale * std::sqrt(dx * dx + dy * dy);
+    }
+};
+
+///@brief Outcome of a point-to-point search.
+template <typename Graph, typename Distance>
+struct shortest_path_result
+{
+    bool found = false;
+    Distance distance = Distance();
+    std::vector<typename Graph::vertex_descriptor> path; // source first, target last
+    size_t settled = 0;                                  // Vertices removed from the queue for good
+    size_t relaxed = 0;                                  // Edges scanned
+};
+
+///@brief Distance type produced by WeightMap on the edges of Graph.
+template <typename Graph, typename WeightMap>
+using weight_type = typename std::decay<decltype(std::declval<WeightMap>()(*std::declval<typename Graph::const_edge_iterator>()))>::type;
+
+///@brief Single-source Dijkstra. d and p receive the distance and parent of
+///       every vertex reachable from source; the source gets parent -1 as in
+///       breadth_first_search. Returns the number of settled vertices, 0 with
+///       d and p empty if source is not in g.
+template <typename Graph, typename DistanceMap, typename ParentMap, typename WeightMap = edge_property_weight>
+size_t dijkstra_shortest_paths(const Graph &g, typename Graph::vertex_descriptor source,
+                               DistanceMap &d, ParentMap &p, WeightMap w = WeightMap())
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef weight_type<Graph, WeightMap> distance_type;
+    typedef std::pair<distance_type, vertex_descriptor> entry;
+
+    // setup
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> q;
+    std::unordered_map<vertex_descriptor, distance_type> dist;
+    size_t settled = 0;
+    d.clear();
+    p.clear();
+    if (g.find_vertex(source) == g.vertices_cend())
+        return settled;
+    dist[source] = distance_type();
+    p[source] = -1;
+    q.emplace(distance_type(), source);
+
+    while (!q.empty())
+    {
+        entry top = q.top();
+        q.pop();
+        if (top.first > dist[top.second])
+            continue; // stale
+        ++settled;
+        d[top.second] = top.first;
+        auto &v = *g.find_vertex(top.second);
+        for (auto aei = v->begin(); aei != v->end(); ++aei)
+        {
+            vertex_descriptor t = (*aei)->target();
+            distance_type nd = top.first + w(*aei);
+            auto i = dist.find(t);
+            if (i == dist.end() || nd < i->second)
+            {
+                dist[t] = nd;
+                p[t] = top.second;
+                q.emplace(nd, t);
+            }
+        }
+    }
+    return settled;
+}
+
+///@brief The A* loop behind the point-to-point searches. bound(v) must be a
+///       lower bound on the distance from v to target. Vertices are reopened
+///       when a shorter path to them is found, so admissible but inconsistent
+///       bounds still give exact distances.
+template <typename Graph, typename Bound, typename WeightMap>
+shortest_path_result<Graph, weight_type<Graph, WeightMap>>
+bounded_shortest_path(const Graph &g, typename Graph::vertex_descriptor source,
+                      typename Graph::vertex_descriptor target, Bound bound, WeightMap w)
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef weight_type<Graph, WeightMap> distance_type;
+    typedef std::pair<double, vertex_descriptor> entry; // (distance + bound, vertex)
+
+    // setup
+    shortest_path_result<Graph, distance_type> r;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> q;
+    std::unordered_map<vertex_descriptor, distance_type> dist;
+    std::unordered_map<vertex_descriptor, vertex_descriptor> parent;
+    std::unordered_map<vertex_descriptor, double> closed; // key the vertex was settled with
+    if (g.find_vertex(source) == g.vertices_cend() || g.find_vertex(target) == g.vertices_cend())
+        return r;
+    dist[source] = distance_type();
+    q.emplace(static_cast<double>(bound(source)), source);
+
+    while (!q.empty())
+    {
+        entry top = q.top();
+        q.pop();
+        vertex_descriptor u = top.second;
+        distance_type du = dist[u];
+        auto c = closed.find(u);
+        if (c != closed.end() && c->second <= top.first)
+            continue; // stale
+        closed[u] = top.first;
+        ++r.settled;
+        if (u == target)
+        {
+            r.found = true;
+            r.distance = du;
+            for (vertex_descriptor v = target; v != source; v = parent.at(v))
+                r.path.push_back(v);
+            r.path.push_back(source);
+            std::reverse(r.path.begin(), r.path.end());
+            return r;
+        }
+        auto &v = *g.find_vertex(u);
+        for (auto aei = v->begin(); aei != v->end(); ++aei)
+        {
+            ++r.relaxed;
+            vertex_descriptor t = (*aei)->target();
+            distance_type nd = du + w(*aei);
+            auto i = dist.find(t);
+            if (i == dist.end() || nd < i->second)
+            {
+                dist[t] = nd;
+                parent[t] = u;
+                double key = static_cast<double>(nd) + static_cast<double>(bound(t));
+                closed.erase(t);
+                q.emplace(key, t);
+            }
+        }
+    }
+    return r;
+}
+
+///@brief Point-to-point Dijkstra that stops once target is settled. The
+///       baseline for the settled counts of the goal-directed searches.
+template <typename Graph, typename WeightMap = edge_property_weight>
+shortest_path_result<Graph, weight_type<Graph, WeightMap>>
+dijkstra_shortest_path(const Graph &g, typename Graph::vertex_descriptor source,
+                       typename Graph::vertex_descriptor target, WeightMap w = WeightMap())
+{
+    return bounded_shortest_path(g, source, target,
+                                 [](typename Graph::vertex_descriptor)
+                                 { return 0.0; },
+                                 w);
+}
+
+///@brief A* guided by h(property of v, property of target). h must never
+///       overestimate the remaining distance.
+template <typename Graph, typename Heuristic, typename WeightMap = edge_property_weight>
+shortest_path_result<Graph, weight_type<Graph, WeightMap>>
+astar_shortest_path(const Graph &g, typename Graph::vertex_descriptor source,
+                    typename Graph::vertex_descriptor target, Heuristic h, WeightMap w = WeightMap())
+{
+    auto ti = g.find_vertex(target);
+    if (ti == g.vertices_cend())
+        return shortest_path_result<Graph, weight_type<Graph, WeightMap>>();
+    const auto &target_property = (*ti)->property();
+    return bounded_shortest_path(g, source, target,
+                                 [&](typename Graph::vertex_descriptor v)
+                                 {
+                                     return h((*g.find_vertex(v))->property(), target_property);
+                                 },
+                                 w);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// ALT preprocessing (A*, landmarks, triangle inequality; Goldberg and
+/// Harrelson). For a few landmarks L the exact distances d(L, v) and d(v, L)
+/// are stored for every vertex, and
+///
+///     d(v, t) >= max over L of d(L, t) - d(L, v) and d(v, L) - d(t, L)
+///
+/// gives a consistent lower bound for A*. Landmarks are chosen by farthest
+/// selection: each new landmark is the vertex farthest (in hops of the
+/// symmetrised graph) from those already chosen, which spreads them over the
+/// periphery where their bounds are tightest.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Graph, typename WeightMap = edge_property_weight>
+class alt_landmarks
+{
+public:
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef weight_type<Graph, WeightMap> distance_type;
+
+    alt_landmarks(const Graph &g, size_t num_landmarks, WeightMap w = WeightMap()) : m_weight(w)
+    {
+        typedef typename Graph::const_vertex_iterator vertex_iterator;
+        typedef typename Graph::const_edge_iterator edge_iterator;
+
+        // setup: weighted forward and reverse adjacency by position
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            m_index.emplace((*vi)->descriptor(), m_descriptors.size());
+            m_descriptors.push_back((*vi)->descriptor());
+        }
+        size_t n = m_descriptors.size();
+        std::vector<std::vector<std::pair<size_t, distance_type>>> out(n), in(n);
+        for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+        {
+            size_t s = m_index.at((*ei)->source());
+            size_t t = m_index.at((*ei)->target());
+            distance_type wt = m_weight(*ei);
+            out[s].emplace_back(t, wt);
+            in[t].emplace_back(s, wt);
+        }
+
+        // farthest selection on hop distances
+        std::vector<size_t> hops(n, std::numeric_limits<size_t>::max());
+        for (size_t l = 0; l < num_landmarks && l < n; ++l)
+        {
+            size_t pick = 0;
+            if (l > 0)
+            {
+                // unreached vertices are infinitely far: start covering them
+                for (size_t v = 1; v < n; ++v)
+                    if (hops[v] > hops[pick])
+                        pick = v;
+                if (hops[pick] == 0)
+                    break;
+            }
+            m_landmarks.push_back(m_descriptors[pick]);
+            m_from.push_back(distances(out, pick));
+            m_to.push_back(distances(in, pick));
+            // update hop distances by BFS over both directions
+            std::queue<size_t> q;
+            hops[pick] = 0;
+            q.push(pick);
+            while (!q.empty())
+            {
+                size_t u = q.front();
+                q.pop();
+                for (auto *adj : {&out[u], &in[u]})
+                    for (auto &a : *adj)
+                        if (hops[a.first] > hops[u] + 1)
+                        {
+                            hops[a.first] = hops[u] + 1;
+                            q.push(a.first);
+                        }
+            }
+        }
+    }
+
+    static distance_type infinity() { return std::numeric_limits<distance_type>::max(); }
+
+    const std::vector<vertex_descriptor> &landmarks() const { return m_landmarks; }
+
+    ///@brief Lower bound on the distance from v to t.
+    distance_type lower_bound(vertex_descriptor v, vertex_descriptor t) const
+    {
+        size_t vi = m_index.at(v);
+        size_t ti = m_index.at(t);
+        distance_type best = distance_type();
+        for (size_t l = 0; l < m_landmarks.size(); ++l)
+        {
+            const auto &from = m_from[l];
+            const auto &to = m_to[l];
+            if (from[ti] != infinity() && from[vi] != infinity() && from[ti] > from[vi])
+                best = std::max(best, from[ti] - from[vi]);
+            if (to[vi] != infinity() && to[ti] != infinity() && to[vi] > to[ti])
+                best = std::max(best, to[vi] - to[ti]);
+        }
+        return best;
+    }
+
+    ///@brief Bytes held by the distance arrays.
+    size_t memory_usage() const
+    {
+        return 2 * m_landmarks.size() * m_descriptors.size() * sizeof(distance_type);
+    }
+
+    const WeightMap &weight() const { return m_weight; }
+
+private:
+    static std::vector<distance_type> distances(const std::vector<std::vector<std::pair<size_t, distance_type>>> &adj,
+                                                size_t source)
+    {
+        typedef std::pair<distance_type, size_t> entry;
+        std::vector<distance_type> d(adj.size(), infinity());
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> q;
+        d[source] = distance_type();
+        q.emplace(distance_type(), source);
+        while (!q.empty())
+        {
+            entry top = q.top();
+            q.pop();
+            if (top.first > d[top.second])
+                continue;
+            for (auto &a : adj[top.second])
+                if (top.first + a.second < d[a.first])
+                {
+                    d[a.first] = top.first + a.second;
+                    q.emplace(d[a.first], a.first);
+                }
+        }
+        return d;
+    }
+
+    WeightMap m_weight;
+    std::unordered_map<vertex_descriptor, size_t> m_index;
+    std::vector<vertex_descriptor> m_descriptors;
+    std::vector<vertex_descriptor> m_landmarks;
+    std::vector<std::vector<distance_type>> m_from; // m_from[l][v] = d(landmark l, v)
+    std::vector<std::vector<distance_type>> m_to;   // m_to[l][v] = d(v, landmark l)
+};
+
+///@brief A* with the landmark bounds of alt. The graph must not have changed
+///       since alt was built.
+template <typename Graph, typename WeightMap>
+shortest_path_result<Graph, weight_type<Graph, WeightMap>>
+alt_shortest_path(const Graph &g, typename Graph::vertex_descriptor source,
+                  typename Graph::vertex_descriptor target, const alt_landmarks<Graph, WeightMap> &alt)
+{
+    return bounded_shortest_path(g, source, target,
+                                 [&](typename Graph::vertex_descriptor v)
+                                 {
+                                     return alt.lower_bound(v, target);
+                                 },
+                                 alt.weight());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Negative weights. Dijkstra is wrong as soon as an edge weight is negative;
+/// Bellman-Ford and its queue-based form SPFA are not, and they can report a
+/// negative cycle reachable from the source instead of a distance.
+///
+/// Cycles are detected early by looking for a cycle in the parent pointers
+/// (Cherkassky and Goldberg): such a cycle is always negative, and with a
+/// reachable negative cycle one appears long before the n-th pass a plain
+/// Bellman-Ford would wait for. The check is O(n) and runs after every pass,
+/// or after every n parent updates in SPFA.
+////////////////////////////////////////////////////////////////////////////////
+
+///@brief Outcome of a single-source search that allows negative weights.
+template <typename Graph>
+struct negative_weight_result
+{
+    bool negative_cycle = false;
+    std::vector<typename Graph::vertex_descriptor> cycle; // Each vertex has an edge to the next, the last to the first
+    size_t passes = 0;                                    // Sweeps over the edges (SPFA: 0)
+    size_t relaxed = 0;                                   // Edges scanned from reached vertices
+};
+
+///@brief The edges of a graph by vertex position, grouped by source, as the
+///       negative-weight searches sweep them.
+template <typename Graph, typename WeightMap>
+struct weighted_edge_list
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef weight_type<Graph, WeightMap> distance_type;
+
+    weighted_edge_list(const Graph &g, WeightMap w)
+    {
+        typedef typename Graph::const_vertex_iterator vertex_iterator;
+        typedef typename Graph::const_edge_iterator edge_iterator;
+
+        for (vertex_iterator vi = g.vertices_cbegin(); vi != g.vertices_cend(); ++vi)
+        {
+            index.emplace((*vi)->descriptor(), descriptors.size());
+            descriptors.push_back((*vi)->descriptor());
+        }
+        offsets.assign(descriptors.size() + 1, 0);
+        for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+            ++offsets[index.at((*ei)->source()) + 1];
+        for (size_t v = 0; v < descriptors.size(); ++v)
+            offsets[v + 1] += offsets[v];
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        sources.resize(offsets.back());
+        targets.resize(offsets.back());
+        weights.resize(offsets.back());
+        for (edge_iterator ei = g.edges_cbegin(); ei != g.edges_cend(); ++ei)
+        {
+            size_t s = index.at((*ei)->source());
+            size_t i = fill[s]++;
+            sources[i] = s;
+            targets[i] = index.at((*ei)->target());
+            weights[i] = w(*ei);
+        }
+    }
+
+    size_t num_vertices() const { return descriptors.size(); }
+    size_t num_edges() const { return targets.size(); }
+
+    std::unordered_map<vertex_descriptor, size_t> index;
+    std::vector<vertex_descriptor> descriptors;
+    std::vector<size_t> offsets; // edges of v are [offsets[v], offsets[v + 1])
+    std::vector<size_t> sources;
+    std::vector<size_t> targets;
+    std::vector<distance_type> weights;
+};
+
+///@brief A cycle in the parent pointers (npos for none), in edge order, or an
+///       empty vector if they form a forest.
+inline std::vector<size_t> find_parent_cycle(const std::vector<size_t> &parent)
+{
+    const size_t npos = std::numeric_limits<size_t>::max();
+    std::vector<size_t> walk(parent.size(), npos); // start of the walk that visited each vertex
+    for (size_t s = 0; s < parent.size(); ++s)
+    {
+        size_t v = s;
+        while (v != npos && walk[v] == npos)
+        {
+            walk[v] = s;
+            v = parent[v];
+        }
+        if (v == npos || walk[v] != s)
+            continue; // reached a root or an earlier walk
+        // v is on the cycle; parents run against the edges
+        std::vector<size_t> cycle(1, v);
+        for (size_t u = parent[v]; u != v; u = parent[u])
+            cycle.push_back(u);
+        std::reverse(cycle.begin(), cycle.end());
+        return cycle;
+    }
+    return std::vector<size_t>();
+}
+
+///@brief Copy a finished search over e into d, p and r.
+template <typename Graph, typename WeightMap, typename Distances, typename DistanceMap, typename ParentMap>
+void finish_negative_weight_search(const weighted_edge_list<Graph, WeightMap> &e, const Distances &dist,
+                                   const std::vector<size_t> &parent, DistanceMap &d, ParentMap &p,
+                                   negative_weight_result<Graph> &r)
+{
+    typedef weight_type<Graph, WeightMap> distance_type;
+
+    d.clear();
+    p.clear();
+    for (size_t v = 0; v < e.num_vertices(); ++v)
+    {
+        distance_type dv = dist[v];
+        if (dv == std::numeric_limits<distance_type>::max())
+            continue;
+        d[e.descriptors[v]] = dv;
+        if (parent[v] == std::numeric_limits<size_t>::max())
+            p[e.descriptors[v]] = -1;
+        else
+            p[e.descriptors[v]] = e.descriptors[parent[v]];
+    }
+    std::vector<size_t> cycle = find_parent_cycle(parent);
+    r.negative_cycle = !cycle.empty();
+    for (size_t v : cycle)
+        r.cycle.push_back(e.descriptors[v]);
+}
+
+///@brief Bellman-Ford from source: sweep all edges until a pass changes
+///       nothing or the parent pointers close a cycle. With more than one
+///       thread each pass splits the edges into one chunk per thread; threads
+///       read distances without locking and update a distance together with
+///       its parent under a striped lock, which keeps the parent pointers
+///       consistent with the distances. d and p are as in
+///       dijkstra_shortest_paths, empty if source is not in g; they are
+///       meaningless if a negative cycle is reported.
+template <typename Graph, typename DistanceMap, typename ParentMap, typename WeightMap = edge_property_weight>
+negative_weight_result<Graph> bellman_ford_shortest_paths(const Graph &g, typename Graph::vertex_descriptor source,
+                                                          DistanceMap &d, ParentMap &p, WeightMap w = WeightMap(),
+                                                          size_t num_threads = 1)
+{
+    typedef weight_type<Graph, WeightMap> distance_type;
+    const distance_type infinity = std::numeric_limits<distance_type>::max();
+    const size_t npos = std::numeric_limits<size_t>::max();
+    const size_t num_locks = 1024;
+
+    // setup
+    negative_weight_result<Graph> r;
+    d.clear();
+    p.clear();
+    if (g.find_vertex(source) == g.vertices_cend())
+        return r;
+    weighted_edge_list<Graph, WeightMap> e(g, w);
+    size_t n = e.num_vertices();
+    std::unique_ptr<std::atomic<distance_type>[]> dist(new std::atomic<distance_type>[n]);
+    for (size_t v = 0; v < n; ++v)
+        dist[v].store(infinity, std::memory_order_relaxed);
+    std::vector<size_t> parent(n, npos);
+    std::vector<std::mutex> locks(num_threads > 1 ? num_locks : 0);
+    dist[e.index.at(source)].store(distance_type(), std::memory_order_relaxed);
+
+    std::atomic<bool> changed(true);
+    std::atomic<size_t> relaxed(0);
+    while (changed.load())
+    {
+        changed.store(false);
+        ++r.passes;
+        parallel_chunks(
+            0, e.num_edges(), [&](size_t, size_t lo, size_t hi)
+            {
+                size_t scanned = 0;
+                bool improved = false;
+                for (size_t i = lo; i < hi; ++i)
+                {
+                    distance_type ds = dist[e.sources[i]].load(std::memory_order_relaxed);
+                    if (ds == infinity)
+                        continue;
+                    ++scanned;
+                    size_t t = e.targets[i];
+                    distance_type nd = ds + e.weights[i];
+                    if (!(nd < dist[t].load(std::memory_order_relaxed)))
+                        continue;
+                    if (locks.empty())
+                    {
+                        dist[t].store(nd, std::memory_order_relaxed);
+                        parent[t] = e.sources[i];
+                        improved = true;
+                        continue;
+                    }
+                    std::lock_guard<std::mutex> lock(locks[t % num_locks]);
+                    if (nd < dist[t].load(std::memory_order_relaxed))
+                    {
+                        dist[t].store(nd, std::memory_order_relaxed);
+                        parent[t] = e.sources[i];
+                        improved = true;
+                    }
+                }
+                relaxed += scanned;
+                if (improved)
+                    changed.store(true); },
+            num_threads);
+        if (changed.load() && !find_parent_cycle(parent).empty())
+            break;
+    }
+    r.relaxed = relaxed.load();
+
+    // finalize
+    std::vector<distance_type> final_dist(n);
+    for (size_t v = 0; v < n; ++v)
+        final_dist[v] = dist[v].load(std::memory_order_relaxed);
+    finish_negative_weight_search(e, final_dist, parent, d, p, r);
+    return r;
+}
+
+///@brief SPFA (queue-based Bellman-Ford): only vertices whose distance
+///       dropped are scanned again, in FIFO order. Usually far fewer edge
+///       scans than full passes. d and p as in bellman_ford_shortest_paths.
+template <typename Graph, typename DistanceMap, typename ParentMap, typename WeightMap = edge_property_weight>
+negative_weight_result<Graph> spfa_shortest_paths(const Graph &g, typename Graph::vertex_descriptor source,
+                                                  DistanceMap &d, ParentMap &p, WeightMap w = WeightMap())
+{
+    typedef weight_type<Graph, WeightMap> distance_type;
+    const distance_type infinity = std::numeric_limits<distance_type>::max();
+    const size_t npos = std::numeric_limits<size_t>::max();
+
+    // setup
+    negative_weight_result<Graph> r;
+    d.clear();
+    p.clear();
+    if (g.find_vertex(source) == g.vertices_cend())
+        return r;
+    weighted_edge_list<Graph, WeightMap> e(g, w);
+    size_t n = e.num_vertices();
+    std::vector<distance_type> dist(n, infinity);
+    std::vector<size_t> parent(n, npos);
+    std::vector<bool> queued(n, false);
+    std::queue<size_t> q;
+    size_t s = e.index.at(source);
+    dist[s] = distance_type();
+    queued[s] = true;
+    q.push(s);
+
+    size_t updates = 0;
+    while (!q.empty())
+    {
+        size_t u = q.front();
+        q.pop();
+        queued[u] = false;
+        for (size_t i = e.offsets[u]; i < e.offsets[u + 1]; ++i)
+        {
+            ++r.relaxed;
+            size_t t = e.targets[i];
+            distance_type nd = dist[u] + e.weights[i];
+            if (!(nd < dist[t]))
+                continue;
+            dist[t] = nd;
+            parent[t] = u;
+            if (!queued[t])
+            {
+                queued[t] = true;
+                q.push(t);
+            }
+            // amortised: one O(n) cycle check per n updates
+            if (++updates % n == 0 && !find_parent_cycle(parent).empty())
+            {
+                finish_negative_weight_search(e, dist, parent, d, p, r);
+                return r;
+            }
+        }
+    }
+    finish_negative_weight_search(e, dist, parent, d, p, r);
+    return r;
+}
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef _GRAPH_SNAPSHOT_H_
+#define _GRAPH_SNAPSHOT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph csr.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// A multi-version graph for serving traversals while the graph is mutated.
+///
+/// Writers call the usual modifiers (insert_vertex, insert_edge, erase_vertex,
+/// ...). They are serialized among themselves and only append to a pending
+/// batch. commit() applies the batch to a copy of the current version and
+/// publishes the result as a new immutable csr_graph with a single atomic
+/// store (RCU style).
+///
+/// Readers call pin() to obtain a snapshot_guard. Pinning never blocks on
+/// writers: the reader announces the current epoch in a slot and loads the
+/// current version. The guard exposes a const csr_graph, so every routine in
+/// graph algorithms.h runs on it without locks while ingest continues.
+///
+/// Replaced versions are retired with the epoch in which they stopped being
+/// current and deleted once no reader is pinned at an earlier epoch.
+////////////////////////////////////////////////////////////////////////////////
+template <typename VertexProperty, typename EdgeProperty>
+class versioned_graph
+{
+public:
+    typedef csr_graph<VertexProperty, EdgeProperty> snapshot_type;
+    typedef typename snapshot_type::vertex_descriptor vertex_descriptor;
+    typedef typename snapshot_type::edge_descriptor edge_descriptor;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Keeps one version alive for as long as it exists.
+    ////////////////////////////////////////////////////////////////////////////
+    class snapshot_guard
+    {
+    public:
+        snapshot_guard(snapshot_guard &&o) noexcept : m_slot(o.m_slot), m_graph(o.m_graph), m_epoch(o.m_epoch)
+        {
+            o.m_slot = nullptr;
+        }
+        snapshot_guard(const snapshot_guard &) = delete;
+        snapshot_guard &operator=(const snapshot_guard &) = delete;
+        ~snapshot_guard()
+        {
+            if (m_slot)
+                m_slot->store(idle, std::memory_order_release);
+        }
+
+        const snapshot_type &graph() const { return *m_graph; }
+        const snapshot_type &operator*() const { return *m_graph; }
+        const snapshot_type *operator->() const { return m_graph; }
+        uint64_t epoch() const { return m_epoch; }
+
+    private:
+        snapshot_guard(std::atomic<uint64_t> *slot, const snapshot_type *g, uint64_t e) : m_slot(slot), m_graph(g), m_epoch(e) {}
+
+        std::atomic<uint64_t> *m_slot; // Reader slot, reset on destruction
+        const snapshot_type *m_graph;  // Pinned version
+        uint64_t m_epoch;              // Epoch at which it was pinned
+
+        friend class versioned_graph;
+    };
+
+    /// constructors/destructors
+    explicit versioned_graph(size_t max_readers = 256)
+        : m_max_vd(0), m_epoch(1), m_current(new snapshot_type()),
+          m_num_slots(std::max<size_t>(1, max_readers)),
+          m_slots(new std::atomic<uint64_t>[m_num_slots])
+    {
+        for (size_t i = 0; i < m_num_slots; ++i)
+            m_slots[i].store(idle);
+    }
+
+    ///@brief All guards must have been released.
+    ~versioned_graph()
+    {
+        for (auto &r : m_retired)
+            delete r.second;
+        delete m_current.load();
+    }
+
+    versioned_graph(const versioned_graph &) = delete;
+    versioned_graph &operator=(const versioned_graph &) = delete;
+
+    /// reader operations
+
+    ///@brief Pin the current version. Lock-free with respect to writers; only
+    ///       spins if all reader slots are taken.
+    snapshot_guard pin() const
+    {
+        size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_num_slots;
+        for (size_t attempt = 0;; ++attempt)
+        {
+            size_t i = (start + attempt) % m_num_slots;
+            uint64_t expected = idle;
+            uint64_t e = m_epoch.load();
+            if (!m_slots[i].compare_exchange_strong(expected, e))
+            {
+                // every slot is busy, let other readers finish
+                if ((attempt + 1) % m_num_slots == 0)
+                    std::this_thread::yield();
+                continue;
+            }
+            // re-announce until the epoch is stable, then read the version
+            for (;;)
+            {
+                uint64_t now = m_epoch.load();
+                if (now == e)
+                    break;
+                e = now;
+                m_slots[i].store(e);
+            }
+            return snapshot_guard(&m_slots[i], m_current.load(), e);
+        }
+    }
+
+    ///@brief Number of the version readers currently get.
+    uint64_t version() const { return m_epoch.load(); }
+
+    /// writer operations (thread safe, applied on commit)
+
+    vertex_descriptor insert_vertex(const VertexProperty &vp)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        m_vertex_properties.push_back(vp);
+        m_log.push_back({op_insert_vertex, m_max_vd, 0, m_vertex_properties.size() - 1});
+        return m_max_vd++;
+    }
+
+    edge_descriptor insert_edge(vertex_descriptor sd, vertex_descriptor td,
+                                const EdgeProperty &ep)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        m_edge_properties.push_back(ep);
+        m_log.push_back({op_insert_edge, sd, td, m_edge_properties.size() - 1});
+        return {sd, td};
+    }
+
+    void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td,
+                                const EdgeProperty &ep)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        m_edge_properties.push_back(ep);
+        m_log.push_back({op_insert_edge, sd, td, m_edge_properties.size() - 1});
+        m_log.push_back({op_insert_edge, td, sd, m_edge_properties.size() - 1});
+    }
+
+    void erase_vertex(vertex_descriptor vd)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        m_log.push_back({op_erase_vertex, vd, 0, 0});
+    }
+
+    void erase_edge(edge_descriptor ed)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        m_log.push_back({op_erase_edge, ed.first, ed.second, 0});
+    }
+
+    ///@brief Number of buffered modifications not yet visible to readers.
+    size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        return m_log.size();
+    }
+
+    ///@brief Apply the pending batch, publish it as a new version and reclaim
+    ///       versions no reader can still see. Returns the new version number.
+    uint64_t commit()
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        if (m_log.empty())
+            return m_epoch.load();
+
+        snapshot_type *next = apply_log(*m_current.load());
+        m_log.clear();
+        m_vertex_properties.clear();
+        m_edge_properties.clear();
+
+        // publish, then advance the epoch; readers that see the new epoch are
+        // guaranteed to also see the new version
+        const snapshot_type *old = m_current.exchange(next);
+        uint64_t e = m_epoch.fetch_add(1) + 1;
+        m_retired.emplace_back(e, old);
+        collect_locked();
+        return e;
+    }
+
+    ///@brief Delete retired versions that are no longer pinned. Returns the
+    ///       number of versions still waiting for readers.
+    size_t collect()
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        collect_locked();
+        return m_retired.size();
+    }
+
+private:
+    static constexpr uint64_t idle = UINT64_MAX;
+
+    enum op_kind
+    {
+        op_insert_vertex,
+        op_insert_edge,
+        op_erase_vertex,
+        op_erase_edge
+    };
+
+    struct operation
+    {
+        op_kind kind;
+        vertex_descriptor s;
+        vertex_descriptor t;
+        size_t property; // Index into the pending property arrays
+    };
+
+    void collect_locked()
+    {
+        uint64_t oldest = idle;
+        for (size_t i = 0; i < m_num_slots; ++i)
+            oldest = std::min(oldest, m_slots[i].load());
+        auto keep = std::remove_if(m_retired.begin(), m_retired.end(),
+                                   [&](const std::pair<uint64_t, const snapshot_type *> &r)
+                                   {
+                                       if (r.first > oldest)
+                                           return false;
+                                       delete r.second;
+                                       return true;
+                                   });
+        m_retired.erase(keep, m_retired.end());
+    }
+
+    ///@brief Copy g, replay the log in order and build the next version.
+    snapshot_type *apply_log(const snapshot_type &g) const
+    {
+        // mutable copy
+        std::vector<vertex_descriptor> descriptors(g.descriptors());
+        std::vector<VertexProperty> vprops;
+        vprops.reserve(descriptors.size());
+        for (size_t i = 0; i < descriptors.size(); ++i)
+            vprops.push_back(g.vertex_property(i));
+        std::vector<char> alive(descriptors.size(), 1);
+        std::vector<std::vector<std::pair<vertex_descriptor, EdgeProperty>>> adj(descriptors.size());
+        std::unordered_map<vertex_descriptor, size_t> index;
+        index.reserve(descriptors.size());
+        for (size_t i = 0; i < descriptors.size(); ++i)
+        {
+            index.emplace(descriptors[i], i);
+            for (size_t j = g.offsets()[i]; j < g.offsets()[i + 1]; ++j)
+                adj[i].emplace_back(descriptors[g.targets()[j]], g.edge_property(j));
+        }
+
+        // replay
+        auto live = [&](vertex_descriptor vd)
+        {
+            auto i = index.find(vd);
+            return i != index.end() && alive[i->second] ? i->second : snapshot_type::npos;
+        };
+        for (const operation &op : m_log)
+        {
+            switch (op.kind)
+            {
+            case op_insert_vertex:
+                index.emplace(op.s, descriptors.size());
+                descriptors.push_back(op.s);
+                vprops.push_back(m_vertex_properties[op.property]);
+                alive.push_back(1);
+                adj.emplace_back();
+                break;
+            case op_insert_edge:
+            {
+                size_t s = live(op.s);
+                if (s != snapshot_type::npos && live(op.t) != snapshot_type::npos)
+                    adj[s].emplace_back(op.t, m_edge_properties[op.property]);
+                break;
+            }
+            case op_erase_vertex:
+            {
+                size_t v = live(op.s);
+                if (v != snapshot_type::npos)
+                {
+                    alive[v] = 0;
+                    adj[v].clear();
+                }
+                break;
+            }
+            case op_erase_edge:
+            {
+                size_t s = live(op.s);
+                if (s != snapshot_type::npos)
+                {
+                    auto &a = adj[s];
+                    auto e = std::find_if(a.begin(), a.end(),
+                                          [&](const std::pair<vertex_descriptor, EdgeProperty> &x)
+                                          { return x.first == op.t; });
+                    if (e != a.end())
+                        a.erase(e);
+                }
+                break;
+            }
+            }
+        }
+
+        // compact into CSR, dropping erased vertices and edges into them
+        std::vector<size_t> new_index(descriptors.size(), snapshot_type::npos);
+        std::vector<vertex_descriptor> out_descriptors;
+        std::vector<VertexProperty> out_vprops;
+        for (size_t i = 0; i < descriptors.size(); ++i)
+        {
+            if (!alive[i])
+                continue;
+            new_index[i] = out_descriptors.size();
+            out_descriptors.push_back(descriptors[i]);
+            out_vprops.push_back(std::move(vprops[i]));
+        }
+        std::vector<size_t> offsets(1, 0), targets;
+        std::vector<EdgeProperty> eprops;
+        for (size_t i = 0; i < descriptors.size(); ++i)
+        {
+            if (!alive[i])
+                continue;
+            for (auto &e : adj[i])
+            {
+                size_t t = new_index[index.at(e.first)];
+                if (t == snapshot_type::npos)
+                    continue;
+                targets.push_back(t);
+                eprops.push_back(std::move(e.second));
+            }
+            offsets.push_back(targets.size());
+        }
+
+        snapshot_type *next = new snapshot_type();
+        next->assign_csr(std::move(out_descriptors), std::move(out_vprops),
+                         std::move(offsets), std::move(targets), std::move(eprops));
+        return next;
+    }
+
+    size_t m_max_vd;                                                     // Id generator for inserted vertices
+    std::atomic<uint64_t> m_epoch;                                       // Global epoch, bumped on every commit
+    std::atomic<const snapshot_type *> m_current;                        // Version handed to new readers
+    size_t m_num_slots;                                                  // Maximum concurrent guards
+    std::unique_ptr<std::atomic<uint64_t>[]> m_slots;                    // Epoch pinned by each reader or idle
+    mutable std::mutex m_write_mutex;                                    // Serializes writers and commit
+    std::vector<operation> m_log;                                        // Pending batch
+    std::vector<VertexProperty> m_vertex_properties;                     // Properties referenced by m_log
+    std::vector<EdgeProperty> m_edge_properties;                         // Properties referenced by m_log
+    std::vector<std::pair<uint64_t, const snapshot_type *>> m_retired;   // (retire epoch, version)
+};
+
+#endif
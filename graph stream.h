@@ -0,0 +1,525 @@
+#ifndef _GRAPH_STREAM_H_
+#define _GRAPH_STREAM_H_
+
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Streaming ingestion of edge lists of unknown length with bounded buffers.
+//
+// Input is a sequence of lines "source target [property]" separated by
+// whitespace; empty lines and lines starting with '#' are skipped. Source and
+// target are external ids (arbitrary strings or 64-bit integers) which an
+// interner maps to dense ids on first sight; every new dense id becomes one
+// insert_vertex call on the graph. Bytes are read in fixed-size chunks and
+// edges are flushed to the graph in fixed-size batches, so apart from the
+// graph and the interner itself memory stays bounded whatever the input size.
+//
+// Lines whose ids or property do not parse are skipped and counted. A read
+// error or an interner running out of ids stops ingestion and clears
+// ingest_stats::ok.
+//
+
+////////////////////////////////////////////////////////////////////////////////
+/// Maps string ids to dense ids [0, size()). Strings are stored back to back in
+/// one byte arena and looked up through an open-addressing table of 32-bit
+/// entries, so each distinct id costs its length plus about 16 bytes.
+////////////////////////////////////////////////////////////////////////////////
+class string_id_interner
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t max_ids = UINT32_MAX - 1;
+
+    string_id_interner() : m_ends(1, 0), m_table(1024, 0) {}
+
+    ///@brief True if [b, e) is a valid id. Any non-empty token is.
+    static bool valid(const char *b, const char *e) { return b != e; }
+
+    ///@brief Dense id of the token [b, e), assigning the next one if new, or
+    ///       npos if the token is not valid or max_ids ids are taken.
+    size_t intern(const char *b, const char *e)
+    {
+        if (!valid(b, e))
+            return npos;
+        size_t len = e - b;
+        size_t mask = m_table.size() - 1;
+        for (size_t i = hash(b, len) & mask;; i = (i + 1) & mask)
+        {
+            uint32_t slot = m_table[i];
+            if (slot == 0)
+            {
+                size_t id = size();
+                if (id >= max_ids)
+                    return npos;
+                m_arena.insert(m_arena.end(), b, e);
+                m_ends.push_back(m_arena.size());
+                m_table[i] = static_cast<uint32_t>(id + 1);
+                if (2 * size() > m_table.size())
+                    grow();
+                return id;
+            }
+            size_t id = slot - 1;
+            if (m_ends[id + 1] - m_ends[id] == len && std::memcmp(&m_arena[m_ends[id]], b, len) == 0)
+                return id;
+        }
+    }
+
+    size_t intern(const std::string &s) { return intern(s.data(), s.data() + s.size()); }
+
+    ///@brief Dense id of the token [b, e), or npos if it was never interned.
+    size_t find(const char *b, const char *e) const
+    {
+        size_t len = e - b;
+        size_t mask = m_table.size() - 1;
+        for (size_t i = hash(b, len) & mask;; i = (i + 1) & mask)
+        {
+            uint32_t slot = m_table[i];
+            if (slot == 0)
+                return npos;
+            size_t id = slot - 1;
+            if (m_ends[id + 1] - m_ends[id] == len && std::memcmp(&m_arena[m_ends[id]], b, len) == 0)
+                return id;
+        }
+    }
+
+    ///@brief External id of a dense id.
+    std::string external_id(size_t id) const
+    {
+        return std::string(m_arena.data() + m_ends[id], m_ends[id + 1] - m_ends[id]);
+    }
+
+    size_t size() const { return m_ends.size() - 1; }
+
+    size_t memory_usage() const
+    {
+        return m_arena.capacity() + m_ends.capacity() * sizeof(uint64_t) + m_table.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static size_t hash(const char *b, size_t len)
+    {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < len; ++i)
+        {
+            h ^= static_cast<unsigned char>(b[i]);
+            h *= 1099511628211ull;
+        }
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+
+    void grow()
+    {
+        std::vector<uint32_t> table(m_table.size() * 2, 0);
+        size_t mask = table.size() - 1;
+        for (size_t id = 0; id < size(); ++id)
+        {
+            size_t i = hash(&m_arena[0] + m_ends[id], m_ends[id + 1] - m_ends[id]) & mask;
+            while (table[i])
+                i = (i + 1) & mask;
+            table[i] = static_cast<uint32_t>(id + 1);
+        }
+        m_table.swap(table);
+    }
+
+    std::vector<char> m_arena;     // All ids back to back
+    std::vector<uint64_t> m_ends;  // Id i occupies [m_ends[i], m_ends[i + 1])
+    std::vector<uint32_t> m_table; // Dense id + 1, 0 for empty
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Maps 64-bit integer ids to dense ids [0, size()) with an open-addressing
+/// table; each distinct id costs about 28 bytes.
+////////////////////////////////////////////////////////////////////////////////
+class integer_id_interner
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t max_ids = UINT32_MAX - 1;
+
+    integer_id_interner() : m_keys(1024, 0), m_values(1024, 0) {}
+
+    ///@brief Dense id of key, assigning the next one if new, or npos if
+    ///       max_ids ids are taken.
+    size_t intern(uint64_t key)
+    {
+        size_t mask = m_keys.size() - 1;
+        for (size_t i = hash(key) & mask;; i = (i + 1) & mask)
+        {
+            if (m_values[i] == 0)
+            {
+                size_t id = m_ids.size();
+                if (id >= max_ids)
+                    return npos;
+                m_ids.push_back(key);
+                m_keys[i] = key;
+                m_values[i] = static_cast<uint32_t>(id + 1);
+                if (2 * size() > m_keys.size())
+                    grow();
+                return id;
+            }
+            if (m_keys[i] == key)
+                return m_values[i] - 1;
+        }
+    }
+
+    ///@brief Parse the decimal integer [b, e) into key. False unless the
+    ///       token is all digits and fits in 64 bits.
+    static bool parse(const char *b, const char *e, uint64_t &key)
+    {
+        auto r = std::from_chars(b, e, key);
+        return b != e && r.ec == std::errc() && r.ptr == e;
+    }
+
+    static bool valid(const char *b, const char *e)
+    {
+        uint64_t key;
+        return parse(b, e, key);
+    }
+
+    ///@brief Token form used by the stream reader, or npos if the token is
+    ///       not a decimal integer.
+    size_t intern(const char *b, const char *e)
+    {
+        uint64_t key;
+        return parse(b, e, key) ? intern(key) : npos;
+    }
+
+    ///@brief Dense id of the decimal integer [b, e), or npos if it was never
+    ///       interned or does not parse.
+    size_t find(const char *b, const char *e) const
+    {
+        uint64_t key;
+        if (!parse(b, e, key))
+            return npos;
+        size_t mask = m_keys.size() - 1;
+        for (size_t i = hash(key) & mask; m_values[i]; i = (i + 1) & mask)
+            if (m_keys[i] == key)
+                return m_values[i] - 1;
+        return npos;
+    }
+
+    uint64_t external_id(size_t id) const { return m_ids[id]; }
+
+    size_t size() const { return m_ids.size(); }
+
+    size_t memory_usage() const
+    {
+        return m_ids.capacity() * sizeof(uint64_t) + m_keys.capacity() * sizeof(uint64_t) +
+               m_values.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static size_t hash(uint64_t x)
+    {
+        // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return static_cast<size_t>(x);
+    }
+
+    void grow()
+    {
+        std::vector<uint64_t> keys(m_keys.size() * 2, 0);
+        std::vector<uint32_t> values(m_values.size() * 2, 0);
+        size_t mask = keys.size() - 1;
+        for (size_t id = 0; id < m_ids.size(); ++id)
+        {
+            size_t i = hash(m_ids[id]) & mask;
+            while (values[i])
+                i = (i + 1) & mask;
+            keys[i] = m_ids[id];
+            values[i] = static_cast<uint32_t>(id + 1);
+        }
+        m_keys.swap(keys);
+        m_values.swap(values);
+    }
+
+    std::vector<uint64_t> m_ids;    // External id of each dense id
+    std::vector<uint64_t> m_keys;   // Table keys
+    std::vector<uint32_t> m_values; // Dense id + 1, 0 for empty
+};
+
+///@brief Tuning knobs for ingest_edge_stream.
+struct stream_options
+{
+    size_t chunk_bytes = 1 << 20;  // Bytes read from the input at a time
+    size_t batch_edges = 1 << 16;  // Edges buffered before they are inserted, at least 1
+    bool undirected = false;       // Use insert_edge_undirected
+};
+
+///@brief Counters reported by ingest_edge_stream.
+struct ingest_stats
+{
+    size_t bytes = 0;              // Input bytes consumed
+    size_t lines = 0;              // Lines seen, including skipped ones
+    size_t edges = 0;              // Edges inserted
+    size_t malformed = 0;          // Lines skipped because a token did not parse
+    size_t vertices = 0;           // Vertices inserted by this call
+    size_t batches = 0;            // Batch flushes
+    size_t peak_buffer_bytes = 0;  // Largest chunk + batch buffer footprint
+    size_t peak_rss_bytes = 0;     // Process peak resident set after ingest
+    double seconds = 0;            // Wall time
+    bool ok = true;                // False if reading failed or the interner was full
+    int error = 0;                 // errno of a failed read, 0 otherwise
+
+    double edges_per_second() const { return seconds > 0 ? edges / seconds : 0.0; }
+    double megabytes_per_second() const { return seconds > 0 ? bytes / seconds / 1e6 : 0.0; }
+};
+
+///@brief Parse a property token into v. Arithmetic types use
+///       std::from_chars and must consume the whole token, anything else
+///       goes through operator>>. A missing token gives E(). Returns false
+///       if the token does not parse.
+template <typename E>
+bool parse_stream_property(const char *b, const char *e, E &v)
+{
+    v = E();
+    if (b == e)
+        return true;
+    if constexpr (std::is_arithmetic<E>::value && !std::is_same<E, bool>::value)
+    {
+        auto r = std::from_chars(b, e, v);
+        return r.ec == std::errc() && r.ptr == e;
+    }
+    else
+    {
+        std::istringstream is(std::string(b, e));
+        return static_cast<bool>(is >> v);
+    }
+}
+
+///@brief Parse a property token, E() if it does not parse.
+template <typename E>
+E parse_stream_property(const char *b, const char *e)
+{
+    E v;
+    if (!parse_stream_property(b, e, v))
+        v = E();
+    return v;
+}
+
+///@brief Byte source over an istream.
+class istream_byte_source
+{
+public:
+    explicit istream_byte_source(std::istream &is) : m_is(is) {}
+
+    size_t read(char *buf, size_t n)
+    {
+        m_is.read(buf, n);
+        return static_cast<size_t>(m_is.gcount());
+    }
+
+    ///@brief Nonzero once the stream went bad (EIO, as istreams keep no errno).
+    int error() const { return m_is.bad() ? EIO : 0; }
+
+private:
+    std::istream &m_is;
+};
+
+///@brief Byte source over a file descriptor (file, pipe or socket).
+class fd_byte_source
+{
+public:
+    explicit fd_byte_source(int fd) : m_fd(fd), m_error(0) {}
+
+    ///@brief Bytes read, 0 at end of input or on error; see error().
+    size_t read(char *buf, size_t n)
+    {
+        for (;;)
+        {
+            ssize_t r = ::read(m_fd, buf, n);
+            if (r >= 0)
+                return static_cast<size_t>(r);
+            if (errno != EINTR)
+            {
+                m_error = errno;
+                return 0;
+            }
+        }
+    }
+
+    ///@brief errno of the failed read, 0 if none failed.
+    int error() const { return m_error; }
+
+private:
+    int m_fd;
+    int m_error;
+};
+
+///@brief Drive ingestion from any byte source with read(buf, n), returning 0
+///       at end of input or on error, and error(), nonzero after an error.
+///       map receives, for every dense id of the interner, the descriptor
+///       returned by g.insert_vertex; vertex properties are VertexProperty().
+///       Ingestion can be resumed on the same graph, interner and map with
+///       further inputs.
+template <typename ByteSource, typename Graph, typename Interner>
+ingest_stats ingest_edge_source(ByteSource &src, Graph &g, Interner &ids,
+                                std::vector<typename Graph::vertex_descriptor> &map,
+                                const stream_options &opt = stream_options())
+{
+    typedef typename Graph::vertex_descriptor vertex_descriptor;
+    typedef typename std::decay<decltype((*g.edges_cbegin())->property())>::type edge_property;
+    typedef typename std::decay<decltype((*g.vertices_cbegin())->property())>::type vertex_property;
+
+    struct pending_edge
+    {
+        size_t source;
+        size_t target;
+        edge_property property;
+    };
+
+    // setup
+    ingest_stats stats;
+    auto start = std::chrono::steady_clock::now();
+    const size_t batch_edges = std::max<size_t>(opt.batch_edges, 1);
+    const size_t first_vertex = map.size();
+    std::vector<char> buf(opt.chunk_bytes + 1);
+    std::vector<pending_edge> batch;
+    batch.reserve(batch_edges);
+    size_t carry = 0; // bytes of an unfinished line kept at the front of buf
+
+    auto flush = [&]()
+    {
+        while (map.size() < ids.size())
+            map.push_back(g.insert_vertex(vertex_property()));
+        for (const pending_edge &e : batch)
+        {
+            vertex_descriptor s = map[e.source], t = map[e.target];
+            if (opt.undirected)
+                g.insert_edge_undirected(s, t, e.property);
+            else
+                g.insert_edge(s, t, e.property);
+        }
+        stats.edges += batch.size();
+        stats.batches += !batch.empty();
+        batch.clear();
+    };
+
+    auto parse_line = [&](const char *b, const char *e)
+    {
+        ++stats.lines;
+        const char *tok[3][2];
+        int n = 0;
+        while (n < 3)
+        {
+            while (b != e && (*b == ' ' || *b == '\t' || *b == '\r' || *b == ','))
+                ++b;
+            if (b == e)
+                break;
+            if (n == 0 && *b == '#')
+                return;
+            tok[n][0] = b;
+            while (b != e && *b != ' ' && *b != '\t' && *b != '\r' && *b != ',')
+                ++b;
+            tok[n][1] = b;
+            ++n;
+        }
+        if (n < 2)
+            return;
+        pending_edge pe;
+        // validate the whole line before interning, so a bad line adds no ids
+        if (!ids.valid(tok[0][0], tok[0][1]) || !ids.valid(tok[1][0], tok[1][1]) ||
+            (n == 3 && !parse_stream_property(tok[2][0], tok[2][1], pe.property)))
+        {
+            ++stats.malformed;
+            return;
+        }
+        if (n < 3)
+            pe.property = edge_property();
+        // make sure both endpoints fit before interning either, so running
+        // out of ids never leaves an endpoint without its edge
+        bool new_source = ids.find(tok[0][0], tok[0][1]) == Interner::npos;
+        bool new_target = ids.find(tok[1][0], tok[1][1]) == Interner::npos;
+        bool same = tok[0][1] - tok[0][0] == tok[1][1] - tok[1][0] &&
+                    std::memcmp(tok[0][0], tok[1][0], tok[0][1] - tok[0][0]) == 0;
+        size_t fresh = new_source + (new_target && !(new_source && same));
+        if (ids.size() + fresh > Interner::max_ids)
+        {
+            stats.ok = false; // out of ids
+            return;
+        }
+        pe.source = ids.intern(tok[0][0], tok[0][1]);
+        pe.target = ids.intern(tok[1][0], tok[1][1]);
+        batch.push_back(pe);
+        if (batch.size() == batch_edges)
+            flush();
+    };
+
+    // read chunks, parse complete lines, carry the tail
+    while (stats.ok)
+    {
+        if (carry == buf.size() - 1)
+            buf.resize(buf.size() * 2); // a single line longer than a chunk
+        size_t got = src.read(buf.data() + carry, buf.size() - 1 - carry);
+        stats.bytes += got;
+        size_t end = carry + got;
+        stats.peak_buffer_bytes = std::max(stats.peak_buffer_bytes,
+                                           buf.capacity() + batch.capacity() * sizeof(pending_edge));
+        const char *p = buf.data();
+        const char *last = buf.data() + end;
+        for (const char *nl; stats.ok && (nl = static_cast<const char *>(std::memchr(p, '\n', last - p)));)
+        {
+            parse_line(p, nl);
+            p = nl + 1;
+        }
+        carry = last - p;
+        if (got == 0)
+        {
+            stats.error = src.error();
+            if (stats.error)
+                stats.ok = false; // a failed read is not end of input
+            else if (carry)
+                parse_line(p, last);
+            break;
+        }
+        std::memmove(buf.data(), p, carry);
+    }
+    flush();
+
+    // report
+    stats.vertices = map.size() - first_vertex;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+        stats.peak_rss_bytes = static_cast<size_t>(ru.ru_maxrss) * 1024; // kilobytes on Linux
+    return stats;
+}
+
+///@brief Stream an edge list from an istream into g.
+template <typename Graph, typename Interner>
+ingest_stats ingest_edge_stream(std::istream &is, Graph &g, Interner &ids,
+                                std::vector<typename Graph::vertex_descriptor> &map,
+                                const stream_options &opt = stream_options())
+{
+    istream_byte_source src(is);
+    return ingest_edge_source(src, g, ids, map, opt);
+}
+
+///@brief Stream an edge list from a file descriptor into g.
+template <typename Graph, typename Interner>
+ingest_stats ingest_edge_stream(int fd, Graph &g, Interner &ids,
+                                std::vector<typename Graph::vertex_descriptor> &map,
+                                const stream_options &opt = stream_options())
+{
+    fd_byte_source src(fd);
+    return ingest_edge_source(src, g, ids, map, opt);
+}
+
+#endif
@@ -5,10 +5,15 @@
 #include <list>
 #include <utility>
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/functional/hash.hpp>
+
+#include "graph instrumentation.h"
+#include "graph memory.h"
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -18,83 +23,6 @@ using namespace std;
 template <typename VertexProperty, typename EdgeProperty>
 class graph
 {
-
-private:
-    unordered_set<int> vertices;
-    unordered_set<pair<int, int>> edges;
-
-public:
-    // Insert a vertex to the graph
-    void insertVertex(int v)
-    {
-        vertices.insert(v);
-    }
-
-    // Erase a vertex from the graph
-    void eraseVertex(int v)
-    {
-        vertices.erase(v);
-        for (auto it = edges.begin(); it != edges.end();)
-        {
-            if (it->first == v || it->second == v)
-            {
-                it = edges.erase(it);
-            }
-            else
-            {
-                ++it;
-            }
-        }
-    }
-
-    // Insert an edge to the graph
-    void insertEdge(int v1, int v2)
-    {
-        edges.insert(make_pair(v1, v2));
-        edges.insert(make_pair(v2, v1));
-    }
-
-    // Erase an edge from the graph
-    void eraseEdge(int v1, int v2)
-    {
-        edges.erase(make_pair(v1, v2));
-        edges.erase(make_pair(v2, v1));
-    }
-
-    // Print the graph
-    void printGraph()
-    {
-        cout << "Vertices: ";
-        for (int v : vertices)
-        {
-            cout << v << " ";
-        }
-        cout << endl;
-        cout << "Edges: ";
-        for (auto e : edges)
-        {
-            cout << "(" << e.first << "," << e.second << ") ";
-        }
-        cout << endl;
-    }
-};
-
-int main()
-{
-    Graph g;
-    g.insertVertex(1);
-    g.insertVertex(2);
-    g.insertVertex(3);
-    g.insertEdge(1, 2);
-    g.insertEdge(2, 3);
-    g.printGraph();
-    g.eraseVertex(2);
-    g.printGraph();
-    g.eraseEdge(1, 2);
-    g.printGraph();
-    return 0;
-}
-
 // The vertex and edge classes are forward-declared to allow their use in the
 // public section below. Their definitions follow in the private section
 // afterward.
@@ -177,52 +105,119 @@ size_t num_edges() const { return m_edges.size(); }
 vertex_iterator find_vertex(vertex_descriptor vd)
 {
     vertex v(vd, VertexProperty());
+    GRAPH_COUNT(vertex_lookups, 1);
+    GRAPH_COUNT(vertex_probes, m_vertices.bucket_size(m_vertices.bucket(&v)));
     return m_vertices.find(&v);
 }
 
 const_vertex_iterator find_vertex(vertex_descriptor vd) const
 {
     vertex v(vd, VertexProperty());
+    GRAPH_COUNT(vertex_lookups, 1);
+    GRAPH_COUNT(vertex_probes, m_vertices.bucket_size(m_vertices.bucket(&v)));
     return m_vertices.find(&v);
 }
 
 edge_iterator find_edge(edge_descriptor ed)
 {
     edge e(ed.first, ed.second, EdgeProperty());
+    GRAPH_COUNT(edge_lookups, 1);
+    GRAPH_COUNT(edge_probes, m_edges.bucket_size(m_edges.bucket(&e)));
     return m_edges.find(&e);
 }
 
 const_edge_iterator find_edge(edge_descriptor ed) const
 {
     edge e(ed.first, ed.second, EdgeProperty());
+    GRAPH_COUNT(edge_lookups, 1);
+    GRAPH_COUNT(edge_probes, m_edges.bucket_size(m_edges.bucket(&e)));
     return m_edges.find(&e);
 }
 
-///@todo Define modifiers
+///@brief Descriptors of erased vertices go on a free list and are handed out
+///       again, lowest first, before m_max_vd grows.
 vertex_descriptor insert_vertex(const VertexProperty &vp)
 {
-    return m_max_vd;
+    vertex_descriptor vd;
+    if (!m_free_vds.empty())
+    {
+        std::pop_heap(m_free_vds.begin(), m_free_vds.end(), std::greater<vertex_descriptor>());
+        vd = m_free_vds.back();
+        m_free_vds.pop_back();
+    }
+    else
+        vd = m_max_vd++;
+    m_vertices.insert(new vertex(vd, vp));
+    GRAPH_COUNT(allocations, 1);
+    return vd;
 }
+
+///@brief Insert the edge (sd, td). If either vertex is missing nothing is
+///       inserted; if the edge is already present it is left unchanged.
 edge_descriptor insert_edge(vertex_descriptor sd, vertex_descriptor td,
                             const EdgeProperty &ep)
 {
+    auto si = find_vertex(sd);
+    if (si == m_vertices.end() || find_vertex(td) == m_vertices.end())
+        return std::make_pair(sd, td);
+    edge *e = new edge(sd, td, ep);
+    if (!m_edges.insert(e).second)
+    {
+        delete e;
+        return std::make_pair(sd, td);
+    }
+    GRAPH_COUNT(allocations, 1);
+    (*si)->m_out_edges.insert(e);
     return std::make_pair(sd, td);
 }
+
 void insert_edge_undirected(vertex_descriptor sd, vertex_descriptor td,
                             const EdgeProperty &ep)
 {
+    insert_edge(sd, td, ep);
+    insert_edge(td, sd, ep);
 }
+
+///@brief Erase vd, its out edges and every edge pointing to it. vd is
+///       recycled by a later insert_vertex.
 void erase_vertex(vertex_descriptor vd)
 {
+    auto vi = find_vertex(vd);
+    if (vi == m_vertices.end())
+        return;
+    // in edges are not indexed, so scan the edge set once
+    std::vector<edge_descriptor> dead;
+    for (auto e : m_edges)
+        if (e->source() == vd || e->target() == vd)
+            dead.push_back(e->descriptor());
+    for (auto &ed : dead)
+        erase_edge(ed);
+    vertex *v = *vi;
+    m_vertices.erase(vi);
+    delete v;
+    GRAPH_COUNT(deallocations, 1);
+    m_free_vds.push_back(vd);
+    std::push_heap(m_free_vds.begin(), m_free_vds.end(), std::greater<vertex_descriptor>());
 }
+
 void erase_edge(edge_descriptor ed)
 {
+    auto ei = find_edge(ed);
+    if (ei == m_edges.end())
+        return;
+    edge *e = *ei;
+    (*find_vertex(ed.first))->m_out_edges.erase(e);
+    m_edges.erase(ei);
+    delete e;
+    GRAPH_COUNT(deallocations, 1);
 }
-////end of @todo
+
 
 void clear()
 {
+    GRAPH_COUNT(deallocations, m_vertices.size() + m_edges.size());
     m_max_vd = 0;
+    m_free_vds.clear();
     for (auto v : m_vertices)
         delete v;
     m_vertices.clear();
@@ -231,6 +226,123 @@ void clear()
     m_edges.clear();
 }
 
+///@brief Report the bytes held by the graph, see graph memory.h.
+graph_memory_usage memory_usage() const
+{
+    graph_memory_usage u;
+    u.vertex_nodes = m_vertices.size() * (sizeof(vertex) - sizeof(VertexProperty));
+    u.edge_nodes = m_edges.size() * (sizeof(edge) - sizeof(EdgeProperty));
+    u.properties = m_vertices.size() * sizeof(VertexProperty) + m_edges.size() * sizeof(EdgeProperty);
+    account_hash_container(m_vertices, u, &graph_memory_usage::containers);
+    account_hash_container(m_edges, u, &graph_memory_usage::containers);
+    account_vector(m_free_vds, u, &graph_memory_usage::containers);
+    for (auto v : m_vertices)
+        account_hash_container(v->m_out_edges, u, &graph_memory_usage::adjacency);
+    return u;
+}
+
+///@brief Rebuild every hash table with the fewest buckets its size allows.
+///       Tables never shrink on their own, so call this after large erasures.
+void shrink_to_fit()
+{
+    m_vertices.rehash(0);
+    m_edges.rehash(0);
+    m_free_vds.shrink_to_fit();
+    for (auto v : m_vertices)
+        v->m_out_edges.rehash(0);
+}
+
+///@brief Renumber the live vertices to [0, num_vertices()), keeping their
+///       relative order, and empty the free list. Returns the remap table:
+///       entry d holds the new descriptor of old descriptor d, or -1 if d was
+///       not in use, so external maps can be migrated in one pass.
+std::vector<vertex_descriptor> compact()
+{
+    std::vector<vertex_descriptor> old_to_new(m_max_vd, vertex_descriptor(-1));
+    for (auto v : m_vertices)
+        old_to_new[v->descriptor()] = 0;
+    vertex_descriptor next = 0;
+    for (auto &d : old_to_new)
+        if (d == 0)
+            d = next++;
+    relabel(old_to_new);
+    return old_to_new;
+}
+
+///@brief Renumber every vertex through old_to_new and rebuild the vertex,
+///       edge and adjacency storage in the new order, so that nodes which are
+///       close in the new numbering are also allocated close together. Only
+///       the allocation order changes: the hash containers keep their own
+///       iteration order, so adjacency is not sorted by target as it is in
+///       graph_vector. old_to_new must map each live descriptor to a
+///       distinct descriptor.
+template <typename DescriptorMap>
+void relabel(const DescriptorMap &old_to_new)
+{
+    // order vertices and edges by their new descriptors
+    std::vector<std::pair<vertex_descriptor, vertex *>> vorder;
+    vorder.reserve(m_vertices.size());
+    for (auto v : m_vertices)
+        vorder.emplace_back(old_to_new.at(v->descriptor()), v);
+    std::sort(vorder.begin(), vorder.end(),
+              [](const std::pair<vertex_descriptor, vertex *> &a,
+                 const std::pair<vertex_descriptor, vertex *> &b)
+              { return a.first < b.first; });
+    std::vector<std::pair<edge_descriptor, edge *>> eorder;
+    eorder.reserve(m_edges.size());
+    for (auto e : m_edges)
+        eorder.emplace_back(edge_descriptor(old_to_new.at(e->source()),
+                                            old_to_new.at(e->target())),
+                            e);
+    std::sort(eorder.begin(), eorder.end(),
+              [](const std::pair<edge_descriptor, edge *> &a,
+                 const std::pair<edge_descriptor, edge *> &b)
+              { return a.first < b.first; });
+
+    // reallocate in the new order
+    MyVertexContainer vertices(m_vertices.bucket_count());
+    MyEdgeContainer edges(m_edges.bucket_count());
+    std::vector<vertex *> created;
+    created.reserve(vorder.size());
+    size_t max_vd = 0;
+    for (auto &p : vorder)
+    {
+        vertex *v = new vertex(p.first, std::move(p.second->m_property));
+        created.push_back(v);
+        vertices.insert(v);
+        max_vd = std::max(max_vd, p.first + 1);
+    }
+    for (auto &p : eorder)
+    {
+        edge *e = new edge(p.first.first, p.first.second, std::move(p.second->property()));
+        edges.insert(e);
+        auto src = std::lower_bound(vorder.begin(), vorder.end(), p.first.first,
+                                    [](const std::pair<vertex_descriptor, vertex *> &a,
+                                       vertex_descriptor vd)
+                                    { return a.first < vd; });
+        created[src - vorder.begin()]->m_out_edges.insert(e);
+    }
+
+    GRAPH_COUNT(allocations, vertices.size() + edges.size());
+    GRAPH_COUNT(deallocations, m_vertices.size() + m_edges.size());
+    for (auto v : m_vertices)
+        delete v;
+    for (auto e : m_edges)
+        delete e;
+    m_vertices.swap(vertices);
+    m_edges.swap(edges);
+    m_max_vd = max_vd;
+
+    // descriptors below m_max_vd that are no longer used become free
+    std::vector<bool> used(m_max_vd, false);
+    for (auto &p : vorder)
+        used[p.first] = true;
+    m_free_vds.clear();
+    for (vertex_descriptor d = 0; d < m_max_vd; ++d)
+        if (!used[d])
+            m_free_vds.push_back(d);
+}
+
 // Friend declarations for input/output.
 template <typename V, typename E>
 friend std::istream &operator>>(std::istream &, graph<V, E> &);
@@ -238,9 +350,10 @@ template <typename V, typename E>
 friend std::ostream &operator<<(std::ostream &, const graph<V, E> &);
 
 private:
-size_t m_max_vd;              //< Maximum vertex descriptor assigned
-MyVertexContainer m_vertices; //<Contains all vertices
-MyEdgeContainer m_edges;      //<Contains all edges
+size_t m_max_vd;                           //< Maximum vertex descriptor assigned
+MyVertexContainer m_vertices;              //<Contains all vertices
+MyEdgeContainer m_edges;                   //<Contains all edges
+std::vector<vertex_descriptor> m_free_vds; //<Min-heap of erased descriptors to reuse
 // Required internal classes
 
 class vertex
@@ -348,7 +461,7 @@ std::istream &operator>>(std::istream &is, graph<V, E> &g)
     size_t num_verts, num_edges;
     is >> num_verts >> num_edges;
     g.m_vertices.reserve(num_verts);
-    g.m_vertices.reserve(num_edges);
+    g.m_edges.reserve(num_edges);
     for (size_t i = 0; i < num_verts; ++i)
     {
         V v;